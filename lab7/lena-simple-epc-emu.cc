@@ -21,6 +21,7 @@
 #include "ns3/applications-module.h"
 #include "ns3/core-module.h"
 #include "ns3/epc-helper.h"
+#include "ns3/fd-net-device-module.h"
 #include "ns3/internet-module.h"
 #include "ns3/ipv4-global-routing-helper.h"
 #include "ns3/lte-helper.h"
@@ -28,8 +29,25 @@
 #include "ns3/mobility-module.h"
 #include "ns3/network-module.h"
 #include "ns3/point-to-point-helper.h"
+#include "ns3/realtime-simulator-impl.h"
 #include <ns3/config-store-module.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <linux/if_packet.h>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
 using namespace ns3;
 
 /*
@@ -39,10 +57,694 @@ using namespace ns3;
  * of UEs per each eNB, located at the same position of the eNB.
  * For the EPC, it uses EmuEpcHelper to realize the S1-U connection
  * via a real link.
+ *
+ * With --realtime the program runs on RealtimeSimulatorImpl (optionally
+ * with --hardLimit) and monitors whether it keeps up with wall-clock:
+ * the scheduling lag is probed every --lagProbeInterval ms and written
+ * per second to --lagFile together with the frames sent, dropped and
+ * received late on the emulated (FdNetDevice) S1-U devices. Receive-side
+ * loss is the kernel's drop count on each device's packet socket
+ * (PACKET_STATISTICS), i.e. frames the reader thread did not pick up in
+ * time. Frames dropped by FdNetDevice itself once its RxQueueSize queue
+ * of frames waiting for the simulation thread is full are not traced and
+ * not counted; by then the lag is far above any sensible threshold. A
+ * one-row summary goes to --realtimeReport.
+ *
+ * With --findMaxUes=N the program instead re-runs itself in hard-limit
+ * real-time mode for increasing nUesPerEnb (doubling, then bisection,
+ * up to N) and reports the largest value that stays within the budget
+ * (no tx or rx drops, few late probes and frames) at the given
+ * interPacketInterval in emu_capacity.csv.
+ *
+ * With --io=batched the S1-U devices of the SGW and the eNBs are
+ * BatchedFdNetDevices (installed by BatchedEmuEpcHelper, otherwise
+ * identical to EmuEpcHelper): up to --ioBatch frames are read per
+ * recvmmsg call and queued frames are written per sendmmsg call, instead
+ * of one read/write syscall per frame.
  */
 
 NS_LOG_COMPONENT_DEFINE("EpcFirstExample");
 
+/**
+ * Real-time budget counters, per second and for the whole run.
+ */
+struct RealtimeBudget
+{
+    double lateThresholdMs = 1.0; ///< Lag above which a probe or frame counts as late
+    uint64_t probes = 0;          ///< Lag probes executed
+    uint64_t lateProbes = 0;      ///< Probes executed later than the threshold
+    double lagSumMs = 0.0;        ///< Sum of the probed lags
+    double lagMaxMs = 0.0;        ///< Largest probed lag
+    uint64_t txFrames = 0;        ///< Frames written to the emulated devices
+    uint64_t txDrops = 0;         ///< Frames dropped by the emulated devices' tx queue
+    uint64_t rxFrames = 0;        ///< Frames read from the emulated devices
+    uint64_t rxDrops = 0;         ///< Frames the kernel dropped on the devices' sockets
+    uint64_t lateRxFrames = 0;    ///< Frames handed to the simulation later than the threshold
+
+    /**
+     * Adds another set of counters to this one.
+     * \param other counters to add
+     */
+    void Add(const RealtimeBudget& other)
+    {
+        probes += other.probes;
+        lateProbes += other.lateProbes;
+        lagSumMs += other.lagSumMs;
+        lagMaxMs = std::max(lagMaxMs, other.lagMaxMs);
+        txFrames += other.txFrames;
+        txDrops += other.txDrops;
+        rxFrames += other.rxFrames;
+        rxDrops += other.rxDrops;
+        lateRxFrames += other.lateRxFrames;
+    }
+};
+
+Ptr<RealtimeSimulatorImpl> g_realtimeImpl; ///< Real-time simulator (null when not real-time)
+RealtimeBudget g_budgetSecond;             ///< Counters of the running second
+RealtimeBudget g_budgetTotal;              ///< Counters of the completed seconds
+std::ofstream g_lagFile;                   ///< Per-second lag and frame counters
+
+/**
+ * FdNetDevice that moves frames to and from its file descriptor in batches.
+ *
+ * Receive: the reader thread wakes up when the socket is readable and
+ * drains up to BatchSize frames with one recvmmsg call into malloc'ed
+ * buffers, each of which is handed to the device as is (no copy), exactly
+ * like the one-frame default reader does.
+ *
+ * Transmit: frames are copied into a queue that is written with sendmmsg
+ * once BatchSize frames are pending, or by an event scheduled for the
+ * current simulation time, i.e. after the frames sent in the same instant.
+ * Frames that sendmmsg fails to write are counted, not traced, because
+ * the MAC has already accepted them.
+ */
+class BatchedFdNetDevice : public FdNetDevice
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("BatchedFdNetDevice")
+                .SetParent<FdNetDevice>()
+                .SetGroupName("FdNetDevice")
+                .AddConstructor<BatchedFdNetDevice>()
+                .AddAttribute("BatchSize",
+                              "Maximum frames per recvmmsg/sendmmsg call",
+                              UintegerValue(32),
+                              MakeUintegerAccessor(&BatchedFdNetDevice::m_batchSize),
+                              MakeUintegerChecker<uint32_t>(1, 1024));
+        return tid;
+    }
+
+    /**
+     * Returns and resets the number of frames sendmmsg failed to write.
+     * \return frames lost since the last call
+     */
+    uint64_t TakeTxErrors()
+    {
+        uint64_t errors = m_txErrors;
+        m_txErrors = 0;
+        return errors;
+    }
+
+    /**
+     * Logs the average number of frames per syscall in both directions.
+     */
+    void LogIoStats() const
+    {
+        NS_LOG_INFO("BatchedFdNetDevice node " << GetNode()->GetId() << ": rx " << m_rxFrames
+                                               << " frames in " << m_rxCalls << " recvmmsg, tx "
+                                               << m_txFrames << " frames in " << m_txCalls
+                                               << " sendmmsg");
+    }
+
+  protected:
+    Ptr<FdReader> DoCreateFdReader() override
+    {
+        // Same buffer size as the default reader: MTU plus Ethernet/LLC headers
+        return Create<BatchedFdReader>(this, m_batchSize, GetMtu() + 22);
+    }
+
+    void DoFinishStoppingDevice() override
+    {
+        FlushTx();
+        FdNetDevice::DoFinishStoppingDevice();
+    }
+
+    ssize_t Write(uint8_t* buffer, size_t length) override
+    {
+        if (m_txQueue.size() < m_batchSize)
+        {
+            m_txQueue.resize(m_batchSize);
+        }
+        m_txQueue[m_txPending++].assign(buffer, buffer + length);
+        if (m_txPending == m_batchSize)
+        {
+            FlushTx();
+        }
+        else if (!m_flushEvent.IsRunning())
+        {
+            m_flushEvent = Simulator::ScheduleNow(&BatchedFdNetDevice::FlushTx, this);
+        }
+        return length;
+    }
+
+  private:
+    /**
+     * FdReader that drains the socket with recvmmsg.
+     */
+    class BatchedFdReader : public FdReader
+    {
+      public:
+        /**
+         * Constructor.
+         * \param device device the frames are delivered to
+         * \param batchSize maximum frames per recvmmsg call
+         * \param bufferSize size of each frame buffer
+         */
+        BatchedFdReader(BatchedFdNetDevice* device, uint32_t batchSize, uint32_t bufferSize)
+            : m_device(device),
+              m_bufferSize(bufferSize),
+              m_buffers(batchSize, nullptr),
+              m_iovecs(batchSize),
+              m_msgs(batchSize)
+        {
+        }
+
+        ~BatchedFdReader() override
+        {
+            for (uint8_t* buffer : m_buffers)
+            {
+                std::free(buffer);
+            }
+        }
+
+      private:
+        FdReader::Data DoRead() override
+        {
+            for (size_t i = 0; i < m_msgs.size(); ++i)
+            {
+                if (!m_buffers[i])
+                {
+                    m_buffers[i] = static_cast<uint8_t*>(std::malloc(m_bufferSize));
+                }
+                m_iovecs[i].iov_base = m_buffers[i];
+                m_iovecs[i].iov_len = m_bufferSize;
+                m_msgs[i] = mmsghdr{};
+                m_msgs[i].msg_hdr.msg_iov = &m_iovecs[i];
+                m_msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+            int received = recvmmsg(m_fd, m_msgs.data(), m_msgs.size(), MSG_DONTWAIT, nullptr);
+            if (received <= 0)
+            {
+                return FdReader::Data(nullptr, -1);
+            }
+            m_device->m_rxCalls++;
+            m_device->m_rxFrames += received;
+
+            // Buffers change owner: the device frees them once the frame is processed
+            for (int i = 0; i < received - 1; ++i)
+            {
+                m_device->ReceiveCallback(m_buffers[i], m_msgs[i].msg_len);
+                m_buffers[i] = nullptr;
+            }
+            uint8_t* last = m_buffers[received - 1];
+            m_buffers[received - 1] = nullptr;
+            return FdReader::Data(last, m_msgs[received - 1].msg_len);
+        }
+
+        BatchedFdNetDevice* m_device;    ///< Device the frames are delivered to
+        uint32_t m_bufferSize;           ///< Size of each frame buffer
+        std::vector<uint8_t*> m_buffers; ///< Frame buffers not yet handed to the device
+        std::vector<iovec> m_iovecs;     ///< One iovec per frame buffer
+        std::vector<mmsghdr> m_msgs;     ///< recvmmsg message headers
+    };
+
+    /**
+     * Writes all queued frames with as few sendmmsg calls as possible.
+     */
+    void FlushTx()
+    {
+        m_flushEvent.Cancel();
+        std::vector<iovec> iovecs(m_txPending);
+        std::vector<mmsghdr> msgs(m_txPending);
+        for (uint32_t i = 0; i < m_txPending; ++i)
+        {
+            iovecs[i].iov_base = m_txQueue[i].data();
+            iovecs[i].iov_len = m_txQueue[i].size();
+            msgs[i].msg_hdr.msg_iov = &iovecs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        uint32_t sent = 0;
+        while (sent < m_txPending)
+        {
+            int written = sendmmsg(GetFileDescriptor(), &msgs[sent], m_txPending - sent, 0);
+            if (written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (written <= 0)
+            {
+                m_txErrors += m_txPending - sent;
+                break;
+            }
+            m_txCalls++;
+            m_txFrames += written;
+            sent += written;
+        }
+        m_txPending = 0;
+    }
+
+    uint32_t m_batchSize = 32;                   ///< Maximum frames per syscall
+    std::vector<std::vector<uint8_t>> m_txQueue; ///< Frames waiting for sendmmsg
+    uint32_t m_txPending = 0;                    ///< Frames queued in m_txQueue
+    EventId m_flushEvent;                        ///< Pending end-of-instant flush
+    uint64_t m_txCalls = 0;                      ///< sendmmsg calls that wrote frames
+    uint64_t m_txFrames = 0;                     ///< Frames written
+    uint64_t m_txErrors = 0;                     ///< Frames sendmmsg failed to write
+    std::atomic<uint64_t> m_rxCalls{0};          ///< recvmmsg calls that read frames
+    std::atomic<uint64_t> m_rxFrames{0};         ///< Frames read
+};
+
+NS_OBJECT_ENSURE_REGISTERED(BatchedFdNetDevice);
+
+/**
+ * EmuEpcHelper variant whose S1-U devices are BatchedFdNetDevices.
+ *
+ * EmuEpcHelper creates its EmuFdNetDeviceHelper internally, so the device
+ * type cannot be changed from outside; this helper repeats its (short)
+ * SGW and eNB device setup with the device type set, and keeps the same
+ * attributes, MAC addresses and 10.0.0.0/24 S1-U addressing.
+ */
+class BatchedEmuEpcHelper : public NoBackhaulEpcHelper
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("BatchedEmuEpcHelper")
+                .SetParent<NoBackhaulEpcHelper>()
+                .SetGroupName("Lte")
+                .AddConstructor<BatchedEmuEpcHelper>()
+                .AddAttribute("SgwDeviceName",
+                              "The name of the device used for the S1-U interface of the SGW",
+                              StringValue("veth0"),
+                              MakeStringAccessor(&BatchedEmuEpcHelper::m_sgwDeviceName),
+                              MakeStringChecker())
+                .AddAttribute("EnbDeviceName",
+                              "The name of the device used for the S1-U interface of the eNB",
+                              StringValue("veth1"),
+                              MakeStringAccessor(&BatchedEmuEpcHelper::m_enbDeviceName),
+                              MakeStringChecker())
+                .AddAttribute("SgwMacAddress",
+                              "MAC address used for the SGW",
+                              StringValue("00:00:00:59:00:aa"),
+                              MakeStringAccessor(&BatchedEmuEpcHelper::m_sgwMacAddress),
+                              MakeStringChecker())
+                .AddAttribute("EnbMacAddressBase",
+                              "First 5 bytes of the eNB MAC address base",
+                              StringValue("00:00:00:eb:00"),
+                              MakeStringAccessor(&BatchedEmuEpcHelper::m_enbMacAddressBase),
+                              MakeStringChecker())
+                .AddAttribute("BatchSize",
+                              "Maximum frames per recvmmsg/sendmmsg call",
+                              UintegerValue(32),
+                              MakeUintegerAccessor(&BatchedEmuEpcHelper::m_batchSize),
+                              MakeUintegerChecker<uint32_t>(1, 1024));
+        return tid;
+    }
+
+    void AddEnb(Ptr<Node> enb,
+                Ptr<NetDevice> lteEnbNetDevice,
+                std::vector<uint16_t> cellIds) override
+    {
+        NoBackhaulEpcHelper::AddEnb(enb, lteEnbNetDevice, cellIds);
+
+        std::ostringstream enbMacAddress;
+        enbMacAddress << m_enbMacAddressBase << ":" << std::hex << std::setfill('0')
+                      << std::setw(2) << cellIds.at(0);
+        NetDeviceContainer enbDevices = InstallEmuDevice(enb, m_enbDeviceName, enbMacAddress.str());
+        Ipv4InterfaceContainer enbIpIfaces = m_epcIpv4AddressHelper.Assign(enbDevices);
+        NoBackhaulEpcHelper::AddS1Interface(enb,
+                                            enbIpIfaces.GetAddress(0),
+                                            m_sgwIpIfaces.GetAddress(0),
+                                            cellIds);
+    }
+
+  protected:
+    void DoInitialize() override
+    {
+        NetDeviceContainer sgwDevices =
+            InstallEmuDevice(GetSgwNode(), m_sgwDeviceName, m_sgwMacAddress);
+        // Address of the SGW: 10.0.0.1, of the first eNB: 10.0.0.101
+        m_epcIpv4AddressHelper.SetBase("10.0.0.0", "255.255.255.0", "0.0.0.1");
+        m_sgwIpIfaces = m_epcIpv4AddressHelper.Assign(sgwDevices);
+        m_epcIpv4AddressHelper.SetBase("10.0.0.0", "255.255.255.0", "0.0.0.101");
+        NoBackhaulEpcHelper::DoInitialize();
+    }
+
+  private:
+    /**
+     * Installs a BatchedFdNetDevice on a real interface.
+     * \param node node to install the device on
+     * \param deviceName host interface name
+     * \param macAddress MAC address of the device
+     * \return the installed device
+     */
+    NetDeviceContainer InstallEmuDevice(Ptr<Node> node,
+                                        const std::string& deviceName,
+                                        const std::string& macAddress)
+    {
+        EmuFdNetDeviceHelper emu;
+        emu.SetTypeId("BatchedFdNetDevice");
+        emu.SetAttribute("BatchSize", UintegerValue(m_batchSize));
+        emu.SetDeviceName(deviceName);
+        NetDeviceContainer devices = emu.Install(node);
+        devices.Get(0)->SetAttribute("Address", Mac48AddressValue(macAddress.c_str()));
+        return devices;
+    }
+
+    std::string m_sgwDeviceName;              ///< SGW S1-U interface
+    std::string m_enbDeviceName;              ///< eNB S1-U interface
+    std::string m_sgwMacAddress;              ///< SGW MAC address
+    std::string m_enbMacAddressBase;          ///< First 5 bytes of the eNB MAC addresses
+    uint32_t m_batchSize = 32;                ///< Frames per syscall of the devices
+    Ipv4AddressHelper m_epcIpv4AddressHelper; ///< S1-U address allocation
+    Ipv4InterfaceContainer m_sgwIpIfaces;     ///< SGW S1-U address
+};
+
+NS_OBJECT_ENSURE_REGISTERED(BatchedEmuEpcHelper);
+
+std::vector<Ptr<BatchedFdNetDevice>> g_batchedDevices; ///< S1-U devices with --io=batched
+std::vector<Ptr<FdNetDevice>> g_emuDevices;            ///< All emulated S1-U devices
+
+/**
+ * Reaches the file descriptor of any FdNetDevice, which only exposes it
+ * to subclasses.
+ */
+class FdNetDeviceAccess : public FdNetDevice
+{
+  public:
+    /**
+     * Returns the file descriptor of a device.
+     * \param device emulated device
+     * eturn its packet socket, or -1
+     */
+    static int GetFd(const Ptr<FdNetDevice>& device)
+    {
+        return ((*device).*(&FdNetDeviceAccess::GetFileDescriptor))();
+    }
+};
+
+/**
+ * Returns and resets the number of frames the kernel dropped on the
+ * packet socket of an emulated device because its receive buffer was full.
+ * \param device emulated device
+ * eturn frames dropped since the last call
+ */
+static uint64_t
+TakeRxDrops(const Ptr<FdNetDevice>& device)
+{
+    int fd = FdNetDeviceAccess::GetFd(device);
+    tpacket_stats stats{};
+    socklen_t length = sizeof(stats);
+    if (fd < 0 || getsockopt(fd, SOL_PACKET, PACKET_STATISTICS, &stats, &length) != 0)
+    {
+        return 0;
+    }
+    return stats.tp_drops;
+}
+
+/**
+ * Returns how far the simulation runs behind wall-clock.
+ * \return lag in milliseconds (0 when not in real-time mode)
+ */
+static double
+CurrentLagMs()
+{
+    if (!g_realtimeImpl)
+    {
+        return 0.0;
+    }
+    return (g_realtimeImpl->RealtimeNow() - Simulator::Now()).GetSeconds() * 1000.0;
+}
+
+/**
+ * Probes the scheduling lag and reschedules itself.
+ * \param interval probe interval
+ */
+static void
+ProbeLag(Time interval)
+{
+    double lagMs = CurrentLagMs();
+    g_budgetSecond.probes++;
+    g_budgetSecond.lateProbes += (lagMs > g_budgetSecond.lateThresholdMs);
+    g_budgetSecond.lagSumMs += lagMs;
+    g_budgetSecond.lagMaxMs = std::max(g_budgetSecond.lagMaxMs, lagMs);
+    Simulator::Schedule(interval, &ProbeLag, interval);
+}
+
+/**
+ * Writes the counters of the second that just ended and starts the next one.
+ */
+static void
+FlushBudgetSecond()
+{
+    for (const auto& device : g_batchedDevices)
+    {
+        g_budgetSecond.txDrops += device->TakeTxErrors();
+    }
+    for (const auto& device : g_emuDevices)
+    {
+        g_budgetSecond.rxDrops += TakeRxDrops(device);
+    }
+    if (g_lagFile.is_open())
+    {
+        const RealtimeBudget& b = g_budgetSecond;
+        g_lagFile << Simulator::Now().GetSeconds() << ","
+                  << b.lagSumMs / std::max<uint64_t>(1, b.probes) << "," << b.lagMaxMs << ","
+                  << b.lateProbes << "," << b.txFrames << "," << b.txDrops << "," << b.rxFrames
+                  << "," << b.rxDrops << "," << b.lateRxFrames << "\n";
+    }
+    g_budgetTotal.Add(g_budgetSecond);
+    double threshold = g_budgetSecond.lateThresholdMs;
+    g_budgetSecond = RealtimeBudget();
+    g_budgetSecond.lateThresholdMs = threshold;
+    Simulator::Schedule(Seconds(1), &FlushBudgetSecond);
+}
+
+/**
+ * FdNetDevice MacTx sink.
+ * \param packet frame sent
+ */
+static void
+EmuTxTrace(Ptr<const Packet> packet)
+{
+    g_budgetSecond.txFrames++;
+}
+
+/**
+ * FdNetDevice MacTxDrop sink.
+ * \param packet frame dropped
+ */
+static void
+EmuTxDropTrace(Ptr<const Packet> packet)
+{
+    g_budgetSecond.txDrops++;
+}
+
+/**
+ * FdNetDevice MacRx sink. The reader thread schedules every frame for
+ * "now", so the lag at delivery is how late the frame reaches the model.
+ * \param packet frame received
+ */
+static void
+EmuRxTrace(Ptr<const Packet> packet)
+{
+    g_budgetSecond.rxFrames++;
+    g_budgetSecond.lateRxFrames += (CurrentLagMs() > g_budgetSecond.lateThresholdMs);
+}
+
+/**
+ * Writes the run summary read back by FindMaxUesPerEnb.
+ * \param path output file
+ * \param nUesPerEnb UEs per eNB of this run
+ * \param interPacketInterval inter packet interval [ms]
+ * \return true if the file was written
+ */
+static bool
+WriteRealtimeReport(const std::string& path, uint16_t nUesPerEnb, double interPacketInterval)
+{
+    std::ofstream report(path);
+    if (!report.is_open())
+    {
+        return false;
+    }
+    const RealtimeBudget& b = g_budgetTotal;
+    report << "nUesPerEnb,InterPacketInterval(ms),Probes,LateProbes,MeanLag(ms),MaxLag(ms),"
+              "TxFrames,TxDrops,RxFrames,RxDrops,LateRxFrames\n";
+    report << nUesPerEnb << "," << interPacketInterval << "," << b.probes << "," << b.lateProbes
+           << "," << b.lagSumMs / std::max<uint64_t>(1, b.probes) << "," << b.lagMaxMs << ","
+           << b.txFrames << "," << b.txDrops << "," << b.rxFrames << "," << b.rxDrops << ","
+           << b.lateRxFrames << "\n";
+    NS_LOG_INFO("Real-time budget: max lag " << b.lagMaxMs << " ms, " << b.lateProbes << "/"
+                                             << b.probes << " late probes, " << b.txDrops
+                                             << " tx drops, " << b.rxDrops << " rx drops, "
+                                             << b.lateRxFrames << "/"
+                                             << b.rxFrames << " late rx frames");
+    return report.good();
+}
+
+/**
+ * Runs this program once as a child process and waits for it.
+ * \param exe path of this executable
+ * \param args arguments after the program name
+ * \return the child's exit status, or -1 if it did not exit normally
+ */
+static int
+RunChild(const std::string& exe, const std::vector<std::string>& args)
+{
+    std::vector<char*> childArgv{const_cast<char*>(exe.c_str())};
+    for (const auto& arg : args)
+    {
+        childArgv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    childArgv.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        execv(childArgv[0], childArgv.data());
+        _exit(127);
+    }
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) < 0)
+    {
+        return -1;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/**
+ * Finds the largest nUesPerEnb whose hard-limit real-time run stays within budget.
+ *
+ * A run is sustainable if it finishes (the hard limit was never hit), no
+ * emulated frame was dropped on transmit or by the kernel on receive, and
+ * at most maxLateFraction of the probes and of the received frames were
+ * late.
+ * \param argc argument count of this process
+ * \param argv arguments of this process
+ * \param maxUes largest nUesPerEnb to try
+ * \param maxLateFraction tolerated fraction of late probes and frames
+ * \return 0 if at least nUesPerEnb=1 is sustainable, 1 otherwise
+ */
+static int
+FindMaxUesPerEnb(int argc, char* argv[], uint16_t maxUes, double maxLateFraction)
+{
+    std::error_code ec;
+    std::filesystem::path exe = std::filesystem::read_symlink("/proc/self/exe", ec);
+    if (ec)
+    {
+        exe = std::filesystem::absolute(argv[0]);
+    }
+    std::vector<std::string> forwardedArgs;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg(argv[i]);
+        if (arg.rfind("--findMaxUes", 0) != 0)
+        {
+            forwardedArgs.push_back(arg);
+        }
+    }
+
+    std::ofstream results("emu_capacity.csv");
+    results << "nUesPerEnb,ExitStatus,Sustainable,Probes,LateProbes,MeanLag(ms),MaxLag(ms),"
+               "TxFrames,TxDrops,RxFrames,RxDrops,LateRxFrames\n";
+
+    auto probe = [&](uint32_t n) {
+        std::string report = "emu_realtime_summary_" + std::to_string(n) + ".csv";
+        std::vector<std::string> args = forwardedArgs;
+        args.push_back("--realtime=1");
+        args.push_back("--hardLimit=1");
+        args.push_back("--nUesPerEnb=" + std::to_string(n));
+        args.push_back("--lagFile=emu_realtime_lag_" + std::to_string(n) + ".csv");
+        args.push_back("--realtimeReport=" + report);
+        std::remove(report.c_str());
+        int exitStatus = RunChild(exe.string(), args);
+
+        // Summary row: n, ipi, probes, lateProbes, meanLag, maxLag, tx, txDrops, rx, rxDrops,
+        // lateRx
+        std::ifstream in(report);
+        std::string line;
+        std::vector<double> fields;
+        if (std::getline(in, line) && std::getline(in, line))
+        {
+            std::stringstream row(line);
+            std::string field;
+            while (std::getline(row, field, ','))
+            {
+                fields.push_back(std::stod(field));
+            }
+        }
+        bool sustainable = exitStatus == 0 && fields.size() == 11 && fields[7] == 0 &&
+                           fields[9] == 0 && fields[3] <= maxLateFraction * fields[2] &&
+                           fields[10] <= maxLateFraction * fields[8];
+        results << n << "," << exitStatus << "," << sustainable;
+        for (size_t i = 2; i < fields.size(); ++i)
+        {
+            results << "," << fields[i];
+        }
+        results << "\n";
+        results.flush();
+        NS_LOG_INFO("nUesPerEnb=" << n << (sustainable ? " sustainable" : " NOT sustainable"));
+        return sustainable;
+    };
+
+    // Double until the budget breaks, then bisect between the last good and first bad value
+    // Wider than uint16_t: maxUes + 1 must not wrap for maxUes = 65535
+    uint32_t good = 0;
+    uint32_t bad = uint32_t(maxUes) + 1;
+    for (uint32_t n = 1; n <= maxUes; n *= 2)
+    {
+        if (!probe(n))
+        {
+            bad = n;
+            break;
+        }
+        good = n;
+    }
+    auto bisect = [&](uint32_t n) {
+        if (probe(n))
+        {
+            good = n;
+        }
+        else
+        {
+            bad = n;
+        }
+    };
+    if (bad == uint32_t(maxUes) + 1 && good < maxUes)
+    {
+        bisect(maxUes);
+    }
+    while (bad - good > 1)
+    {
+        bisect(good + (bad - good) / 2);
+    }
+    results.close();
+
+    NS_LOG_INFO("Max sustainable nUesPerEnb: " << good << " (see emu_capacity.csv)");
+    return good > 0 ? 0 : 1;
+}
+
 int
 main(int argc, char* argv[])
 {
@@ -51,6 +753,17 @@ main(int argc, char* argv[])
     double simTime = 10.1;
     double distance = 1000.0;
     double interPacketInterval = 1000;
+    bool realtime = false;
+    bool hardLimit = false;
+    double hardLimitMs = 100.0;
+    double lagProbeInterval = 10.0;
+    double lateThresholdMs = 1.0;
+    std::string lagFile = "emu_realtime_lag.csv";
+    std::string realtimeReport = "emu_realtime_summary.csv";
+    uint16_t findMaxUes = 0;
+    double maxLateFraction = 0.01;
+    std::string io = "raw";
+    uint32_t ioBatch = 32;
 
     // Command line arguments
     CommandLine cmd(__FILE__);
@@ -59,22 +772,75 @@ main(int argc, char* argv[])
     cmd.AddValue("simTime", "Total duration of the simulation [s])", simTime);
     cmd.AddValue("distance", "Distance between eNBs [m]", distance);
     cmd.AddValue("interPacketInterval", "Inter packet interval [ms])", interPacketInterval);
+    cmd.AddValue("realtime", "Run on RealtimeSimulatorImpl and monitor the lag", realtime);
+    cmd.AddValue("hardLimit",
+                 "Abort the real-time run once it lags more than hardLimitMs",
+                 hardLimit);
+    cmd.AddValue("hardLimitMs", "Hard limit on the real-time lag [ms]", hardLimitMs);
+    cmd.AddValue("lagProbeInterval", "Real-time lag probe interval [ms]", lagProbeInterval);
+    cmd.AddValue("lateThresholdMs",
+                 "Lag above which probes and frames count as late [ms]",
+                 lateThresholdMs);
+    cmd.AddValue("lagFile", "Per-second real-time lag and frame counters", lagFile);
+    cmd.AddValue("realtimeReport", "Real-time budget summary of the run", realtimeReport);
+    cmd.AddValue("findMaxUes",
+                 "Search the max sustainable nUesPerEnb up to this value (0 = off)",
+                 findMaxUes);
+    cmd.AddValue("maxLateFraction",
+                 "Search: tolerated fraction of late probes and frames",
+                 maxLateFraction);
+    cmd.AddValue("io", "S1-U device I/O: raw (one frame per syscall) or batched", io);
+    cmd.AddValue("ioBatch", "Batched I/O: maximum frames per recvmmsg/sendmmsg", ioBatch);
     cmd.Parse(argc, argv);
 
+    // Enable logging
+    LogComponentEnable("EpcFirstExample", LOG_LEVEL_INFO);
+
+    if (findMaxUes > 0)
+    {
+        return FindMaxUesPerEnb(argc, argv, findMaxUes, maxLateFraction);
+    }
+
+    if (hardLimit && !realtime)
+    {
+        NS_LOG_ERROR("--hardLimit only applies to real-time runs; add --realtime");
+        return 1;
+    }
+
     // let's go in real time
     // NOTE: if you go in real time I strongly advise to use
     // --ns3::RealtimeSimulatorImpl::SynchronizationMode=HardLimit
     // I've seen that if BestEffort is used things can break
     // (even simple stuff such as ARP)
-    // GlobalValue::Bind ("SimulatorImplementationType",
-    //                 StringValue ("ns3::RealtimeSimulatorImpl"));
-
-
-    // Enable logging
-    LogComponentEnable("EpcFirstExample", LOG_LEVEL_INFO);
+    if (realtime)
+    {
+        GlobalValue::Bind("SimulatorImplementationType",
+                          StringValue("ns3::RealtimeSimulatorImpl"));
+        if (hardLimit)
+        {
+            Config::SetDefault("ns3::RealtimeSimulatorImpl::SynchronizationMode",
+                               EnumValue(RealtimeSimulatorImpl::SYNC_HARD_LIMIT));
+            Config::SetDefault("ns3::RealtimeSimulatorImpl::HardLimit",
+                               TimeValue(MilliSeconds(hardLimitMs)));
+        }
+    }
 
     Ptr<LteHelper> lteHelper = CreateObject<LteHelper>();
-    Ptr<EmuEpcHelper> epcHelper = CreateObject<EmuEpcHelper>();
+    Ptr<NoBackhaulEpcHelper> epcHelper;
+    if (io == "raw")
+    {
+        epcHelper = CreateObject<EmuEpcHelper>();
+    }
+    else if (io == "batched")
+    {
+        epcHelper = CreateObject<BatchedEmuEpcHelper>();
+        epcHelper->SetAttribute("BatchSize", UintegerValue(ioBatch));
+    }
+    else
+    {
+        NS_LOG_ERROR("Unknown S1-U I/O mode: " << io);
+        return 1;
+    }
 
     // Set interface names for emulation
     epcHelper->SetAttribute("SgwDeviceName", StringValue("veth0")); // Interface for SGW
@@ -147,6 +913,25 @@ main(int argc, char* argv[])
     lteHelper->Attach(ueLteDevs);
     // side effects: 1) use idle mode cell selection, 2) activate default EPS bearer
 
+    // The eNB S1-U devices exist once the eNBs are installed
+    for (uint32_t n = 0; n < NodeList::GetNNodes(); ++n)
+    {
+        Ptr<Node> node = NodeList::GetNode(n);
+        for (uint32_t d = 0; d < node->GetNDevices(); ++d)
+        {
+            Ptr<FdNetDevice> device = DynamicCast<FdNetDevice>(node->GetDevice(d));
+            if (device)
+            {
+                g_emuDevices.push_back(device);
+            }
+            Ptr<BatchedFdNetDevice> batched = DynamicCast<BatchedFdNetDevice>(device);
+            if (batched)
+            {
+                g_batchedDevices.push_back(batched);
+            }
+        }
+    }
+
     // randomize a bit start times to avoid simulation artifacts
     // (e.g., buffer overflows due to packet transmissions happening
     // exactly at the same time)
@@ -185,9 +970,53 @@ main(int argc, char* argv[])
         clientApps.Start(Seconds(startTimeSeconds->GetValue()));
     }
 
+    // Real-time budget monitoring on the emulated S1-U devices
+    if (realtime)
+    {
+        g_realtimeImpl = DynamicCast<RealtimeSimulatorImpl>(Simulator::GetImplementation());
+        g_budgetSecond.lateThresholdMs = lateThresholdMs;
+        Config::ConnectWithoutContextFailSafe("/NodeList/*/DeviceList/*/$ns3::FdNetDevice/MacTx",
+                                              MakeCallback(&EmuTxTrace));
+        Config::ConnectWithoutContextFailSafe(
+            "/NodeList/*/DeviceList/*/$ns3::FdNetDevice/MacTxDrop",
+            MakeCallback(&EmuTxDropTrace));
+        Config::ConnectWithoutContextFailSafe("/NodeList/*/DeviceList/*/$ns3::FdNetDevice/MacRx",
+                                              MakeCallback(&EmuRxTrace));
+        g_lagFile.open(lagFile);
+        g_lagFile << "Time(s),MeanLag(ms),MaxLag(ms),LateProbes,TxFrames,TxDrops,RxFrames,"
+                     "RxDrops,LateRxFrames\n";
+        Simulator::Schedule(MilliSeconds(lagProbeInterval),
+                            &ProbeLag,
+                            MilliSeconds(lagProbeInterval));
+        Simulator::Schedule(Seconds(1), &FlushBudgetSecond);
+    }
+
     Simulator::Stop(Seconds(simTime));
     Simulator::Run();
 
+    for (const auto& device : g_batchedDevices)
+    {
+        g_budgetSecond.txDrops += device->TakeTxErrors();
+        device->LogIoStats();
+    }
+    for (const auto& device : g_emuDevices)
+    {
+        g_budgetSecond.rxDrops += TakeRxDrops(device);
+    }
+    g_batchedDevices.clear();
+    g_emuDevices.clear();
+
+    if (realtime)
+    {
+        g_budgetTotal.Add(g_budgetSecond);
+        g_lagFile.close();
+        if (!WriteRealtimeReport(realtimeReport, nUesPerEnb, interPacketInterval))
+        {
+            NS_LOG_ERROR("Failed to write " << realtimeReport);
+        }
+        g_realtimeImpl = nullptr;
+    }
+
     Simulator::Destroy();
     return 0;
 }
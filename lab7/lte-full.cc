@@ -3,8 +3,20 @@
  * Modified by: [Your Name]
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "ns3/lte-helper.h"
 #include "ns3/epc-helper.h"
@@ -28,6 +40,98 @@ using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("lte-full-modified");
 
+// Carrier aggregation study: MAC bytes scheduled per component carrier, all eNodeBs summed
+static const uint16_t MAX_CC = 5;
+static uint64_t g_dlCcBytes[MAX_CC] = {0};
+static uint64_t g_ulCcBytes[MAX_CC] = {0};
+
+static void
+CaDlScheduling(DlSchedulingCallbackInfo info)
+{
+  if (info.componentCarrierId < MAX_CC)
+  {
+    g_dlCcBytes[info.componentCarrierId] += info.sizeTb1 + info.sizeTb2;
+  }
+}
+
+static void
+CaUlScheduling(uint32_t /* frameNo */, uint32_t /* subframeNo */, uint16_t /* rnti */,
+               uint8_t /* mcs */, uint16_t tbsSize, uint8_t componentCarrierId)
+{
+  if (componentCarrierId < MAX_CC)
+  {
+    g_ulCcBytes[componentCarrierId] += tbsSize;
+  }
+}
+
+// Runs this program once per (CC manager, CC count) configuration, one child process at a
+// time so that the measured wall time is not shared with other runs. Each child appends its
+// row to caReport.
+static int
+RunCaStudy(int argc, char *argv[], uint16_t caMaxCc, const std::string &caManagers,
+           const std::string &caReport)
+{
+  std::vector<std::string> managers;
+  std::stringstream list(caManagers);
+  for (std::string m; std::getline(list, m, ',');)
+  {
+    if (!m.empty())
+    {
+      managers.push_back(m);
+    }
+  }
+  std::vector<std::string> baseArgs;
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if (arg.rfind("--caStudy", 0) != 0 && arg.rfind("--numberOfCc=", 0) != 0 &&
+        arg.rfind("--ccManager=", 0) != 0 && arg.rfind("--caReport=", 0) != 0)
+    {
+      baseArgs.push_back(arg);
+    }
+  }
+  std::remove(caReport.c_str());
+
+  int failures = 0;
+  for (const std::string &manager : managers)
+  {
+    for (uint16_t cc = 1; cc <= caMaxCc; ++cc)
+    {
+      std::vector<std::string> args = {"/proc/self/exe"};
+      args.insert(args.end(), baseArgs.begin(), baseArgs.end());
+      args.push_back("--useCa=1");
+      args.push_back("--numberOfCc=" + std::to_string(cc));
+      args.push_back("--ccManager=" + manager);
+      args.push_back("--attachMode=nearest");
+      args.push_back("--animMode=off");
+      args.push_back("--caReport=" + caReport);
+      std::cout << "CA study: " << manager << ", " << cc << " CC" << std::endl;
+
+      std::vector<char *> childArgv;
+      for (std::string &a : args)
+      {
+        childArgv.push_back(&a[0]);
+      }
+      childArgv.push_back(nullptr);
+      pid_t pid = fork();
+      if (pid == 0)
+      {
+        execv(childArgv[0], childArgv.data());
+        _exit(127);
+      }
+      int status = 0;
+      if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+          WEXITSTATUS(status) != 0)
+      {
+        std::cerr << "CA study run failed: " << manager << ", " << cc << " CC" << std::endl;
+        ++failures;
+      }
+    }
+  }
+  std::cout << "CA study results stored in " << caReport << std::endl;
+  return failures == 0 ? 0 : 1;
+}
+
 int main(int argc, char *argv[])
 {
   // *** Modification 1: Increased number of eNodeBs and UEs ***
@@ -39,6 +143,35 @@ int main(int argc, char *argv[])
   double interPacketInterval = 100;
   bool useCa = true;               // Carrier Aggregation enabled
 
+  // NetAnim: "full" records every packet with metadata, "lite" records positions every
+  // animPollInterval and packets only in [animPacketStart, animPacketStop), "off" disables it.
+  // NetAnim can only switch packet tracing off, so a window starting after 0 s has to use its
+  // global start time, which also drops the positions recorded before it.
+  std::string animMode = "full";
+  double animPollInterval = 1.0;
+  double animPacketStart = 0.0;
+  double animPacketStop = 0.0;
+  uint64_t animChunkPackets = 100000; // Lite: packets per XML file before rolling over
+
+  // FlowMonitor: "xml" writes lte-full-modified.flowmon with histograms, "csv" writes one
+  // compact line per flow to lte-full-modified.flowmon.csv. The per-flow analysis runs on
+  // analysisThreads threads (0 = all cores).
+  std::string flowmonFormat = "xml";
+  uint32_t analysisThreads = 0;
+
+  // Carrier aggregation: CC count and manager, UE attachment ("rr" round robin or "nearest"
+  // eNodeB) and optional saturating downlink traffic. --caStudy reruns the scenario for
+  // 1..caMaxCc carriers with every manager in caManagers and collects per-CC throughput and
+  // simulator cost in caReport.
+  uint16_t numberOfCc = 2;
+  std::string ccManager = "ns3::RrComponentCarrierManager";
+  std::string attachMode = "rr";
+  double dlRateMbps = 0.0;
+  bool caStudy = false;
+  uint16_t caMaxCc = MAX_CC;
+  std::string caManagers = "ns3::RrComponentCarrierManager,ns3::NoOpComponentCarrierManager";
+  std::string caReport;
+
   // Command line arguments
   CommandLine cmd;
   cmd.AddValue("numberOfNodes", "Number of UE nodes", numberOfNodes);
@@ -47,13 +180,42 @@ int main(int argc, char *argv[])
   cmd.AddValue("distance", "Distance between eNBs [m]", distance);
   cmd.AddValue("interPacketInterval", "Inter packet interval [ms]", interPacketInterval);
   cmd.AddValue("useCa", "Whether to use carrier aggregation.", useCa);
+  cmd.AddValue("animMode", "NetAnim mode: full, lite or off", animMode);
+  cmd.AddValue("animPollInterval", "NetAnim lite: position sampling interval [s]", animPollInterval);
+  cmd.AddValue("animPacketStart", "NetAnim lite: packet window start [s]", animPacketStart);
+  cmd.AddValue("animPacketStop", "NetAnim lite: packet window stop [s]", animPacketStop);
+  cmd.AddValue("animChunkPackets", "NetAnim lite: packets per XML chunk", animChunkPackets);
+  cmd.AddValue("flowmonFormat", "FlowMonitor output: xml or csv", flowmonFormat);
+  cmd.AddValue("analysisThreads", "FlowMonitor analysis threads (0 = all cores)", analysisThreads);
+  cmd.AddValue("numberOfCc", "Component carriers per eNodeB with useCa (1-5)", numberOfCc);
+  cmd.AddValue("ccManager", "eNodeB component carrier manager type", ccManager);
+  cmd.AddValue("attachMode", "UE attachment: rr (round robin) or nearest", attachMode);
+  cmd.AddValue("dlRateMbps", "Extra downlink UDP traffic per UE [Mbps] (0 = none)", dlRateMbps);
+  cmd.AddValue("caStudy", "Sweep CC count and CC manager, one run each", caStudy);
+  cmd.AddValue("caMaxCc", "CA study: largest CC count (1-5)", caMaxCc);
+  cmd.AddValue("caManagers", "CA study: comma-separated CC manager types", caManagers);
+  cmd.AddValue("caReport", "Append per-CC throughput and simulator cost to this CSV", caReport);
   cmd.Parse(argc, argv);
 
+  NS_ABORT_MSG_IF(numberOfCc < 1 || numberOfCc > MAX_CC, "numberOfCc must be 1-" << MAX_CC);
+  NS_ABORT_MSG_IF(caMaxCc < 1 || caMaxCc > MAX_CC, "caMaxCc must be 1-" << MAX_CC);
+  NS_ABORT_MSG_IF(attachMode != "rr" && attachMode != "nearest",
+                  "Unknown attachMode " << attachMode);
+  NS_ABORT_MSG_IF(animMode != "full" && animMode != "lite" && animMode != "off",
+                  "Unknown animMode " << animMode);
+  NS_ABORT_MSG_IF(flowmonFormat != "xml" && flowmonFormat != "csv",
+                  "Unknown flowmonFormat " << flowmonFormat);
+  if (caStudy)
+  {
+    return RunCaStudy(argc, argv, caMaxCc, caManagers,
+                      caReport.empty() ? "ca-study.csv" : caReport);
+  }
+
   if (useCa)
   {
     Config::SetDefault("ns3::LteHelper::UseCa", BooleanValue(useCa));
-    Config::SetDefault("ns3::LteHelper::NumberOfComponentCarriers", UintegerValue(2));
-    Config::SetDefault("ns3::LteHelper::EnbComponentCarrierManager", StringValue("ns3::RrComponentCarrierManager"));
+    Config::SetDefault("ns3::LteHelper::NumberOfComponentCarriers", UintegerValue(numberOfCc));
+    Config::SetDefault("ns3::LteHelper::EnbComponentCarrierManager", StringValue(ccManager));
   }
 
   ConfigStore inputConfig;
@@ -145,10 +307,17 @@ int main(int argc, char *argv[])
     ueStaticRouting->SetDefaultRoute(epcHelper->GetUeDefaultGatewayAddress(), 1);
   }
 
-  // Attach UEs to eNodeBs in a round-robin fashion
-  for (uint16_t i = 0; i < numberOfNodes; i++)
+  // Attach UEs to eNodeBs in a round-robin fashion, or each to its nearest eNodeB
+  if (attachMode == "nearest")
+  {
+    lteHelper->AttachToClosestEnb(ueLteDevs, enbLteDevs);
+  }
+  else
   {
-    lteHelper->Attach(ueLteDevs.Get(i), enbLteDevs.Get(i % numberOf_eNodeBs));
+    for (uint16_t i = 0; i < numberOfNodes; i++)
+    {
+      lteHelper->Attach(ueLteDevs.Get(i), enbLteDevs.Get(i % numberOf_eNodeBs));
+    }
   }
 
   // *** Modification 4: Change traffic pattern to UDP ***
@@ -173,6 +342,34 @@ int main(int argc, char *argv[])
   clientApps.Start(Seconds(2.0));
   clientApps.Stop(Seconds(simTime));
 
+  // Optional saturating downlink: one UDP stream of 1472-byte datagrams per UE
+  if (dlRateMbps > 0)
+  {
+    uint16_t dlPort = 9000;
+    PacketSinkHelper dlSink("ns3::UdpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), dlPort));
+    ApplicationContainer dlApps;
+    for (uint16_t i = 0; i < numberOfNodes; i++)
+    {
+      dlApps.Add(dlSink.Install(ueNodes.Get(i)));
+      UdpClientHelper dlClient(ueIpIface.GetAddress(i), dlPort);
+      dlClient.SetAttribute("MaxPackets", UintegerValue(4294967295u));
+      dlClient.SetAttribute("Interval", TimeValue(Seconds(1472 * 8 / (dlRateMbps * 1e6))));
+      dlClient.SetAttribute("PacketSize", UintegerValue(1472));
+      dlApps.Add(dlClient.Install(remoteHost));
+    }
+    dlApps.Start(Seconds(2.0));
+    dlApps.Stop(Seconds(simTime));
+  }
+
+  // Per-CC scheduled bytes of every eNodeB carrier
+  if (!caReport.empty())
+  {
+    Config::ConnectWithoutContext("/NodeList/*/DeviceList/*/ComponentCarrierMap/*/LteEnbMac/DlScheduling",
+                                  MakeCallback(&CaDlScheduling));
+    Config::ConnectWithoutContext("/NodeList/*/DeviceList/*/ComponentCarrierMap/*/LteEnbMac/UlScheduling",
+                                  MakeCallback(&CaUlScheduling));
+  }
+
   // *** Modification 5: Enable Logging and Tracing ***
   // Enable logging for LTE and EPC modules
   // Note: Uncomment the following lines if you want to enable logging
@@ -183,34 +380,63 @@ int main(int argc, char *argv[])
   p2ph.EnablePcapAll("lte-full-modified");
 
   // Animation definition
-  unsigned long long testValue = 0xFFFFFFFFFFFFFFFF;
-  AnimationInterface anim("lte-full-modified.xml");
-  anim.SetMobilityPollInterval(Seconds(1));
-  anim.EnablePacketMetadata(true);
-  anim.SetMaxPktsPerTraceFile(testValue);
-
-  // Assign positions to PGW and Remote Host
-  AnimationInterface::SetConstantPosition(pgw, -500, 0);
-  AnimationInterface::SetConstantPosition(remoteHost, -600, 0);
-  anim.UpdateNodeDescription(pgw, "PGW");
-  anim.UpdateNodeDescription(remoteHost, "RemoteHost");
-
-  // Update eNodeBs in the animation
-  for (uint32_t e = 0; e < enbNodes.GetN(); ++e)
+  std::unique_ptr<AnimationInterface> anim;
+  if (animMode != "off")
   {
-    Ptr<MobilityModel> mob = enbNodes.Get(e)->GetObject<MobilityModel>();
-    Vector pos = mob->GetPosition();
-    anim.UpdateNodeDescription(enbNodes.Get(e), "eNodeB_" + std::to_string(e));
-    anim.UpdateNodeColor(enbNodes.Get(e), 0, 255, 0); // Green
-    anim.SetConstantPosition(enbNodes.Get(e), pos.x, pos.y);
-  }
-
-  // Update UEs in the animation
-  for (uint32_t u = 0; u < ueNodes.GetN(); ++u)
-  {
-    anim.UpdateNodeDescription(ueNodes.Get(u), "UE_" + std::to_string(u));
-    anim.UpdateNodeColor(ueNodes.Get(u), 0, 0, 255); // Blue
-    // UEs are mobile; positions will be updated automatically
+    anim = std::make_unique<AnimationInterface>("lte-full-modified.xml");
+    if (animMode == "lite")
+    {
+      // Positions for the whole run, packet tracing switched off at the end of the window
+      anim->SetMobilityPollInterval(Seconds(animPollInterval));
+      anim->SetMaxPktsPerTraceFile(animChunkPackets);
+      if (animPacketStop <= animPacketStart)
+      {
+        anim->SkipPacketTracing();
+      }
+      else
+      {
+        if (animPacketStart > 0.0)
+        {
+          NS_LOG_WARN("NetAnim cannot start packet tracing late; positions before "
+                      << animPacketStart << " s are dropped as well");
+          anim->SetStartTime(Seconds(animPacketStart));
+        }
+        Simulator::Schedule(Seconds(animPacketStop),
+                            &AnimationInterface::SkipPacketTracing,
+                            anim.get());
+      }
+    }
+    else
+    {
+      unsigned long long testValue = 0xFFFFFFFFFFFFFFFF;
+      anim->SetMobilityPollInterval(Seconds(1));
+      anim->EnablePacketMetadata(true);
+      anim->SetMaxPktsPerTraceFile(testValue);
+    }
+
+    // Assign positions to PGW and Remote Host
+    AnimationInterface::SetConstantPosition(pgw, -500, 0);
+    AnimationInterface::SetConstantPosition(remoteHost, -600, 0);
+    anim->UpdateNodeDescription(pgw, "PGW");
+    anim->UpdateNodeDescription(remoteHost, "RemoteHost");
+
+    // Update eNodeBs in the animation
+    for (uint32_t e = 0; e < enbNodes.GetN(); ++e)
+    {
+      Ptr<MobilityModel> mob = enbNodes.Get(e)->GetObject<MobilityModel>();
+      Vector pos = mob->GetPosition();
+      anim->UpdateNodeDescription(enbNodes.Get(e), "eNodeB_" + std::to_string(e));
+      anim->UpdateNodeColor(enbNodes.Get(e), 0, 255, 0); // Green
+      anim->SetConstantPosition(enbNodes.Get(e), pos.x, pos.y);
+    }
+
+    // Update UEs in the animation
+    for (uint32_t u = 0; u < ueNodes.GetN(); ++u)
+    {
+      anim->UpdateNodeDescription(ueNodes.Get(u), "UE_" + std::to_string(u));
+      anim->UpdateNodeColor(ueNodes.Get(u), 0, 0, 255); // Blue
+      // UEs are mobile; positions will be updated automatically
+    }
   }
 
   // Flow Monitor setup
@@ -219,7 +445,42 @@ int main(int argc, char *argv[])
   monitor = flowMonHelper.InstallAll();
 
   Simulator::Stop(Seconds(simTime));
+  auto runStart = std::chrono::steady_clock::now();
   Simulator::Run();
+  double runWall = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+
+  // CA report row: configuration, simulator cost and per-CC MAC throughput over simTime
+  if (!caReport.empty())
+  {
+    std::ofstream report(caReport, std::ios::app);
+    if (report.tellp() == 0)
+    {
+      report << "CcManager,NumberOfCc,UEs,eNodeBs,SimTime(s),RunWall(s),Events,EventsPerWallSecond";
+      for (uint16_t cc = 0; cc < MAX_CC; ++cc)
+      {
+        report << ",DlCc" << cc << "(Mbps)";
+      }
+      for (uint16_t cc = 0; cc < MAX_CC; ++cc)
+      {
+        report << ",UlCc" << cc << "(Mbps)";
+      }
+      report << "\n";
+    }
+    uint64_t events = Simulator::GetEventCount();
+    report << (useCa ? ccManager : std::string("none")) << "," << (useCa ? numberOfCc : 1) << ","
+           << numberOfNodes << "," << numberOf_eNodeBs << "," << simTime << "," << runWall << ","
+           << events << "," << events / std::max(runWall, 1e-9);
+    for (uint16_t cc = 0; cc < MAX_CC; ++cc)
+    {
+      report << "," << g_dlCcBytes[cc] * 8.0 / simTime / 1e6;
+    }
+    for (uint16_t cc = 0; cc < MAX_CC; ++cc)
+    {
+      report << "," << g_ulCcBytes[cc] * 8.0 / simTime / 1e6;
+    }
+    report << "\n";
+    std::cout << "Run wall time: " << runWall << " s, " << events << " events" << std::endl;
+  }
 
   // GnuPlot for Delay
   std::string delayFile = "delay-modified";
@@ -255,42 +516,102 @@ int main(int argc, char *argv[])
   monitor->CheckForLostPackets();
   Ptr<Ipv4FlowClassifier> classifier =
       DynamicCast<Ipv4FlowClassifier>(flowMonHelper.GetClassifier());
-  std::map<FlowId, FlowMonitor::FlowStats> stats = monitor->GetFlowStats();
+  const FlowMonitor::FlowStatsContainer &stats = monitor->GetFlowStats();
 
-  monitor->SerializeToXmlFile("lte-full-modified.flowmon", true, true);
+  if (flowmonFormat == "xml")
+  {
+    monitor->SerializeToXmlFile("lte-full-modified.flowmon", true, true);
+  }
+
+  // Per-flow report, plot points and CSV line are built in parallel and emitted in flow order
+  struct FlowReport
+  {
+    FlowId id;
+    const FlowMonitor::FlowStats *flow;
+    std::string text;
+    std::string csv;
+    double delay;
+    double dataRate;
+  };
+  std::vector<FlowReport> reports;
+  reports.reserve(stats.size());
+  for (FlowMonitor::FlowStatsContainer::const_iterator i = stats.begin(); i != stats.end(); ++i)
+  {
+    reports.push_back({i->first, &i->second, "", "", 0.0, 0.0});
+  }
+
+  auto analyzeFlow = [&classifier](FlowReport &r) {
+    const FlowMonitor::FlowStats &f = *r.flow;
+    Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow(r.id);
+    r.delay = (f.delaySum.GetSeconds() / f.rxPackets) * 1000;
+    r.dataRate = f.rxBytes * 8.0 /
+                 (f.timeLastRxPacket.GetSeconds() - f.timeFirstTxPacket.GetSeconds()) / 1024;
+    std::ostringstream out;
+    out << "Flow ID: " << r.id << std::endl;
+    out << "Src Addr: " << t.sourceAddress << " -> Dst Addr: " << t.destinationAddress << std::endl;
+    out << "Src Port: " << t.sourcePort << " -> Dst Port: " << t.destinationPort << std::endl;
+    out << "Tx Packets/Bytes: " << f.txPackets << "/" << f.txBytes << std::endl;
+    out << "Rx Packets/Bytes: " << f.rxPackets << "/" << f.rxBytes << std::endl;
+    out << "Throughput: " << r.dataRate << " kbps" << std::endl;
+    out << "Delay Sum: " << f.delaySum.GetMilliSeconds() << " ms" << std::endl;
+    out << "Mean Delay: " << r.delay << " ms" << std::endl;
+    out << "Jitter Sum: " << f.jitterSum.GetMilliSeconds() << " ms" << std::endl;
+    out << "Mean Jitter: " << (f.jitterSum.GetSeconds() / (f.rxPackets - 1)) * 1000 << " ms"
+        << std::endl;
+    out << "Lost Packets: " << f.txPackets - f.rxPackets << std::endl;
+    out << "Packet Loss: " << (((f.txPackets - f.rxPackets) * 1.0) / f.txPackets) * 100 << "%"
+        << std::endl;
+    out << "------------------------------------------------" << std::endl;
+    r.text = out.str();
+    std::ostringstream line;
+    line << r.id << "," << t.sourceAddress << "," << t.sourcePort << "," << t.destinationAddress
+         << "," << t.destinationPort << "," << (uint32_t) t.protocol << "," << f.txPackets << ","
+         << f.rxPackets << "," << f.txBytes << "," << f.rxBytes << "," << r.dataRate << ","
+         << r.delay << "," << f.txPackets - f.rxPackets << "\n";
+    r.csv = line.str();
+  };
+
+  if (analysisThreads == 0)
+  {
+    analysisThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  analysisThreads = std::min<uint32_t>(analysisThreads, std::max<size_t>(1, reports.size()));
+  std::atomic<size_t> nextFlow(0);
+  auto worker = [&]() {
+    for (size_t k = nextFlow++; k < reports.size(); k = nextFlow++)
+    {
+      analyzeFlow(reports[k]);
+    }
+  };
+  std::vector<std::thread> pool;
+  for (uint32_t w = 1; w < analysisThreads; ++w)
+  {
+    pool.emplace_back(worker);
+  }
+  worker();
+  for (std::thread &th : pool)
+  {
+    th.join();
+  }
+
+  std::ofstream flowmonCsv;
+  if (flowmonFormat == "csv")
+  {
+    flowmonCsv.open("lte-full-modified.flowmon.csv");
+    flowmonCsv << "FlowId,SrcAddr,SrcPort,DstAddr,DstPort,Protocol,TxPackets,RxPackets,"
+                  "TxBytes,RxBytes,Throughput(kbps),MeanDelay(ms),LostPackets\n";
+  }
 
   std::cout << std::endl << "*** Flow monitor statistics ***" << std::endl;
-  for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator i = stats.begin(); i != stats.end(); ++i)
+  for (const FlowReport &r : reports)
   {
-    double Delay, DataRate;
-    Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow(i->first);
-    std::cout << "Flow ID: " << i->first << std::endl;
-    std::cout << "Src Addr: " << t.sourceAddress << " -> Dst Addr: " << t.destinationAddress << std::endl;
-    std::cout << "Src Port: " << t.sourcePort << " -> Dst Port: " << t.destinationPort << std::endl;
-    std::cout << "Tx Packets/Bytes: " << i->second.txPackets << "/" << i->second.txBytes << std::endl;
-    std::cout << "Rx Packets/Bytes: " << i->second.rxPackets << "/" << i->second.rxBytes << std::endl;
-    std::cout << "Throughput: "
-              << i->second.rxBytes * 8.0 /
-                     (i->second.timeLastRxPacket.GetSeconds() - i->second.timeFirstTxPacket.GetSeconds()) / 1024
-              << " kbps" << std::endl;
-    std::cout << "Delay Sum: " << i->second.delaySum.GetMilliSeconds() << " ms" << std::endl;
-    std::cout << "Mean Delay: " << (i->second.delaySum.GetSeconds() / i->second.rxPackets) * 1000 << " ms" << std::endl;
-
-    // Gnuplot Delay
-    Delay = (i->second.delaySum.GetSeconds() / i->second.rxPackets) * 1000;
-    DataRate = i->second.rxBytes * 8.0 /
-               (i->second.timeLastRxPacket.GetSeconds() - i->second.timeFirstTxPacket.GetSeconds()) / 1024;
-
-    dataset_delay.Add((double)i->first, (double)Delay);
-    dataset_rate.Add((double)i->first, (double)DataRate);
-
-    std::cout << "Jitter Sum: " << i->second.jitterSum.GetMilliSeconds() << " ms" << std::endl;
-    std::cout << "Mean Jitter: "
-              << (i->second.jitterSum.GetSeconds() / (i->second.rxPackets - 1)) * 1000 << " ms" << std::endl;
-    std::cout << "Lost Packets: " << i->second.txPackets - i->second.rxPackets << std::endl;
-    std::cout << "Packet Loss: "
-              << (((i->second.txPackets - i->second.rxPackets) * 1.0) / i->second.txPackets) * 100 << "%" << std::endl;
-    std::cout << "------------------------------------------------" << std::endl;
+    std::cout << r.text;
+    dataset_delay.Add((double) r.id, r.delay);
+    dataset_rate.Add((double) r.id, r.dataRate);
+    if (flowmonCsv.is_open())
+    {
+      flowmonCsv << r.csv;
+    }
   }
 
   // Gnuplot - Delay
@@ -7,17 +7,65 @@
  * Features:
  * - LTE + VoIP simulation using ns-3 LTE module (LENA).
  * - Multiple eNodeBs and UEs with configurable positions and mobility.
- * - VoIP traffic generated using OnOff applications with configurable codecs.
- * - Path loss modeled using ThreeLogDistancePropagationLossModel.
+ * - VoIP calls with configurable codecs: one VoipCallApplication per UE, constant rate or
+ *   ITU-T P.59 talkspurts (--voipActivity), optionally bidirectional (--voipBidirectional),
+ *   all multiplexed onto a single VoipMuxServer socket on the remote host.
+ * - Path loss modeled using the three-log-distance model, by default through a batched
+ *   UE x eNodeB implementation with a per-UE cache (--pathlossModel=batched|ns3).
  * - Handover simulated using A3-RSRP algorithm with hysteresis and Time-To-Trigger.
- * - Per-UE metrics tracked: throughput, latency, packet loss, jitter.
+ * - Per-UE metrics tracked: throughput, latency, packet loss, jitter (RFC 3550), collected
+ *   from timestamp-tagged packets received by the remote host's VoipMuxServer.
+ * - Tail metrics: p95/p99 latency and jitter from fixed-size streaming histograms, in the
+ *   periodic samples and per UE at the end, plus an E-model MOS estimate per codec.
+ * - UE trajectory sampling (ue_trajectory.bin, --trajectoryMode=none|changes|interval):
+ *   binary position/velocity records of the UEs whose course changed since the last sample,
+ *   or of all UEs, every trajectoryInterval.
  * - Handover metrics tracked: handover starts, successes, failures.
+ * - Per-cell metrics (cell_metrics.csv, --enableCellMetrics): attached and active UEs,
+ *   throughput, latency and handovers in/out per cell and statsInterval, with the serving
+ *   cell of each UE tracked in a flat IMSI -> cell array.
  * - Aggregated metrics tracked: average throughput, latency.
+ * - Live run status (--statusFile, --statusPort): events, simulated time, unacknowledged
+ *   packets (sent minus received so far), handovers, RSS and sampler cost as a JSON file
+ *   or an HTTP/Prometheus endpoint.
+ * - Adaptive statistics sampling (--statsMode=adaptive): dense samples around handovers and
+ *   loss bursts, backing off to statsIntervalMax in steady state; samples carry their time.
  * - Outputs:
- *   - Gnuplot graphs for throughput, latency, average throughput, RSRP, and RSRQ.
+ *   - Gnuplot scripts for throughput, latency and average throughput, plotting the metrics
+ *     CSV directly; with the per-UE CSV and summary they form the final report, written in a
+ *     single pass and skipped with --enableReport=0 (the default for sweep runs).
  *   - CSV export of metrics over time.
- *   - FlowMonitor XML output for detailed analysis.
+ *   - Optional FlowMonitor output (--enableFlowMonitor): the full XML, or a binary file or
+ *     per-shard CSV chunks built by a post-run thread pool (--flowMonitorFormat,
+ *     --analysisThreads).
  *   - NetAnim XML visualization.
+ * - NetAnim lite mode (--animMode=lite): coarse position sampling, serving-cell annotations
+ *   on attach/handover, packets only inside a time window, output in rolling chunks.
+ * - LTE trace profiles (--traceProfile=none|kpi|rlc-pdcp|full) with per-layer decimation
+ *   and UE-subset filtering.
+ * - eNodeB layouts (--enbLayout=auto|hex|file): hex grids with configurable inter-site
+ *   distance, optional tri-sector sites (--triSector), or a site list read from a file.
+ * - No MPI mode: every eNodeB and UE shares one LTE spectrum channel, which ns-3 cannot
+ *   distribute across ranks, and the EPC helper builds its S1/X2 links with no rank
+ *   assignment, so the simulation always runs in one process.
+ * - Topology layout files (--topologySave/--topologyLoad): the initial UE positions and the
+ *   attach map written to a text file and reused by later runs with the same layout. A
+ *   loaded run skips the UE placement and the nearest-eNodeB search and starts each call as
+ *   soon as its UE's default bearer is set up instead of after the fixed 1 s warm-up, so a
+ *   correspondingly shorter simTime covers the same call time. ns-3 cannot checkpoint
+ *   device or RRC state, so devices, attachment, addressing and routing are still built.
+ * - Runtime MAC scheduler selection (--scheduler) with an optional per-cell profile of the
+ *   scheduler's DL/UL cost and RB allocation per TTI (--schedulerProfile=summary|tti).
+ * - Every SimulationParameters knob is a command-line option; --config reads them from an INI
+ *   or flat JSON file (the command line overrides it), and --configStoreIn/--configStoreOut
+ *   load and save ns-3 attribute values through ConfigStore.
+ * - Sweep mode (--sweep): runs a codec x bandwidth x scheduler x mobility x numUe x RngRun
+ *   grid as parallel child processes and merges their metrics into sweep_results.csv.
+ *   Runs draw every random value from fixed ns-3 RNG streams keyed by RngRun, so they are
+ *   reproducible and --sweepResume reuses the runs already completed with the same arguments.
+ * - Benchmark mode (--benchmark): runs a fixed numUe x numEnb x feature matrix and reports
+ *   wall-clock, simulated seconds per wall second, events per second and peak RSS in
+ *   benchmark_results.csv.
  *
  * @authors
  *   Martin Szuc <matoszuc@gmail.com>
@@ -28,21 +76,43 @@
 #include "ns3/config-store-module.h"
 #include "ns3/core-module.h"
 #include "ns3/flow-monitor-module.h"
-#include "ns3/gnuplot.h"
 #include "ns3/internet-module.h"
 #include "ns3/log.h"
 #include "ns3/lte-module.h"
 #include "ns3/mobility-module.h"
 #include "ns3/network-module.h"
-#include "ns3/packet-sink-helper.h"
 #include "ns3/point-to-point-module.h"
-
+#include "ns3/propagation-module.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
 #include <fstream>
+#include <functional>
 #include <limits>
 #include <map>
-#include <random>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sstream>
 #include <string>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 using namespace ns3;
@@ -61,15 +131,33 @@ struct SimulationParameters
     double simTime = 20.0;   ///< Simulation time in seconds
     double areaSize = 200.0; ///< Size of the simulation area (square in meters)
 
+    // eNodeB Layout Configuration
+    std::string enbLayout = "auto"; ///< "auto" (2/4-cell layouts, hex otherwise), "hex", "file"
+    double interSiteDistance = 0.0; ///< Hex inter-site distance in meters (0 = areaSize / 2)
+    bool triSector = false;         ///< Split every site into three 120-degree sectors
+    std::string enbSiteFile;        ///< Site list for the "file" layout: "x y [z [azimuth]]"
+    double enbHeight = 30.0;        ///< eNodeB antenna height in meters (when not in the file)
+    std::string topologySave;       ///< Write the topology layout file to this path
+    std::string topologyLoad;       ///< Take UE positions and attach map from this layout file
+
     // Path Loss Model Parameters
     double distance0 = 50.0;  ///< First distance threshold in meters
     double distance1 = 100.0; ///< Second distance threshold in meters
     double exponent0 = 1.7;   ///< Path loss exponent before distance0
     double exponent1 = 2.5;   ///< Path loss exponent between distance0 and distance1
     double exponent2 = 3.2;   ///< Path loss exponent beyond distance1
+    std::string pathlossModel = "batched"; ///< "batched" (BatchedThreeLogDistanceLossModel) or
+                                           ///< "ns3" (ThreeLogDistancePropagationLossModel)
+
+    // Handover Configuration
+    double handoverHysteresis = 3.0;      ///< A3 handover hysteresis in dB
+    double handoverTimeToTrigger = 256.0; ///< A3 handover Time-To-Trigger in ms
 
-    static constexpr double HANDOVER_HYSTERESIS = 3.0;      ///< Handover hysteresis in dB
-    static constexpr double HANDOVER_TimeToTrigger = 256.0; ///< Handover Time-To-Trigger in ms
+    // VoIP Call Model
+    std::string voipActivity = "constant"; ///< "constant" (always on) or "p59" (talkspurts)
+    double talkspurtMean = 1.004;          ///< Mean talkspurt duration in seconds (ITU-T P.59)
+    double silenceMean = 1.587;            ///< Mean silence duration in seconds (ITU-T P.59)
+    bool voipBidirectional = false;        ///< Also send a downlink stream per call
 
     // LTE Bandwidth Configuration
     uint16_t lteBandwidth = 1; ///< LTE Bandwidth in MHz
@@ -88,9 +176,49 @@ struct SimulationParameters
      */
     std::map<uint16_t, std::pair<uint16_t, uint16_t>> lteBandwidthMap;
 
+    // MAC Scheduler Configuration
+    std::string scheduler = "rr";          ///< Short name (see SchedulerTypeName) or ns-3 TypeId
+    std::string schedulerProfile = "none"; ///< Scheduler profiling: "none", "summary" or "tti"
+
     // Animation and Monitoring
-    bool enableNetAnim = true;  ///< Enable NetAnim output
-    double statsInterval = 0.1; ///< Interval for statistics collection in seconds
+    bool enableNetAnim = true;          ///< Enable NetAnim output
+    std::string animMode = "full";      ///< NetAnim: "full" (every packet) or "lite"
+    double animPollInterval = 1.0;      ///< Lite: node position sampling interval in seconds
+    double animPacketStart = 0.0;       ///< Lite: start of the packet-recording window [s]
+    double animPacketStop = 0.0;        ///< Lite: end of the window (<= start: no packets)
+    uint64_t animChunkPackets = 100000; ///< Lite: packets per XML chunk before rolling over
+    double statsInterval = 0.1;         ///< Interval for statistics collection in seconds
+    std::string statsMode = "fixed";    ///< "fixed" (every statsInterval) or "adaptive"
+    double statsIntervalMax = 2.0;      ///< Adaptive: coarsest steady-state interval [s]
+    double statsLossThreshold = 1.0;    ///< Adaptive: interval loss [%] treated as a burst
+    double metricsFlushInterval = 1.0;  ///< Simulated seconds between metrics file flushes
+    std::string metricsFormat = "csv";  ///< Metrics file format: "csv" or "binary"
+    bool enableFlowMonitor = false;     ///< FlowMonitor on the flow endpoints (flowmon.xml)
+    std::string flowMonitorFormat = "xml"; ///< FlowMonitor output: "xml", "binary" or "csv"
+    uint32_t flowMonitorChunk = 1000;      ///< Flows per analysis shard and CSV chunk file
+    uint32_t analysisThreads = 0;          ///< Post-run analysis threads (0 = all cores)
+    bool enableCellMetrics = true;      ///< Per-cell KPIs every statsInterval (cell_metrics.csv)
+    std::string perfReport;             ///< Simulator performance summary file (empty = none)
+    bool logRrc = false;                ///< Log LteEnbRrc/LteUeRrc at INFO level
+    std::string statusFile;             ///< Live JSON status file (empty = none)
+    double statusInterval = 5.0;        ///< Wall seconds between status file updates
+    uint16_t statusPort = 0;            ///< Live HTTP status port on 127.0.0.1 (0 = none)
+    bool enableReport = true;           ///< Final report: per-UE CSV, Gnuplot scripts, summary
+
+    // UE Trajectory Sampling
+    std::string trajectoryMode = "changes"; ///< "none", "changes" or "interval"
+    double trajectoryInterval = 1.0;        ///< Sampling interval in seconds
+
+    // Configuration Files
+    std::string configFile;     ///< INI or JSON file of option values, applied before argv
+    std::string configStoreIn;  ///< ConfigStore file of ns-3 attribute values to load
+    std::string configStoreOut; ///< ConfigStore file the attribute values are saved to
+
+    // LTE Trace Configuration
+    std::string traceProfile = "full"; ///< LTE traces: "none", "kpi", "rlc-pdcp" or "full"
+    uint32_t traceDecimation = 1;      ///< Keep every Nth PHY report / MAC TTI (1 = all)
+    double traceEpoch = 0.25;          ///< RLC/PDCP statistics aggregation epoch in seconds
+    std::string traceUes;              ///< Comma-separated traced UE indices (empty = all)
 
     /**
      * @brief Enum for different mobility modes.
@@ -116,25 +244,32 @@ struct SimulationParameters
                            {15, {75, 75}},
                            {20, {100, 100}}};
 
-        // Initialize VoIP codec (default: G.711)
-        codec.name = "G.711";
-        codec.bitrate = 64.0;  // kbps
-        codec.packetSize = 80; // bytes
-
-        // // G.722.2
-        // codec.name = "G.722.2";
-        // codec.bitrate = 25.84;
-        // codec.packetSize = 60;
+        // Initialize VoIP codec table (bitrate in kbps, packet size in bytes, then the E-model
+        // Ie / Bpl values of ITU-T G.113 and the codec lookahead in ms). G.722.2 is wideband;
+        // its values are approximated on the narrowband E-model scale.
+        codecMap = {{"G.711", {"G.711", 64.0, 80, 0.0, 25.1, 0.0}},
+                    {"G.722.2", {"G.722.2", 25.84, 60, 0.0, 10.0, 5.0}},
+                    {"G.723.1", {"G.723.1", 6.3, 24, 15.0, 16.1, 7.5}},
+                    {"G.729", {"G.729", 8.0, 10, 11.0, 19.0, 5.0}}};
 
-        // // G.723.1
-        // codec.name = "G.723.1";
-        // codec.bitrate = 6.3;
-        // codec.packetSize = 24;
+        // Default VoIP codec: G.711
+        codec = codecMap.at("G.711");
+    }
 
-        // // G.729
-        // codec.name = "G.729";
-        // codec.bitrate = 8.0;
-        // codec.packetSize = 10;
+    /**
+     * @brief Selects the active VoIP codec by name.
+     * @param name Codec name as listed in codecMap (e.g. "G.729").
+     * @return true if the codec is known, false otherwise (codec left unchanged).
+     */
+    bool SelectCodec(const std::string& name)
+    {
+        auto codecIt = codecMap.find(name);
+        if (codecIt == codecMap.end())
+        {
+            return false;
+        }
+        codec = codecIt->second;
+        return true;
     }
 
     // VoIP Codec Parameters
@@ -143,1189 +278,6608 @@ struct SimulationParameters
         std::string name;    ///< Codec name
         double bitrate;      ///< Bitrate in kbps
         uint32_t packetSize; ///< Packet size in bytes
+        double ie;           ///< E-model equipment impairment factor
+        double bpl;          ///< E-model packet-loss robustness factor
+        double lookaheadMs;  ///< Codec algorithmic lookahead in ms
     } codec;
-};
-
-// Global Variables for Time-Plot Data
-static double g_currentTime = 0.0;
-std::vector<double> g_timePlot;
-std::vector<std::vector<double>> g_ueThroughputPlot;
-std::vector<std::vector<double>> g_uePacketLossPlot;
-std::vector<std::vector<double>> g_ueJitterPlot;
-std::vector<double> g_avgLatencyPlot;
-std::vector<double> g_avgThroughputPlot;
 
-// Flow Statistics Tracking
-std::map<FlowId, uint64_t> g_previousRxBytes;
-std::map<FlowId, Time> g_previousDelaySum;
-std::map<FlowId, Time> g_previousJitterSum;
-std::map<FlowId, uint64_t> g_previousRxPackets;
-std::map<FlowId, uint32_t> g_flowIdToUeIndex;
-
-// Handover Logging Variables
-std::ofstream handoverLogFile;
-uint32_t g_handoverStartCount = 0;
-uint32_t g_handoverSuccessCount = 0;
-uint32_t g_handoverFailureCount = 0;
-std::vector<uint32_t> g_handoverStartPlot;
-std::vector<uint32_t> g_handoverSuccessPlot;
-std::vector<uint32_t> g_handoverFailurePlot;
-
-// Function Prototypes
-void ConfigureLogging();
-void ConfigureEnbMobility(NodeContainer& enbNodes, double areaSize);
-void ConfigureUeMobility(NodeContainer& ueNodes,
-                         double areaSize,
-                         NodeContainer& enbNodes,
-                         SimulationParameters::MobilityMode mobilityMode,
-                         const SimulationParameters& params);
-Ipv4Address CreateRemoteHost(Ptr<PointToPointEpcHelper> epcHelper,
-                             NodeContainer& remoteHostContainer,
-                             double areaSize);
-void InstallVoipApplications(NodeContainer& ueNodes,
-                             Ipv4Address remoteAddr,
-                             double simTime,
-                             NodeContainer& remoteHostContainer,
-                             const SimulationParameters& params);
-Ptr<FlowMonitor> SetupFlowMonitor(FlowMonitorHelper& flowHelper);
-void EnableLteTraces(Ptr<LteHelper> lteHelper);
-void PeriodicStatsUpdate(Ptr<FlowMonitor> flowMonitor,
-                         FlowMonitorHelper& flowHelper,
-                         const SimulationParameters& params);
-void LogAllNodePositions();
-void AnalyzeData(FlowMonitorHelper& flowHelper,
-                 Ptr<FlowMonitor> flowMonitor,
-                 const SimulationParameters& params,
-                 Ipv4Address remoteHostAddr,
-                 const std::vector<Ipv4Address>& ueAddresses);
+    std::map<std::string, VoipCodec> codecMap; ///< Supported VoIP codecs keyed by name
+};
 
-// Handover Callback Functions
-void
-HandoverStartCallback(uint64_t imsi, uint16_t cellId, uint16_t targetCellId, unsigned short reason)
+/**
+ * @struct SweepParameters
+ * @brief Parameter grid for the multi-process sweep mode.
+ *
+ * Each list is comma-separated; an empty list keeps the single-run value from
+ * SimulationParameters. RngRun lists also accept inclusive ranges such as "1-10".
+ * Every grid point runs as an independent child process in its own directory.
+ */
+struct SweepParameters
 {
-    Time currentTime = Simulator::Now();
-    g_handoverStartCount++;
-    handoverLogFile << "Handover Start: IMSI=" << imsi << ", from Cell=" << cellId
-                    << " to Cell=" << targetCellId << " Reason=" << reason
-                    << " at Time=" << currentTime.GetMilliSeconds() << "ms" << std::endl;
-}
+    bool enabled = false;                     ///< Act as sweep driver instead of simulating
+    std::string codecs;                       ///< Codec names, e.g. "G.711,G.729"
+    std::string lteBandwidths;                ///< LTE bandwidths in MHz, e.g. "1,5,20"
+    std::string schedulers;                   ///< MAC schedulers, e.g. "rr,pf,tdbet"
+    std::string mobilityModes;                ///< Mobility modes, e.g. "0,1,2,3"
+    std::string numUes;                       ///< UE counts, e.g. "5,10,20"
+    std::string runs = "1";                   ///< RngRun values, e.g. "1-10"
+    uint32_t jobs = 0;                        ///< Max concurrent runs (0 = all cores)
+    bool reports = false;                     ///< Keep the per-run final report (enableReport)
+    bool resume = false;                      ///< Skip runs already completed with same args
+    std::string outputDir = "sweep-results"; ///< Root directory for per-run outputs
+};
 
-void
-HandoverSuccessCallback(uint64_t imsi,
-                        uint16_t cellId,
-                        uint16_t targetCellId,
-                        unsigned short reason)
+/**
+ * @struct BenchmarkParameters
+ * @brief Options of the scaling benchmark driver.
+ *
+ * The benchmark runs a fixed matrix of scenario scales (numUe x numEnb) and feature
+ * variants (FlowMonitor, LTE traces, NetAnim) one at a time, so runs do not compete for
+ * cores or memory bandwidth, and collects each run's performance summary.
+ */
+struct BenchmarkParameters
 {
-    Time currentTime = Simulator::Now();
-    g_handoverSuccessCount++;
-    handoverLogFile << "Handover Success: IMSI=" << imsi << ", to Cell=" << targetCellId
-                    << " Reason=" << reason << " at Time=" << currentTime.GetMilliSeconds() << "ms"
-                    << std::endl;
-}
+    bool enabled = false;                         ///< Act as benchmark driver
+    uint32_t maxUe = 5000;                        ///< Skip scales with more UEs than this
+    double simTime = 10.0;                        ///< Simulated seconds per benchmark run
+    std::string outputDir = "benchmark-results"; ///< Root directory for per-run outputs
+};
 
-void
-HandoverFailureCallback(uint64_t imsi,
-                        uint16_t cellId,
-                        uint16_t targetCellId,
-                        unsigned short reason)
+/**
+ * @struct EnbCell
+ * @brief One eNodeB (cell) produced by the layout generator.
+ *
+ * Sectors of a site are stored contiguously, so the first sector of a cell's site is at
+ * index (cell index - sectorIndex).
+ */
+struct EnbCell
 {
-    Time currentTime = Simulator::Now();
-    g_handoverFailureCount++;
-    handoverLogFile << "Handover Failure: IMSI=" << imsi << ", from Cell=" << cellId
-                    << " to Cell=" << targetCellId << " Reason=" << reason
-                    << " at Time=" << currentTime.GetMilliSeconds() << "ms" << std::endl;
-}
+    Vector position;      ///< Antenna position
+    bool sectorized;      ///< Directional (parabolic) antenna instead of isotropic
+    double azimuth;       ///< Boresight in degrees, counter-clockwise from +X (if sectorized)
+    uint16_t sectorIndex; ///< Sector within the site
+    uint16_t siteSectors; ///< Number of sectors of the site
+};
 
-// ============================================================================
 /**
- * @brief The main function that sets up and runs the simulation.
+ * @struct LatencyQuantiles
+ * @brief Tail latency and jitter of one sample interval, across all UEs.
  */
-int
-main(int argc, char* argv[])
+struct LatencyQuantiles
 {
-    // Initialize simulation parameters
-    SimulationParameters params;
-
-    // Optionally, parse command-line arguments to override defaults
-    CommandLine cmd;
-    cmd.Parse(argc, argv);
-
-    // Initialize data vectors for UEs
-    g_ueThroughputPlot.resize(params.numUe, std::vector<double>());
-    g_uePacketLossPlot.resize(params.numUe, std::vector<double>());
-    g_ueJitterPlot.resize(params.numUe, std::vector<double>());
-    g_avgThroughputPlot.resize(0);
+    double p95LatencyMs = 0.0; ///< 95th percentile one-way delay
+    double p99LatencyMs = 0.0; ///< 99th percentile one-way delay
+    double p95JitterMs = 0.0;  ///< 95th percentile delay variation
+    double p99JitterMs = 0.0;  ///< 99th percentile delay variation
+};
 
-    // Enable logging
-    ConfigureLogging();
+/**
+ * @struct TopologySnapshot
+ * @brief Contents of a topology layout file.
+ *
+ * A plain layout: the eNodeB cells, the initial UE positions and the serving cell chosen
+ * for every UE. Loading it replaces the UE placement and the nearest-eNodeB search, and
+ * the calls start on bearer setup rather than at 1 s (see InstallVoipApplications); the
+ * ns-3 objects (devices, RRC attach, addresses, routes) are still built from scratch. The
+ * cells are kept to check that the file matches the run's own eNodeB layout.
+ */
+struct TopologySnapshot
+{
+    uint16_t numUe = 0;                ///< Number of UEs
+    uint16_t mobilityMode = 0;         ///< SimulationParameters::MobilityMode of the run
+    double areaSize = 0.0;             ///< Simulation area side in meters
+    uint16_t numEnb = 0;               ///< Number of eNodeB sites
+    std::vector<EnbCell> cells;        ///< eNodeB cells, in node order
+    std::vector<Vector> uePositions;   ///< Initial UE positions, in node order
+    std::vector<uint32_t> ueAttachEnb; ///< Serving eNodeB index per UE
+};
 
-    // Open the handover log file
-    handoverLogFile.open("handover_events.log", std::ios::out | std::ios::trunc);
-    if (!handoverLogFile.is_open())
+/**
+ * @class MetricsStreamWriter
+ * @brief Appends each periodic sample to the metrics file as it is taken.
+ *
+ * Two output formats share one column set:
+ * - CSV (simulation_metrics.csv): one text row per sample, flushed every flushInterval of
+ *   simulated time.
+ * - BINARY (simulation_metrics.bin): little-endian float32 columns grouped in fixed-size
+ *   blocks of blockRows samples, written whenever a block fills up (and padded at Close),
+ *   so the file can be memory-mapped and sliced without parsing.
+ *
+ * Either way memory stays O(numUe) regardless of run length, and a killed or crashed run
+ * still leaves every sample up to the last flush on disk.
+ *
+ * Column layout (1-based, as used by the gnuplot scripts):
+ * | Column                        | Content                          |
+ * |-------------------------------|----------------------------------|
+ * | 1                             | Time(s)                          |
+ * | 2                             | Avg_Throughput(Kbps)             |
+ * | 3 .. 2+numUe                  | UE<i>_Throughput(Kbps)           |
+ * | 3+numUe                       | Avg_Latency(ms)                  |
+ * | 4+numUe .. 3+2*numUe          | UE<i>_PacketLoss(%)              |
+ * | 4+2*numUe .. 3+3*numUe        | UE<i>_Jitter(ms)                 |
+ * | 4+3*numUe .. 6+3*numUe        | Handover Start/Success/Failure   |
+ * | 7+3*numUe .. 10+3*numUe       | P95/P99_Latency, P95/P99_Jitter  |
+ *
+ * Binary layout:
+ * | Offset         | Content                                                        |
+ * |----------------|----------------------------------------------------------------|
+ * | 0              | magic "KPMMET01"                                               |
+ * | 8              | uint32 headerSize, numColumns, blockRows, reserved             |
+ * | 24             | numColumns x (uint16 nameLength, name bytes)                   |
+ * | headerSize     | blocks: uint32 rows, uint32 reserved, float32[numColumns][blockRows] |
+ *
+ * headerSize is a multiple of 64. In numpy a file maps as
+ * np.memmap(path, offset=headerSize, dtype=[("rows", "<u4"), ("pad", "<u4"),
+ * ("data", "<f4", (numColumns, blockRows))]).
+ */
+class MetricsStreamWriter
+{
+  public:
+    /**
+     * @brief Output file format.
+     */
+    enum Format
     {
-        NS_LOG_ERROR("Failed to open handover_events.log for writing.");
-        return 1;
-    }
-
-    // Create nodes
-    NodeContainer enbNodes, ueNodes, remoteHostContainer;
-    enbNodes.Create(params.numEnb); // eNB nodes
-    ueNodes.Create(params.numUe);   // UE nodes
-    remoteHostContainer.Create(1);  // Remote Host
-
-    // LTE and EPC Helpers
-    Ptr<LteHelper> lteHelper = CreateObject<LteHelper>();
-    Ptr<PointToPointEpcHelper> epcHelper = CreateObject<PointToPointEpcHelper>();
-    lteHelper->SetEpcHelper(epcHelper);
+        CSV = 0,   ///< Comma-separated text rows
+        BINARY = 1 ///< Block-columnar little-endian float32
+    };
 
-    // Configure Path Loss Model
-    lteHelper->SetPathlossModelType(
-        TypeId::LookupByName("ns3::ThreeLogDistancePropagationLossModel"));
-    lteHelper->SetPathlossModelAttribute("Distance0", DoubleValue(params.distance0));
-    lteHelper->SetPathlossModelAttribute("Distance1", DoubleValue(params.distance1));
-    lteHelper->SetPathlossModelAttribute("Exponent0", DoubleValue(params.exponent0));
-    lteHelper->SetPathlossModelAttribute("Exponent1", DoubleValue(params.exponent1));
-    lteHelper->SetPathlossModelAttribute("Exponent2", DoubleValue(params.exponent2));
-
-    // LTE Bandwidth Configuration using Bandwidth Map
-    uint16_t dlBandwidth; // Downlink Bandwidth in RBs
-    uint16_t ulBandwidth; // Uplink Bandwidth in RBs
-
-    auto it = params.lteBandwidthMap.find(params.lteBandwidth);
-    if (it != params.lteBandwidthMap.end())
-    {
-        dlBandwidth = it->second.first;
-        ulBandwidth = it->second.second;
-    }
-    else
+    /**
+     * @brief Opens the output file and writes the header.
+     * @param path Output file path.
+     * @param numUe Number of UEs (fixes the column layout).
+     * @param flushInterval Simulated time between forced CSV flushes in seconds.
+     * @param format Output file format.
+     * @param blockRows Samples per column block in BINARY format.
+     * @return true on success.
+     */
+    bool Open(const std::string& path,
+              uint32_t numUe,
+              double flushInterval,
+              Format format = CSV,
+              uint32_t blockRows = 64)
     {
-        NS_LOG_WARN("Unsupported LTE bandwidth: " << params.lteBandwidth
-                                                  << " MHz. Defaulting to 20 MHz.");
-        auto defaultIt = params.lteBandwidthMap.find(20);
-        if (defaultIt != params.lteBandwidthMap.end())
+        m_numUe = numUe;
+        m_flushInterval = flushInterval;
+        m_lastFlushTime = 0.0;
+        m_format = format;
+        m_blockRows = std::max(1u, blockRows);
+        m_blockFill = 0;
+
+        m_columns = {"Time(s)", "Avg_Throughput(Kbps)"};
+        for (uint32_t ueIndex = 0; ueIndex < m_numUe; ueIndex++)
         {
-            dlBandwidth = defaultIt->second.first;
-            ulBandwidth = defaultIt->second.second;
+            m_columns.push_back("UE" + std::to_string(ueIndex) + "_Throughput(Kbps)");
+        }
+        m_columns.push_back("Avg_Latency(ms)");
+        for (uint32_t ueIndex = 0; ueIndex < m_numUe; ueIndex++)
+        {
+            m_columns.push_back("UE" + std::to_string(ueIndex) + "_PacketLoss(%)");
+        }
+        for (uint32_t ueIndex = 0; ueIndex < m_numUe; ueIndex++)
+        {
+            m_columns.push_back("UE" + std::to_string(ueIndex) + "_Jitter(ms)");
+        }
+        m_columns.push_back("Handover_Start_Count");
+        m_columns.push_back("Handover_Success_Count");
+        m_columns.push_back("Handover_Failure_Count");
+        m_columns.push_back("P95_Latency(ms)");
+        m_columns.push_back("P99_Latency(ms)");
+        m_columns.push_back("P95_Jitter(ms)");
+        m_columns.push_back("P99_Jitter(ms)");
+
+        m_buffer.resize(1 << 20);
+        m_file.rdbuf()->pubsetbuf(m_buffer.data(), m_buffer.size());
+        std::ios::openmode mode = std::ios::out | std::ios::trunc;
+        if (m_format == BINARY)
+        {
+            mode |= std::ios::binary;
+        }
+        m_file.open(path, mode);
+        if (!m_file.is_open())
+        {
+            return false;
+        }
+
+        if (m_format == BINARY)
+        {
+            WriteBinaryHeader();
+            m_block.assign(m_columns.size() * m_blockRows, 0.0f);
         }
         else
         {
-            NS_LOG_ERROR("Default LTE bandwidth not found in bandwidth map.");
-            return 1;
+            for (size_t col = 0; col < m_columns.size(); ++col)
+            {
+                m_file << (col ? "," : "") << m_columns[col];
+            }
+            m_file << "\n";
         }
+        m_file.flush();
+        return true;
     }
 
-    lteHelper->SetEnbDeviceAttribute("DlBandwidth", UintegerValue(dlBandwidth));
-    lteHelper->SetEnbDeviceAttribute("UlBandwidth", UintegerValue(ulBandwidth));
-
-    // LTE Scheduler Configuration
-    lteHelper->SetSchedulerType("ns3::RrFfMacScheduler");
-    // lteHelper->SetSchedulerType("ns3::PfFfMacScheduler");
-    // lteHelper->SetSchedulerType("ns3::TdBetFfMacScheduler");
+    /**
+     * @brief Appends one sample row.
+     * @param time Sample time in seconds.
+     * @param avgThroughputKbps Average throughput across UEs.
+     * @param ueThroughputKbps Per-UE throughput.
+     * @param avgLatencyMs Average latency across received packets.
+     * @param uePacketLossRate Per-UE packet loss in percent.
+     * @param ueJitterMs Per-UE jitter.
+     * @param handoverStarts Handover starts during the interval.
+     * @param handoverSuccesses Handover successes during the interval.
+     * @param handoverFailures Handover failures during the interval.
+     * @param quantiles Tail latency and jitter during the interval.
+     */
+    void WriteSample(double time,
+                     double avgThroughputKbps,
+                     const std::vector<double>& ueThroughputKbps,
+                     double avgLatencyMs,
+                     const std::vector<double>& uePacketLossRate,
+                     const std::vector<double>& ueJitterMs,
+                     uint32_t handoverStarts,
+                     uint32_t handoverSuccesses,
+                     uint32_t handoverFailures,
+                     const LatencyQuantiles& quantiles)
+    {
+        if (!m_file.is_open())
+        {
+            return;
+        }
+        m_samples++;
 
-    // Handover Configuration
-    lteHelper->SetHandoverAlgorithmType("ns3::A3RsrpHandoverAlgorithm");
-    lteHelper->SetHandoverAlgorithmAttribute(
-        "Hysteresis",
-        DoubleValue(SimulationParameters::HANDOVER_HYSTERESIS));
-    lteHelper->SetHandoverAlgorithmAttribute(
-        "TimeToTrigger",
-        TimeValue(MilliSeconds(SimulationParameters::HANDOVER_TimeToTrigger)));
+        if (m_format == BINARY)
+        {
+            // Column-major within the block: value of column c, row r at c * blockRows + r
+            size_t col = 0;
+            auto put = [this, &col](double value) {
+                m_block[col++ * m_blockRows + m_blockFill] = static_cast<float>(value);
+            };
+            put(time);
+            put(avgThroughputKbps);
+            for (uint32_t ueIndex = 0; ueIndex < m_numUe; ueIndex++)
+            {
+                put(ueThroughputKbps[ueIndex]);
+            }
+            put(avgLatencyMs);
+            for (uint32_t ueIndex = 0; ueIndex < m_numUe; ueIndex++)
+            {
+                put(uePacketLossRate[ueIndex]);
+            }
+            for (uint32_t ueIndex = 0; ueIndex < m_numUe; ueIndex++)
+            {
+                put(ueJitterMs[ueIndex]);
+            }
+            put(handoverStarts);
+            put(handoverSuccesses);
+            put(handoverFailures);
+            put(quantiles.p95LatencyMs);
+            put(quantiles.p99LatencyMs);
+            put(quantiles.p95JitterMs);
+            put(quantiles.p99JitterMs);
+
+            if (++m_blockFill == m_blockRows)
+            {
+                WriteBinaryBlock();
+                m_file.flush();
+            }
+            return;
+        }
 
-    // Configure Mobility for eNodeBs
-    ConfigureEnbMobility(enbNodes, params.areaSize);
+        m_file << time << "," << avgThroughputKbps;
+        for (uint32_t ueIndex = 0; ueIndex < m_numUe; ueIndex++)
+        {
+            m_file << "," << ueThroughputKbps[ueIndex];
+        }
+        m_file << "," << avgLatencyMs;
+        for (uint32_t ueIndex = 0; ueIndex < m_numUe; ueIndex++)
+        {
+            m_file << "," << uePacketLossRate[ueIndex];
+        }
+        for (uint32_t ueIndex = 0; ueIndex < m_numUe; ueIndex++)
+        {
+            m_file << "," << ueJitterMs[ueIndex];
+        }
+        m_file << "," << handoverStarts << "," << handoverSuccesses << "," << handoverFailures
+               << "," << quantiles.p95LatencyMs << "," << quantiles.p99LatencyMs << ","
+               << quantiles.p95JitterMs << "," << quantiles.p99JitterMs << "\n";
 
-    // Configure Mobility for UEs based on selected mobility mode
-    ConfigureUeMobility(ueNodes, params.areaSize, enbNodes, params.mobilityMode, params);
+        if (time - m_lastFlushTime >= m_flushInterval)
+        {
+            m_file.flush();
+            m_lastFlushTime = time;
+        }
+    }
 
-    // Position Remote Host and PGW
-    MobilityHelper remoteMobility;
-    remoteMobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
-    remoteMobility.Install(remoteHostContainer.Get(0));
-    remoteHostContainer.Get(0)->GetObject<MobilityModel>()->SetPosition(
-        Vector(params.areaSize / 2, params.areaSize / 2, 1.5));
+    /**
+     * @brief Writes any partial binary block, then flushes and closes the output file.
+     */
+    void Close()
+    {
+        if (m_file.is_open())
+        {
+            if (m_format == BINARY && m_blockFill > 0)
+            {
+                WriteBinaryBlock();
+            }
+            m_file.close();
+        }
+    }
 
-    remoteMobility.Install(epcHelper->GetPgwNode());
-    epcHelper->GetPgwNode()->GetObject<MobilityModel>()->SetPosition(
-        Vector(params.areaSize / 2, params.areaSize / 2, 1.5));
+    /**
+     * @return Number of sample rows written so far.
+     */
+    uint64_t GetSampleCount() const
+    {
+        return m_samples;
+    }
 
-    // Install LTE Devices
-    NetDeviceContainer enbDevs = lteHelper->InstallEnbDevice(enbNodes);
-    NetDeviceContainer ueDevs = lteHelper->InstallUeDevice(ueNodes);
+    /**
+     * @return Output file format.
+     */
+    Format GetFormat() const
+    {
+        return m_format;
+    }
 
-    // Install Internet Stack
-    InternetStackHelper internet;
-    internet.Install(ueNodes);
-    internet.Install(remoteHostContainer);
-    internet.Install(epcHelper->GetPgwNode());
+    /// @return 1-based column of UE ueIndex throughput.
+    static uint32_t UeThroughputColumn(uint32_t ueIndex)
+    {
+        return 3 + ueIndex;
+    }
 
-    // Assign IP Addresses to UEs
-    Ipv4InterfaceContainer ueInterfaces = epcHelper->AssignUeIpv4Address(ueDevs);
-    std::vector<Ipv4Address> ueAddresses;
-    for (uint32_t i = 0; i < ueInterfaces.GetN(); ++i)
+    /// @return 1-based column of the average latency.
+    static uint32_t AvgLatencyColumn(uint32_t numUe)
     {
-        ueAddresses.push_back(ueInterfaces.GetAddress(i));
-        NS_LOG_INFO("UE " << i << " IP Address: " << ueAddresses.back());
+        return 3 + numUe;
     }
 
-    // Attach UEs to the Nearest eNodeB
-    std::vector<Ptr<MobilityModel>> enbMobilityModel(params.numEnb);
-    for (uint32_t i = 0; i < enbNodes.GetN(); ++i)
+  private:
+    /**
+     * @brief Writes a 32-bit value in little-endian byte order.
+     * @param value Value to write.
+     */
+    void WriteLe32(uint32_t value)
     {
-        enbMobilityModel[i] = enbNodes.Get(i)->GetObject<MobilityModel>();
+        char bytes[4] = {static_cast<char>(value & 0xff),
+                         static_cast<char>((value >> 8) & 0xff),
+                         static_cast<char>((value >> 16) & 0xff),
+                         static_cast<char>((value >> 24) & 0xff)};
+        m_file.write(bytes, sizeof(bytes));
     }
-    for (uint32_t i = 0; i < ueDevs.GetN(); ++i)
+
+    /**
+     * @brief Writes the binary file header, padded to a multiple of 64 bytes.
+     */
+    void WriteBinaryHeader()
     {
-        Ptr<MobilityModel> ueMobility = ueNodes.Get(i)->GetObject<MobilityModel>();
-        Vector uePos = ueMobility->GetPosition();
+        uint32_t headerSize = 24;
+        for (const auto& name : m_columns)
+        {
+            headerSize += 2 + name.size();
+        }
+        headerSize = (headerSize + 63) / 64 * 64;
+
+        m_file.write("KPMMET01", 8);
+        WriteLe32(headerSize);
+        WriteLe32(m_columns.size());
+        WriteLe32(m_blockRows);
+        WriteLe32(0);
+        uint32_t written = 24;
+        for (const auto& name : m_columns)
+        {
+            char length[2] = {static_cast<char>(name.size() & 0xff),
+                              static_cast<char>((name.size() >> 8) & 0xff)};
+            m_file.write(length, sizeof(length));
+            m_file.write(name.data(), name.size());
+            written += 2 + name.size();
+        }
+        std::string padding(headerSize - written, '\0');
+        m_file.write(padding.data(), padding.size());
+    }
 
-        double minDistance = std::numeric_limits<double>::max();
-        uint32_t closestEnb = 0;
-        for (uint32_t j = 0; j < enbNodes.GetN(); ++j)
+    /**
+     * @brief Writes the current column block (padding unused rows with zeros) and resets it.
+     */
+    void WriteBinaryBlock()
+    {
+        WriteLe32(m_blockFill);
+        WriteLe32(0);
+        for (float value : m_block)
         {
-            Vector enbPos = enbMobilityModel[j]->GetPosition();
-            double dist = CalculateDistance(uePos, enbPos);
-            if (dist < minDistance)
-            {
-                minDistance = dist;
-                closestEnb = j;
-            }
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            WriteLe32(bits);
         }
-        lteHelper->Attach(ueDevs.Get(i), enbDevs.Get(closestEnb));
-        NS_LOG_INFO("UE " << i << " attached to eNodeB " << closestEnb);
+        std::fill(m_block.begin(), m_block.end(), 0.0f);
+        m_blockFill = 0;
     }
 
-    // Create Remote Host Link
-    Ipv4Address remoteHostAddr = CreateRemoteHost(epcHelper, remoteHostContainer, params.areaSize);
+    std::ofstream m_file;               ///< Output stream
+    std::vector<char> m_buffer;         ///< Stream buffer backing m_file
+    std::vector<std::string> m_columns; ///< Column names
+    Format m_format = CSV;              ///< Output file format
+    uint32_t m_numUe = 0;               ///< Number of UE columns per metric
+    uint64_t m_samples = 0;             ///< Rows written
+    double m_flushInterval = 1.0;       ///< Simulated seconds between CSV flushes
+    double m_lastFlushTime = 0.0;       ///< Sample time of the last CSV flush
+    std::vector<float> m_block;         ///< Pending BINARY block, column-major
+    uint32_t m_blockRows = 64;          ///< Rows per BINARY block
+    uint32_t m_blockFill = 0;           ///< Rows filled in the pending block
+};
 
-    // Install VoIP Applications
-    InstallVoipApplications(ueNodes, remoteHostAddr, params.simTime, remoteHostContainer, params);
+/**
+ * @struct StatsScheduler
+ * @brief Chooses when PeriodicStatsUpdate takes its next sample.
+ *
+ * FIXED samples every statsInterval. ADAPTIVE samples every statsInterval while there are
+ * handovers or loss bursts and doubles the interval after each quiet sample, up to
+ * statsIntervalMax. A handover start or failure (Densify) pulls a distant pending sample in
+ * to statsInterval from now. Samples record their actual time and rates are computed over
+ * the actual elapsed interval.
+ */
+struct StatsScheduler
+{
+    bool adaptive = false;         ///< ADAPTIVE mode
+    double minInterval = 0.1;      ///< Dense interval (statsInterval) [s]
+    double maxInterval = 0.1;      ///< Coarsest interval [s]
+    double lossThreshold = 1.0;    ///< Interval loss [%] that counts as a burst
+    double stopTime = 0.0;         ///< No samples after this time [s]
+    double interval = 0.1;         ///< Interval leading to the pending sample [s]
+    double lastSample = 0.0;       ///< Time of the previous sample [s]
+    uint64_t lastTxPackets = 0;    ///< Packets sent at the previous sample
+    uint64_t lastOutstanding = 0;  ///< Packets sent but not received at the previous sample
+    EventId next;                  ///< Pending PeriodicStatsUpdate
+    const SimulationParameters* params = nullptr; ///< Parameters passed (by reference) to samples
 
-    // Set Default Routes for UEs
-    Ipv4StaticRoutingHelper ipv4RoutingHelper;
-    for (uint32_t u = 0; u < ueNodes.GetN(); ++u)
+    /**
+     * @brief Schedules the first sample.
+     * @param p Simulation parameters (must outlive the simulation).
+     */
+    void Start(const SimulationParameters& p);
+
+    /**
+     * @brief Schedules the sample following the current one.
+     * @param busy Whether the current interval had handovers or a loss burst.
+     */
+    void ScheduleNext(bool busy);
+
+    /**
+     * @brief Brings the pending sample forward to at most minInterval from now (ADAPTIVE).
+     */
+    void Densify();
+};
+
+// ns-3 RNG stream blocks. Every random variable of the scenario gets a fixed stream, so a
+// draw does not depend on object creation order; RngSeed/RngRun select the substream, which
+// makes each sweep run independent of the others yet exactly reproducible.
+static constexpr int64_t STREAM_UE_PLACEMENT = 0;  ///< Initial UE positions (2 streams)
+static constexpr int64_t STREAM_UE_MOBILITY = 16;  ///< UE mobility models (MobilityHelper)
+static constexpr int64_t STREAM_LTE = 1 << 20;     ///< eNodeB then UE LTE devices
+static constexpr int64_t STREAM_VOIP = 1 << 24;    ///< Voice activity: server, then 2 per call
+
+// Global Variables for Time-Plot Data
+static double g_currentTime = 0.0;
+MetricsStreamWriter g_metricsWriter; ///< Streaming sink for periodic samples
+StatsScheduler g_statsScheduler;     ///< Timing of the periodic samples
+
+/**
+ * @class TrajectorySampler
+ * @brief Samples UE positions into a compact binary trajectory file (ue_trajectory.bin).
+ *
+ * Only UEs are sampled: eNodeBs and the core nodes never move. Their MobilityModel pointers
+ * are cached at Open, and every interval one record is written per UE:
+ * - CHANGES: only UEs whose CourseChange trace fired since the previous sample (a dirty list,
+ *   so the cost follows the number of course changes, not the number of UEs);
+ * - INTERVAL: every UE.
+ * All UEs are also written once at Open. Velocity is recorded with the position, so positions
+ * between samples can be extrapolated for constant-velocity models.
+ *
+ * File layout (little-endian):
+ * | Offset | Content                                                          |
+ * |--------|------------------------------------------------------------------|
+ * | 0      | magic "KPMTRJ01"                                                 |
+ * | 8      | uint32 headerSize (32), recordSize (32), numUe, mode             |
+ * | 24     | float64 sampling interval in seconds                             |
+ * | 32     | records: float32 time, uint32 ueIndex, float32 x, y, z, vx, vy, vz |
+ *
+ * In numpy: np.fromfile(path, offset=32, dtype=[("t", "<f4"), ("ue", "<u4"),
+ * ("pos", "<f4", 3), ("vel", "<f4", 3)]).
+ */
+class TrajectorySampler
+{
+  public:
+    /**
+     * @brief Sampling mode.
+     */
+    enum Mode
     {
-        Ptr<Ipv4> ipv4 = ueNodes.Get(u)->GetObject<Ipv4>();
-        Ptr<Ipv4StaticRouting> ueStaticRouting = ipv4RoutingHelper.GetStaticRouting(ipv4);
-        ueStaticRouting->SetDefaultRoute(epcHelper->GetUeDefaultGatewayAddress(), 1);
-        NS_LOG_INFO("UE " << u << " default route set to "
-                          << epcHelper->GetUeDefaultGatewayAddress());
+        CHANGES = 0, ///< UEs whose course changed since the last sample
+        INTERVAL = 1 ///< All UEs on every sample
+    };
+
+    /**
+     * @brief Opens the file, caches the UE mobility models and starts sampling.
+     * @param path Output file path.
+     * @param ueNodes UE nodes, in UE index order.
+     * @param mode Sampling mode.
+     * @param interval Sampling interval in seconds.
+     * @return false if the file cannot be opened.
+     */
+    bool Open(const std::string& path, const NodeContainer& ueNodes, Mode mode, double interval)
+    {
+        m_file.open(path, std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!m_file.is_open())
+        {
+            return false;
+        }
+        m_mode = mode;
+        m_interval = interval;
+        m_mobility.clear();
+        for (uint32_t i = 0; i < ueNodes.GetN(); ++i)
+        {
+            m_mobility.push_back(ueNodes.Get(i)->GetObject<MobilityModel>());
+        }
+        m_changed.assign(m_mobility.size(), 0);
+        m_dirty.clear();
+
+        m_file.write("KPMTRJ01", 8);
+        PutLe32(32);
+        PutLe32(RECORD_SIZE);
+        PutLe32(m_mobility.size());
+        PutLe32(m_mode);
+        uint64_t intervalBits;
+        std::memcpy(&intervalBits, &m_interval, sizeof(intervalBits));
+        PutLe32(intervalBits & 0xffffffff);
+        PutLe32(intervalBits >> 32);
+
+        for (uint32_t ueIndex = 0; ueIndex < m_mobility.size(); ++ueIndex)
+        {
+            PutRecord(ueIndex);
+            if (m_mode == CHANGES)
+            {
+                m_mobility[ueIndex]->TraceConnectWithoutContext(
+                    "CourseChange",
+                    MakeBoundCallback(&TrajectorySampler::CourseChanged, this, ueIndex));
+            }
+        }
+        FlushRecords();
+        Simulator::Schedule(Seconds(m_interval), &TrajectorySampler::Sample, this);
+        return true;
     }
 
-    // Enable LTE Traces
-    EnableLteTraces(lteHelper);
+    /**
+     * @brief Writes the pending records and closes the file.
+     */
+    void Close()
+    {
+        if (m_file.is_open())
+        {
+            FlushRecords();
+            m_file.close();
+        }
+    }
 
-    // Setup FlowMonitor
-    FlowMonitorHelper flowHelper;
-    Ptr<FlowMonitor> flowMonitor = SetupFlowMonitor(flowHelper);
-
-    // Map Flows to UEs and Initialize Statistics
-    Simulator::Schedule(Seconds(0.0), [&flowMonitor, &flowHelper, &params, &ueDevs]() {
-        auto initialStats = flowMonitor->GetFlowStats();
-        Ptr<Ipv4FlowClassifier> classifier =
-            DynamicCast<Ipv4FlowClassifier>(flowHelper.GetClassifier());
-        for (auto it = initialStats.begin(); it != initialStats.end(); ++it)
-        {
-            Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow(it->first);
-            uint16_t destPort = t.destinationPort;
-            if (destPort >= 5000 && destPort < (5000 + params.numUe))
+    /**
+     * @return Number of records written so far.
+     */
+    uint64_t GetRecordCount() const
+    {
+        return m_records;
+    }
+
+  private:
+    static constexpr uint32_t RECORD_SIZE = 32; ///< Bytes per trajectory record
+
+    /**
+     * @brief CourseChange sink: marks a UE for the next sample.
+     * @param sampler Sampler the UE belongs to.
+     * @param ueIndex UE index.
+     * @param model Mobility model whose course changed.
+     */
+    static void CourseChanged(TrajectorySampler* sampler,
+                              uint32_t ueIndex,
+                              Ptr<const MobilityModel> model)
+    {
+        if (!sampler->m_changed[ueIndex])
+        {
+            sampler->m_changed[ueIndex] = 1;
+            sampler->m_dirty.push_back(ueIndex);
+        }
+    }
+
+    /**
+     * @brief Periodic sample: writes the changed (or all) UEs and reschedules itself.
+     */
+    void Sample()
+    {
+        if (m_mode == CHANGES)
+        {
+            for (uint32_t ueIndex : m_dirty)
             {
-                uint32_t ueIndex = destPort - 5000;
-                g_flowIdToUeIndex[it->first] = ueIndex;
-                NS_LOG_INFO("Flow " << it->first << " mapped to UE " << ueIndex
-                                    << " (src=" << t.sourceAddress
-                                    << ", dst=" << t.destinationAddress << ":" << destPort << ")");
-
-                // Initialize statistics
-                g_previousRxBytes[it->first] = 0;
-                g_previousDelaySum[it->first] = Seconds(0);
-                g_previousJitterSum[it->first] = Seconds(0);
-                g_previousRxPackets[it->first] = 0;
+                PutRecord(ueIndex);
+                m_changed[ueIndex] = 0;
             }
-            else
+            m_dirty.clear();
+        }
+        else
+        {
+            for (uint32_t ueIndex = 0; ueIndex < m_mobility.size(); ++ueIndex)
             {
-                NS_LOG_WARN("Flow " << it->first
-                                    << " has unexpected destination port: " << destPort);
+                PutRecord(ueIndex);
             }
         }
-    });
+        FlushRecords();
+        Simulator::Schedule(Seconds(m_interval), &TrajectorySampler::Sample, this);
+    }
 
-    // Connect Handover Trace Sources to Callbacks
-    for (uint32_t i = 0; i < enbDevs.GetN(); ++i)
+    /**
+     * @brief Appends a 32-bit value in little-endian byte order to the pending records.
+     * @param value Value to append.
+     */
+    void PutLe32(uint32_t value)
     {
-        Ptr<LteEnbNetDevice> enbNetDevice = DynamicCast<LteEnbNetDevice>(enbDevs.Get(i));
-        if (enbNetDevice)
+        char bytes[4] = {static_cast<char>(value & 0xff),
+                         static_cast<char>((value >> 8) & 0xff),
+                         static_cast<char>((value >> 16) & 0xff),
+                         static_cast<char>((value >> 24) & 0xff)};
+        m_pending.insert(m_pending.end(), bytes, bytes + sizeof(bytes));
+    }
+
+    /**
+     * @brief Appends a float32 in little-endian byte order to the pending records.
+     * @param value Value to append.
+     */
+    void PutFloat(double value)
+    {
+        float f = static_cast<float>(value);
+        uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        PutLe32(bits);
+    }
+
+    /**
+     * @brief Appends the current position and velocity of a UE.
+     * @param ueIndex UE index.
+     */
+    void PutRecord(uint32_t ueIndex)
+    {
+        const Ptr<MobilityModel>& mobility = m_mobility[ueIndex];
+        Vector pos = mobility->GetPosition();
+        Vector vel = mobility->GetVelocity();
+        PutFloat(Simulator::Now().GetSeconds());
+        PutLe32(ueIndex);
+        PutFloat(pos.x);
+        PutFloat(pos.y);
+        PutFloat(pos.z);
+        PutFloat(vel.x);
+        PutFloat(vel.y);
+        PutFloat(vel.z);
+        m_records++;
+    }
+
+    /**
+     * @brief Writes the pending bytes (header or records) to the file.
+     */
+    void FlushRecords()
+    {
+        m_file.write(m_pending.data(), m_pending.size());
+        m_pending.clear();
+    }
+
+    std::ofstream m_file;                       ///< Trajectory file
+    std::vector<char> m_pending;                ///< Encoded bytes not yet written
+    std::vector<Ptr<MobilityModel>> m_mobility; ///< Cached UE mobility models
+    std::vector<uint8_t> m_changed;             ///< Per UE: already on the dirty list
+    std::vector<uint32_t> m_dirty;              ///< UEs with a course change since the sample
+    Mode m_mode = CHANGES;                      ///< Sampling mode
+    double m_interval = 1.0;                    ///< Sampling interval in seconds
+    uint64_t m_records = 0;                     ///< Records written
+};
+
+TrajectorySampler g_trajectorySampler; ///< UE trajectory file (closed when disabled)
+
+// Flow Statistics Tracking
+/**
+ * @struct UeFlowState
+ * @brief Cumulative KPI collector counters seen at the previous sample, stored as
+ *        struct-of-arrays indexed by dense UE index.
+ */
+struct UeFlowState
+{
+    std::vector<uint64_t> prevRxBytes;   ///< rxBytes at the previous sample
+    std::vector<uint64_t> prevRxPackets; ///< rxPackets at the previous sample
+    std::vector<double> prevDelaySum;    ///< delaySum at the previous sample
+
+    /**
+     * @brief Sizes all arrays for numUe UEs and zeroes them.
+     * @param numUe Number of UEs.
+     */
+    void Reset(uint32_t numUe)
+    {
+        prevRxBytes.assign(numUe, 0);
+        prevRxPackets.assign(numUe, 0);
+        prevDelaySum.assign(numUe, 0.0);
+    }
+};
+
+UeFlowState g_ueFlowState;
+
+/**
+ * @class VoipTimestampTag
+ * @brief Packet tag carrying the sending UE and transmit time of a VoIP packet.
+ *
+ * Attached by the sending VoIP application and read back by the receiving one, so
+ * one-way delay needs no per-hop probes.
+ */
+class VoipTimestampTag : public Tag
+{
+  public:
+    /**
+     * @brief Registers the tag type.
+     * @return The TypeId.
+     */
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("VoipTimestampTag")
+                                .SetParent<Tag>()
+                                .SetGroupName("Lte")
+                                .AddConstructor<VoipTimestampTag>();
+        return tid;
+    }
+
+    TypeId GetInstanceTypeId() const override
+    {
+        return GetTypeId();
+    }
+
+    uint32_t GetSerializedSize() const override
+    {
+        return sizeof(uint32_t) + sizeof(int64_t);
+    }
+
+    void Serialize(TagBuffer buffer) const override
+    {
+        buffer.WriteU32(ueIndex);
+        buffer.WriteU64(static_cast<uint64_t>(txTimeNs));
+    }
+
+    void Deserialize(TagBuffer buffer) override
+    {
+        ueIndex = buffer.ReadU32();
+        txTimeNs = static_cast<int64_t>(buffer.ReadU64());
+    }
+
+    void Print(std::ostream& os) const override
+    {
+        os << "ue=" << ueIndex << " tx=" << txTimeNs << "ns";
+    }
+
+    uint32_t ueIndex = 0; ///< Sending UE index
+    int64_t txTimeNs = 0; ///< Transmit time in nanoseconds
+};
+
+NS_OBJECT_ENSURE_REGISTERED(VoipTimestampTag);
+
+/**
+ * @struct LogHistogram
+ * @brief Fixed-size log-linear (HDR-style) histogram for streaming quantiles.
+ *
+ * Values are binned in microseconds: exactly below 16 us, then 16 linear sub-bins per power
+ * of two (at most 6.25% relative bin width) up to 2^22 us (about 4.2 s); larger values land
+ * in the last bin. Bins are plain uint32 counters owned by the caller, so many histograms
+ * can share one flat array and be merged as such.
+ */
+struct LogHistogram
+{
+    static constexpr uint32_t SUB_BITS = 4;  ///< log2 of the sub-bins per power of two
+    static constexpr uint32_t MAX_BITS = 22; ///< Values up to 2^MAX_BITS us are resolved
+    static constexpr uint32_t BINS = (MAX_BITS - SUB_BITS + 1) << SUB_BITS; ///< Bin count
+
+    /**
+     * @brief Maps a value to its bin.
+     * @param seconds Value in seconds (negative values count as 0).
+     * @return Bin index in [0, BINS).
+     */
+    static uint32_t BinIndex(double seconds)
+    {
+        double us = std::max(0.0, seconds * 1e6);
+        uint64_t v = std::min<uint64_t>(static_cast<uint64_t>(us), (1ull << MAX_BITS) - 1);
+        if (v < (1u << SUB_BITS))
         {
-            Ptr<LteEnbRrc> enbRrc = enbNetDevice->GetRrc();
-            if (enbRrc)
+            return static_cast<uint32_t>(v);
+        }
+        uint32_t exponent = 63 - __builtin_clzll(v);
+        uint32_t shift = exponent - SUB_BITS;
+        return ((shift + 1) << SUB_BITS) + static_cast<uint32_t>((v >> shift) - (1u << SUB_BITS));
+    }
+
+    /**
+     * @brief Representative value of a bin (its midpoint).
+     * @param index Bin index.
+     * @return Value in seconds.
+     */
+    static double BinValue(uint32_t index)
+    {
+        if (index < (1u << SUB_BITS))
+        {
+            return (index + 0.5) * 1e-6;
+        }
+        uint32_t shift = (index >> SUB_BITS) - 1;
+        uint64_t lower = static_cast<uint64_t>((1u << SUB_BITS) + (index & ((1u << SUB_BITS) - 1)))
+                         << shift;
+        return (lower + (1ull << shift) / 2.0) * 1e-6;
+    }
+
+    /**
+     * @brief Estimates a quantile.
+     * @param bins BINS counters.
+     * @param q Quantile in (0, 1], e.g. 0.95.
+     * @return Quantile value in seconds (0 if the histogram is empty).
+     */
+    static double Quantile(const uint32_t* bins, double q)
+    {
+        uint64_t total = 0;
+        for (uint32_t i = 0; i < BINS; ++i)
+        {
+            total += bins[i];
+        }
+        if (total == 0)
+        {
+            return 0.0;
+        }
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * total)));
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < BINS; ++i)
+        {
+            seen += bins[i];
+            if (seen >= rank)
             {
-                // Connect Handover Start
-                enbRrc->TraceConnectWithoutContext("HandoverStart",
-                                                   MakeCallback(&HandoverStartCallback));
+                return BinValue(i);
+            }
+        }
+        return BinValue(BINS - 1);
+    }
+};
 
-                // Connect Handover Success
-                enbRrc->TraceConnectWithoutContext("HandoverSuccess",
-                                                   MakeCallback(&HandoverSuccessCallback));
+/**
+ * @struct VoipKpiCounters
+ * @brief Per-UE VoIP KPI collector fed by timestamp tags, as struct-of-arrays.
+ *
+ * The UE's VoipCallApplication counts transmitted packets; the remote host's VoipMuxServer
+ * counts received bytes and packets, sums one-way delay and updates
+ * the RFC 3550 interarrival jitter estimate J += (|D| - J) / 16 (D = transit-time
+ * difference of consecutive packets). Each received packet also feeds log histograms of
+ * the delay and of |D|, per UE for the whole run and across UEs for the current sample
+ * interval, so tail percentiles need no per-packet storage. The dl* arrays hold the
+ * downlink half of bidirectional calls (packets, bytes and delay only).
+ */
+struct VoipKpiCounters
+{
+    std::vector<uint64_t> txPackets;          ///< Packets sent
+    std::vector<uint64_t> rxPackets;          ///< Packets received
+    std::vector<uint64_t> rxBytes;            ///< Bytes received (UDP payload)
+    std::vector<double> delaySum;             ///< Sum of one-way delays in seconds
+    std::vector<double> jitter;               ///< RFC 3550 interarrival jitter in seconds
+    std::vector<double> lastTransit;          ///< Previous packet's transit time (-1 = none)
+    std::vector<double> firstTxTime;          ///< First transmit time in seconds
+    std::vector<double> lastRxTime;           ///< Last receive time in seconds
+    std::vector<uint32_t> delayBins;          ///< numUe x LogHistogram::BINS delay histograms
+    std::vector<uint32_t> jitterBins;         ///< numUe x LogHistogram::BINS |D| histograms
+    std::vector<uint32_t> intervalDelayBins;  ///< Delay histogram of the current interval
+    std::vector<uint32_t> intervalJitterBins; ///< |D| histogram of the current interval
+    std::vector<uint64_t> dlTxPackets;        ///< Downlink packets sent to the UE
+    std::vector<uint64_t> dlRxPackets;        ///< Downlink packets received by the UE
+    std::vector<uint64_t> dlRxBytes;          ///< Downlink bytes received (UDP payload)
+    std::vector<double> dlDelaySum;           ///< Sum of downlink one-way delays in seconds
+
+    /**
+     * @brief Sizes all arrays for numUe UEs and zeroes them.
+     * @param numUe Number of UEs.
+     */
+    void Reset(uint32_t numUe)
+    {
+        txPackets.assign(numUe, 0);
+        rxPackets.assign(numUe, 0);
+        rxBytes.assign(numUe, 0);
+        delaySum.assign(numUe, 0.0);
+        jitter.assign(numUe, 0.0);
+        lastTransit.assign(numUe, -1.0);
+        firstTxTime.assign(numUe, std::numeric_limits<double>::max());
+        lastRxTime.assign(numUe, 0.0);
+        delayBins.assign(static_cast<size_t>(numUe) * LogHistogram::BINS, 0);
+        jitterBins.assign(static_cast<size_t>(numUe) * LogHistogram::BINS, 0);
+        intervalDelayBins.assign(LogHistogram::BINS, 0);
+        intervalJitterBins.assign(LogHistogram::BINS, 0);
+        dlTxPackets.assign(numUe, 0);
+        dlRxPackets.assign(numUe, 0);
+        dlRxBytes.assign(numUe, 0);
+        dlDelaySum.assign(numUe, 0.0);
+    }
+};
+
+VoipKpiCounters g_voipKpi;
+
+/**
+ * @class HandoverEventLogger
+ * @brief Writes handover events to a text log without blocking the simulation thread.
+ *
+ * The trace callbacks push fixed-size binary records into a single-producer/single-consumer
+ * lock-free ring buffer; a background thread drains it and does all text formatting and
+ * file I/O. If the ring is full the producer yields until the writer catches up, so no
+ * event is ever dropped.
+ */
+class HandoverEventLogger
+{
+  public:
+    /**
+     * @brief Handover event type.
+     */
+    enum EventType : uint8_t
+    {
+        START = 0,   ///< HandoverStart trace
+        SUCCESS = 1, ///< HandoverSuccess trace
+        FAILURE = 2  ///< HandoverFailure trace
+    };
+
+    /**
+     * @struct Record
+     * @brief Compact handover event record passed through the ring buffer.
+     */
+    struct Record
+    {
+        int64_t timeMs;        ///< Simulation time in milliseconds
+        uint64_t imsi;         ///< UE IMSI
+        uint16_t cellId;       ///< Source cell ID
+        uint16_t targetCellId; ///< Target cell ID
+        uint16_t reason;       ///< Handover reason from the trace
+        EventType type;        ///< Event type
+    };
+
+    ~HandoverEventLogger()
+    {
+        Close();
+    }
+
+    /**
+     * @brief Opens the log file and starts the writer thread.
+     * @param path Log file path.
+     * @param capacityLog2 Ring capacity as a power of two.
+     * @return true on success.
+     */
+    bool Open(const std::string& path, uint32_t capacityLog2 = 14)
+    {
+        m_file.open(path, std::ios::out | std::ios::trunc);
+        if (!m_file.is_open())
+        {
+            return false;
+        }
+        m_ring.resize(size_t(1) << capacityLog2);
+        m_mask = m_ring.size() - 1;
+        m_head.store(0, std::memory_order_relaxed);
+        m_tail.store(0, std::memory_order_relaxed);
+        m_running.store(true, std::memory_order_release);
+        m_writer = std::thread(&HandoverEventLogger::WriterLoop, this);
+        return true;
+    }
+
+    /**
+     * @brief Enqueues one event (simulation thread only).
+     * @param record Event record.
+     */
+    void Push(const Record& record)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        while (head - m_tail.load(std::memory_order_acquire) >= m_ring.size())
+        {
+            std::this_thread::yield();
+        }
+        m_ring[head & m_mask] = record;
+        m_head.store(head + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Stops the writer thread after draining the ring and closes the file.
+     */
+    void Close()
+    {
+        if (m_writer.joinable())
+        {
+            m_running.store(false, std::memory_order_release);
+            m_writer.join();
+        }
+        if (m_file.is_open())
+        {
+            m_file.close();
+        }
+    }
+
+  private:
+    /**
+     * @brief Writer thread body: drains the ring, formatting each record as text.
+     */
+    void WriterLoop()
+    {
+        while (true)
+        {
+            // Read the flag before the ring, so that once it is seen cleared the final drain
+            // below observes every record pushed before Close()
+            bool running = m_running.load(std::memory_order_acquire);
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            size_t head = m_head.load(std::memory_order_acquire);
+            for (; tail != head; ++tail)
+            {
+                Format(m_ring[tail & m_mask]);
+                m_tail.store(tail + 1, std::memory_order_release);
+            }
+            if (!running)
+            {
+                break;
+            }
+            m_file.flush();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        m_file.flush();
+    }
+
+    /**
+     * @brief Formats one record in the handover_events.log text format.
+     * @param record Event record.
+     */
+    void Format(const Record& record)
+    {
+        switch (record.type)
+        {
+        case START:
+            m_file << "Handover Start: IMSI=" << record.imsi << ", from Cell=" << record.cellId
+                   << " to Cell=" << record.targetCellId;
+            break;
+        case SUCCESS:
+            m_file << "Handover Success: IMSI=" << record.imsi
+                   << ", to Cell=" << record.targetCellId;
+            break;
+        case FAILURE:
+            m_file << "Handover Failure: IMSI=" << record.imsi << ", from Cell=" << record.cellId
+                   << " to Cell=" << record.targetCellId;
+            break;
+        }
+        m_file << " Reason=" << record.reason << " at Time=" << record.timeMs << "ms\n";
+    }
+
+    std::ofstream m_file;                      ///< Text log written by the writer thread
+    std::vector<Record> m_ring;                ///< Ring storage
+    size_t m_mask = 0;                         ///< Ring index mask (capacity - 1)
+    alignas(64) std::atomic<size_t> m_head{0}; ///< Next slot to write (producer)
+    alignas(64) std::atomic<size_t> m_tail{0}; ///< Next slot to read (consumer)
+    std::atomic<bool> m_running{false};        ///< Cleared to stop the writer thread
+    std::thread m_writer;                      ///< Background writer thread
+};
+
+// Handover Logging Variables
+HandoverEventLogger g_handoverLogger;
+uint32_t g_handoverStartCount = 0;
+uint32_t g_handoverSuccessCount = 0;
+uint32_t g_handoverFailureCount = 0;
+
+/**
+ * @class LiveStatusExporter
+ * @brief Publishes run-progress counters to a JSON status file and/or an HTTP endpoint.
+ *
+ * The simulation thread publishes counters with relaxed atomic stores from
+ * PeriodicStatsUpdate. No lock is taken and nothing blocks on the exporter. A side thread
+ * reads the counters and adds wall-clock time and current RSS (/proc/self/statm), which are
+ * safe to read off the simulation thread. Every statusInterval wall seconds it rewrites the
+ * status file atomically (temporary file plus rename). It also answers HTTP requests on
+ * 127.0.0.1:statusPort: GET /metrics returns the Prometheus text format, any other path the
+ * JSON document.
+ */
+class LiveStatusExporter
+{
+  public:
+    ~LiveStatusExporter()
+    {
+        Stop();
+    }
+
+    /**
+     * @brief Opens the HTTP listener (if any) and starts the exporter thread.
+     * @param path Status file path (empty = none).
+     * @param interval Wall seconds between status file updates.
+     * @param port HTTP port on the loopback interface (0 = none).
+     * @param simTime Simulated duration of the run [s].
+     * @return false if the listener cannot be opened.
+     */
+    bool Start(const std::string& path, double interval, uint16_t port, double simTime)
+    {
+        m_path = path;
+        m_interval = interval;
+        m_simTime = simTime;
+        m_wallStart = std::chrono::steady_clock::now();
+        if (port != 0)
+        {
+            m_listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+            int reuse = 1;
+            setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (m_listenFd < 0 ||
+                ::bind(m_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+                ::listen(m_listenFd, 4) != 0)
+            {
+                if (m_listenFd >= 0)
+                {
+                    ::close(m_listenFd);
+                    m_listenFd = -1;
+                }
+                return false;
+            }
+        }
+        m_running.store(true, std::memory_order_release);
+        m_thread = std::thread(&LiveStatusExporter::Loop, this);
+        return true;
+    }
+
+    /**
+     * @brief Publishes the counters of the current sample (simulation thread only).
+     * @param events Events executed by the simulator so far.
+     * @param simSeconds Current simulated time [s].
+     * @param unacked Packets sent but not received so far (cumulative, includes losses).
+     * @param handovers Cumulative handover starts.
+     * @param handoverFailures Cumulative handover failures.
+     * @param samplerNs Cumulative wall time spent in the periodic sampler [ns].
+     */
+    void Publish(uint64_t events,
+                 double simSeconds,
+                 uint64_t unacked,
+                 uint64_t handovers,
+                 uint64_t handoverFailures,
+                 uint64_t samplerNs)
+    {
+        m_events.store(events, std::memory_order_relaxed);
+        m_simNs.store(static_cast<uint64_t>(simSeconds * 1e9), std::memory_order_relaxed);
+        m_unacked.store(unacked, std::memory_order_relaxed);
+        m_handovers.store(handovers, std::memory_order_relaxed);
+        m_handoverFailures.store(handoverFailures, std::memory_order_relaxed);
+        m_samplerNs.store(samplerNs, std::memory_order_relaxed);
+        m_samples.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Stops the exporter thread, which writes a final "finished" status first.
+     */
+    void Stop()
+    {
+        if (m_thread.joinable())
+        {
+            m_running.store(false, std::memory_order_release);
+            m_thread.join();
+        }
+        if (m_listenFd >= 0)
+        {
+            ::close(m_listenFd);
+            m_listenFd = -1;
+        }
+    }
+
+  private:
+    /**
+     * @brief Exporter thread body: serves HTTP requests and refreshes the status file.
+     */
+    void Loop()
+    {
+        auto nextWrite = std::chrono::steady_clock::now();
+        while (m_running.load(std::memory_order_acquire))
+        {
+            if (!m_path.empty() && std::chrono::steady_clock::now() >= nextWrite)
+            {
+                WriteFile(Json("running"));
+                nextWrite += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(m_interval));
+            }
+            pollfd fd{m_listenFd, POLLIN, 0};
+            if (m_listenFd < 0 || poll(&fd, 1, 100) <= 0)
+            {
+                if (m_listenFd < 0)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                }
+                continue;
+            }
+            int client = ::accept(m_listenFd, nullptr, nullptr);
+            if (client >= 0)
+            {
+                Serve(client);
+                ::close(client);
+            }
+        }
+        if (!m_path.empty())
+        {
+            WriteFile(Json("finished"));
+        }
+    }
+
+    /**
+     * @brief Answers one HTTP request.
+     * @param client Connected socket.
+     */
+    void Serve(int client)
+    {
+        char request[1024];
+        // A client that connects and never sends must not stall the thread (and Stop's join).
+        timeval timeout{1, 0};
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        ssize_t n = ::recv(client, request, sizeof(request) - 1, 0);
+        if (n <= 0)
+        {
+            return;
+        }
+        request[n] = '\0';
+        bool prometheus = (std::strncmp(request, "GET /metrics", 12) == 0);
+        std::string body = prometheus ? Prometheus() : Json("running");
+        std::ostringstream response;
+        response << "HTTP/1.0 200 OK\r\nContent-Type: "
+                 << (prometheus ? "text/plain; version=0.0.4" : "application/json")
+                 << "\r\nContent-Length: " << body.size() << "\r\nConnection: close\r\n\r\n"
+                 << body;
+        std::string text = response.str();
+        for (size_t sent = 0; sent < text.size();)
+        {
+            ssize_t w = ::send(client, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+            if (w <= 0)
+            {
+                break;
+            }
+            sent += w;
+        }
+    }
+
+    /**
+     * @struct Snapshot
+     * @brief One consistent-enough read of the counters plus wall time and RSS.
+     */
+    struct Snapshot
+    {
+        double wallSeconds;        ///< Wall time since Start
+        double simSeconds;         ///< Simulated time
+        uint64_t events;           ///< Events executed
+        uint64_t unacked;          ///< Packets sent but not received
+        uint64_t handovers;        ///< Handover starts
+        uint64_t handoverFailures; ///< Handover failures
+        uint64_t samples;          ///< Periodic samples taken
+        double samplerSeconds;     ///< Wall time spent in the sampler
+        double rssMb;              ///< Current resident set size
+    };
+
+    /**
+     * @brief Reads the counters.
+     * @return Current snapshot.
+     */
+    Snapshot Read() const
+    {
+        Snapshot s;
+        s.wallSeconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - m_wallStart).count();
+        s.simSeconds = m_simNs.load(std::memory_order_relaxed) / 1e9;
+        s.events = m_events.load(std::memory_order_relaxed);
+        s.unacked = m_unacked.load(std::memory_order_relaxed);
+        s.handovers = m_handovers.load(std::memory_order_relaxed);
+        s.handoverFailures = m_handoverFailures.load(std::memory_order_relaxed);
+        s.samples = m_samples.load(std::memory_order_relaxed);
+        s.samplerSeconds = m_samplerNs.load(std::memory_order_relaxed) / 1e9;
+        s.rssMb = 0.0;
+        std::ifstream statm("/proc/self/statm");
+        uint64_t sizePages = 0;
+        uint64_t residentPages = 0;
+        if (statm >> sizePages >> residentPages)
+        {
+            s.rssMb = residentPages * (sysconf(_SC_PAGESIZE) / 1048576.0);
+        }
+        return s;
+    }
+
+    /**
+     * @brief Formats the counters as a JSON document.
+     * @param state "running" or "finished".
+     * @return JSON text.
+     */
+    std::string Json(const char* state) const
+    {
+        Snapshot s = Read();
+        std::ostringstream out;
+        out << "{\"state\": \"" << state << "\", \"pid\": " << getpid()
+            << ", \"wall_seconds\": " << s.wallSeconds << ", \"sim_seconds\": " << s.simSeconds
+            << ", \"sim_time_total\": " << m_simTime << ", \"progress\": "
+            << (m_simTime > 0 ? s.simSeconds / m_simTime : 0.0) << ", \"events\": " << s.events
+            << ", \"events_per_wall_second\": "
+            << (s.wallSeconds > 0 ? s.events / s.wallSeconds : 0.0)
+            << ", \"packets_unacked_total\": " << s.unacked << ", \"handovers\": " << s.handovers
+            << ", \"handover_failures\": " << s.handoverFailures << ", \"samples\": "
+            << s.samples << ", \"sampler_seconds\": " << s.samplerSeconds
+            << ", \"rss_mb\": " << s.rssMb << "}\n";
+        return out.str();
+    }
+
+    /**
+     * @brief Formats the counters in the Prometheus text exposition format.
+     * @return Metrics text.
+     */
+    std::string Prometheus() const
+    {
+        Snapshot s = Read();
+        std::ostringstream out;
+        out << "# TYPE lte_voip_wall_seconds gauge\nlte_voip_wall_seconds " << s.wallSeconds
+            << "\n# TYPE lte_voip_sim_seconds gauge\nlte_voip_sim_seconds " << s.simSeconds
+            << "\n# TYPE lte_voip_events_total counter\nlte_voip_events_total " << s.events
+            << "\n# TYPE lte_voip_packets_unacked_total counter\nlte_voip_packets_unacked_total "
+            << s.unacked << "\n# TYPE lte_voip_handovers_total counter\nlte_voip_handovers_total "
+            << s.handovers
+            << "\n# TYPE lte_voip_handover_failures_total counter\n"
+               "lte_voip_handover_failures_total "
+            << s.handoverFailures
+            << "\n# TYPE lte_voip_sampler_seconds_total counter\nlte_voip_sampler_seconds_total "
+            << s.samplerSeconds << "\n# TYPE lte_voip_rss_bytes gauge\nlte_voip_rss_bytes "
+            << static_cast<uint64_t>(s.rssMb * 1048576.0) << "\n";
+        return out.str();
+    }
+
+    /**
+     * @brief Replaces the status file with the given document.
+     * @param text File contents.
+     */
+    void WriteFile(const std::string& text) const
+    {
+        std::string tmp = m_path + ".tmp";
+        {
+            std::ofstream file(tmp, std::ios::out | std::ios::trunc);
+            file << text;
+            if (!file.good())
+            {
+                return;
+            }
+        }
+        std::rename(tmp.c_str(), m_path.c_str());
+    }
+
+    std::string m_path;                                ///< Status file (empty = none)
+    double m_interval = 5.0;                           ///< Wall seconds between file updates
+    double m_simTime = 0.0;                            ///< Simulated duration of the run
+    int m_listenFd = -1;                               ///< HTTP listening socket (-1 = none)
+    std::chrono::steady_clock::time_point m_wallStart; ///< Start of the exporter
+    std::atomic<uint64_t> m_events{0};                 ///< Events executed
+    std::atomic<uint64_t> m_simNs{0};                  ///< Simulated time [ns]
+    std::atomic<uint64_t> m_unacked{0};                ///< Packets sent but not received
+    std::atomic<uint64_t> m_handovers{0};              ///< Handover starts
+    std::atomic<uint64_t> m_handoverFailures{0};       ///< Handover failures
+    std::atomic<uint64_t> m_samplerNs{0};              ///< Wall time in the sampler [ns]
+    std::atomic<uint64_t> m_samples{0};                ///< Periodic samples taken
+    std::atomic<bool> m_running{false};                ///< Cleared to stop the thread
+    std::thread m_thread;                              ///< Exporter thread
+};
+
+LiveStatusExporter g_liveStatus;      ///< Live run-progress endpoint (idle unless started)
+uint64_t g_totalHandovers = 0;        ///< Cumulative handover starts (live status)
+uint64_t g_totalHandoverFailures = 0; ///< Cumulative handover failures (live status)
+uint64_t g_samplerNs = 0;             ///< Cumulative wall time in PeriodicStatsUpdate [ns]
+
+/**
+ * @struct CellKpiAggregator
+ * @brief Per-cell throughput, load, latency and handover counts for every statsInterval.
+ *
+ * The serving cell of each UE lives in a flat IMSI -> cell slot array, set at attach and
+ * moved by the HandoverSuccess trace, so attributing a UE's interval deltas to its cell costs
+ * two array lookups and no Config path or context string parsing. Cell slots follow the
+ * eNodeB device order. Each sample appends one row per cell to cell_metrics.csv (long
+ * format, so 100+ cell layouts keep a fixed column count).
+ */
+struct CellKpiAggregator
+{
+    static constexpr uint32_t NO_CELL = std::numeric_limits<uint32_t>::max(); ///< Unknown cell
+
+    std::ofstream file;                ///< Per-cell sample rows
+    std::vector<uint16_t> cellIds;     ///< Cell ID per slot
+    std::vector<uint32_t> cellSlot;    ///< Cell ID -> slot
+    std::vector<uint32_t> imsiCell;    ///< IMSI -> serving cell slot
+    std::vector<uint64_t> ueImsi;      ///< UE index -> IMSI
+    std::vector<uint32_t> attachedUes; ///< UEs currently served, per cell slot
+
+    // Per-cell accumulators of the current interval
+    std::vector<uint32_t> activeUes;        ///< UEs that received packets
+    std::vector<uint64_t> rxBytes;          ///< Bytes received
+    std::vector<uint64_t> rxPackets;        ///< Packets received
+    std::vector<double> delaySum;           ///< Sum of one-way delays in seconds
+    std::vector<uint32_t> handoverIn;       ///< Successful handovers into the cell
+    std::vector<uint32_t> handoverOut;      ///< Successful handovers out of the cell
+    std::vector<uint32_t> handoverFailures; ///< Failed handovers out of the cell
+
+    /**
+     * @brief Opens the output file and sizes the per-cell arrays.
+     * @param path Output CSV file.
+     * @param enbDevs eNodeB devices, one cell slot each.
+     * @param numUe Number of UEs.
+     * @return false if the file cannot be opened.
+     */
+    bool Open(const std::string& path, const NetDeviceContainer& enbDevs, uint32_t numUe)
+    {
+        file.open(path);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        file << "Time(s),CellId,Attached_UEs,Active_UEs,Throughput(Kbps),Avg_Latency(ms),"
+                "Handover_In_Count,Handover_Out_Count,Handover_Failure_Count\n";
+
+        size_t numCells = enbDevs.GetN();
+        cellIds.resize(numCells);
+        for (uint32_t slot = 0; slot < numCells; ++slot)
+        {
+            cellIds[slot] = DynamicCast<LteEnbNetDevice>(enbDevs.Get(slot))->GetCellId();
+            if (cellIds[slot] >= cellSlot.size())
+            {
+                cellSlot.resize(cellIds[slot] + 1, NO_CELL);
+            }
+            cellSlot[cellIds[slot]] = slot;
+        }
+        ueImsi.assign(numUe, 0);
+        attachedUes.assign(numCells, 0);
+        activeUes.assign(numCells, 0);
+        rxBytes.assign(numCells, 0);
+        rxPackets.assign(numCells, 0);
+        delaySum.assign(numCells, 0.0);
+        handoverIn.assign(numCells, 0);
+        handoverOut.assign(numCells, 0);
+        handoverFailures.assign(numCells, 0);
+        return true;
+    }
+
+    /**
+     * @brief Maps a cell ID to its slot.
+     * @param cellId Cell ID.
+     * @return Cell slot, or NO_CELL for an unknown cell.
+     */
+    uint32_t Slot(uint16_t cellId) const
+    {
+        return (cellId < cellSlot.size()) ? cellSlot[cellId] : NO_CELL;
+    }
+
+    /**
+     * @brief Records the initial serving cell of a UE.
+     * @param ueIndex UE index.
+     * @param imsi UE IMSI.
+     * @param cellId Serving cell ID.
+     */
+    void Attach(uint32_t ueIndex, uint64_t imsi, uint16_t cellId)
+    {
+        ueImsi[ueIndex] = imsi;
+        if (imsi >= imsiCell.size())
+        {
+            imsiCell.resize(imsi + 1, NO_CELL);
+        }
+        imsiCell[imsi] = Slot(cellId);
+        if (imsiCell[imsi] != NO_CELL)
+        {
+            attachedUes[imsiCell[imsi]]++;
+        }
+    }
+
+    /**
+     * @brief Moves a UE to its new serving cell after a successful handover.
+     * @param imsi UE IMSI.
+     * @param targetCellId New serving cell ID.
+     */
+    void Handover(uint64_t imsi, uint16_t targetCellId)
+    {
+        uint32_t target = Slot(targetCellId);
+        if (imsi >= imsiCell.size() || target == NO_CELL || imsiCell[imsi] == target)
+        {
+            return;
+        }
+        uint32_t source = imsiCell[imsi];
+        if (source != NO_CELL)
+        {
+            handoverOut[source]++;
+            attachedUes[source]--;
+        }
+        handoverIn[target]++;
+        attachedUes[target]++;
+        imsiCell[imsi] = target;
+    }
+
+    /**
+     * @brief Counts a failed handover against its source cell.
+     * @param cellId Source cell ID.
+     */
+    void HandoverFailure(uint16_t cellId)
+    {
+        uint32_t slot = Slot(cellId);
+        if (slot != NO_CELL)
+        {
+            handoverFailures[slot]++;
+        }
+    }
+
+    /**
+     * @brief Adds a UE's interval deltas to its serving cell.
+     * @param ueIndex UE index.
+     * @param bytes Bytes received in the interval.
+     * @param packets Packets received in the interval.
+     * @param delay Sum of their one-way delays in seconds.
+     */
+    void Add(uint32_t ueIndex, uint64_t bytes, uint64_t packets, double delay)
+    {
+        uint64_t imsi = ueImsi[ueIndex];
+        uint32_t slot = (imsi < imsiCell.size()) ? imsiCell[imsi] : NO_CELL;
+        if (slot == NO_CELL || packets == 0)
+        {
+            return;
+        }
+        activeUes[slot]++;
+        rxBytes[slot] += bytes;
+        rxPackets[slot] += packets;
+        delaySum[slot] += delay;
+    }
+
+    /**
+     * @brief Writes one row per cell and clears the interval accumulators.
+     * @param time Sample time in seconds.
+     * @param interval Interval length in seconds.
+     */
+    void WriteSample(double time, double interval)
+    {
+        for (size_t slot = 0; slot < cellIds.size(); ++slot)
+        {
+            double avgLatencyMs =
+                (rxPackets[slot] > 0) ? delaySum[slot] / rxPackets[slot] * 1e3 : 0.0;
+            file << time << "," << cellIds[slot] << "," << attachedUes[slot] << ","
+                 << activeUes[slot] << "," << rxBytes[slot] * 8.0 / 1000.0 / interval << ","
+                 << avgLatencyMs << "," << handoverIn[slot] << "," << handoverOut[slot] << ","
+                 << handoverFailures[slot] << "\n";
+        }
+        std::fill(activeUes.begin(), activeUes.end(), 0);
+        std::fill(rxBytes.begin(), rxBytes.end(), 0);
+        std::fill(rxPackets.begin(), rxPackets.end(), 0);
+        std::fill(delaySum.begin(), delaySum.end(), 0.0);
+        std::fill(handoverIn.begin(), handoverIn.end(), 0);
+        std::fill(handoverOut.begin(), handoverOut.end(), 0);
+        std::fill(handoverFailures.begin(), handoverFailures.end(), 0);
+    }
+};
+
+CellKpiAggregator g_cellKpi; ///< Per-cell KPIs (file closed when disabled)
+
+/**
+ * @struct LteTraceSampler
+ * @brief Decimated, UE-filterable replacements for the PHY and MAC LTE trace files.
+ *
+ * The built-in LteHelper PHY/MAC traces write one line per TTI and cannot be filtered.
+ * These sinks hook the same trace sources directly on the selected devices and keep only
+ * every decimation-th UE PHY report and every decimation-th TTI of MAC scheduling.
+ */
+struct LteTraceSampler
+{
+    uint32_t decimation = 1;                 ///< Keep every Nth record
+    std::ofstream phyFile;                   ///< Sampled UE RSRP/SINR reports
+    std::ofstream macFile;                   ///< Sampled eNB DL/UL scheduling decisions
+    std::vector<uint64_t> phyReportCount;    ///< Per-UE PHY reports seen so far
+    std::vector<uint64_t> ueImsi;            ///< IMSI per UE index
+    bool filterUes = false;                  ///< Only a subset of UEs is traced
+    std::unordered_set<uint32_t> tracedKeys; ///< Key() of each traced UE's current connection
+
+    /**
+     * @brief Packs a (cellId, rnti) pair into one set key.
+     * @param cellId Serving cell ID.
+     * @param rnti RNTI within the cell.
+     * @return The key.
+     */
+    static uint32_t Key(uint16_t cellId, uint16_t rnti)
+    {
+        return (static_cast<uint32_t>(cellId) << 16) | rnti;
+    }
+
+    /**
+     * @brief Checks whether a (cellId, rnti) pair belongs to a traced UE.
+     * @param cellId Serving cell ID.
+     * @param rnti RNTI within the cell.
+     * @return true if all UEs are traced or the pair matches a traced UE.
+     */
+    bool IsTraced(uint16_t cellId, uint16_t rnti) const
+    {
+        return !filterUes || tracedKeys.count(Key(cellId, rnti)) != 0;
+    }
+
+    /**
+     * @brief Closes the trace files.
+     */
+    void Close()
+    {
+        if (phyFile.is_open())
+            phyFile.close();
+        if (macFile.is_open())
+            macFile.close();
+    }
+};
+
+LteTraceSampler g_lteTraceSampler;
+
+/**
+ * @struct SchedulerDirectionStats
+ * @brief Cost and allocation counters of one direction (DL or UL) of one cell's scheduler.
+ */
+struct SchedulerDirectionStats
+{
+    uint64_t ttis = 0;              ///< Trigger calls (one per TTI)
+    uint64_t activeTtis = 0;        ///< TTIs with at least one allocation
+    uint64_t allocations = 0;       ///< Scheduled UEs, summed over TTIs
+    uint64_t rbs = 0;               ///< Allocated resource blocks, summed over TTIs
+    uint64_t bytes = 0;             ///< Allocated transport block bytes, summed over TTIs
+    double totalNs = 0.0;           ///< Wall-clock time spent in the scheduler
+    double maxNs = 0.0;             ///< Most expensive single call
+    std::vector<uint32_t> costBins; ///< LogHistogram of the call cost, fed in ns
+};
+
+/**
+ * @struct SchedulerProfile
+ * @brief Scheduler profile of one component carrier of one cell, filled by
+ *        ProfilingFfMacScheduler.
+ */
+struct SchedulerProfile
+{
+    SchedulerDirectionStats dl; ///< SchedDlTriggerReq / SchedDlConfigInd
+    SchedulerDirectionStats ul; ///< SchedUlTriggerReq / SchedUlConfigInd
+};
+
+/// Scheduler profiles keyed by (cellId, component carrier ID)
+std::map<std::pair<uint16_t, uint8_t>, SchedulerProfile> g_schedulerProfiles;
+std::ofstream g_schedulerTtiFile; ///< Per-TTI scheduler records (--schedulerProfile=tti)
+
+/**
+ * @class ProfilingFfMacScheduler
+ * @brief FF MAC scheduler decorator that times another scheduler and counts its allocations.
+ *
+ * Creates the scheduler named by the "Scheduler" attribute and sits between it and the eNB
+ * MAC on the scheduling SAP: SchedDlTriggerReq and SchedUlTriggerReq are timed with a
+ * steady clock, and the SchedDlConfigInd/SchedUlConfigInd results the scheduler hands back
+ * are counted (RBs, TB bytes, UEs) before they are forwarded to the MAC. The scheduler
+ * delivers those results from inside the trigger call, so the time the MAC spends handling
+ * them is measured separately and subtracted. The CSCHED and FFR SAPs are passed through.
+ *
+ * An eNodeB creates one instance per component carrier. Once the devices exist, Bind() ties
+ * each instance to the (cellId, ccId) entry of g_schedulerProfiles.
+ */
+class ProfilingFfMacScheduler : public FfMacScheduler
+{
+  public:
+    /**
+     * @brief Registers the scheduler type and its attributes.
+     * @return The TypeId.
+     */
+    static TypeId GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("ProfilingFfMacScheduler")
+                .SetParent<FfMacScheduler>()
+                .SetGroupName("Lte")
+                .AddConstructor<ProfilingFfMacScheduler>()
+                .AddAttribute("Scheduler",
+                              "TypeId of the profiled scheduler",
+                              StringValue("ns3::RrFfMacScheduler"),
+                              MakeStringAccessor(&ProfilingFfMacScheduler::m_schedulerType),
+                              MakeStringChecker())
+                .AddAttribute("RbgSize",
+                              "Resource blocks per DL resource block group (type 0 allocation)",
+                              UintegerValue(1),
+                              MakeUintegerAccessor(&ProfilingFfMacScheduler::m_rbgSize),
+                              MakeUintegerChecker<uint32_t>());
+        return tid;
+    }
+
+    ProfilingFfMacScheduler()
+        : m_provider(this),
+          m_user(this)
+    {
+    }
+
+    /**
+     * @brief Binds this scheduler to the profile entry of its carrier.
+     * @param cellId Cell ID of the component carrier.
+     * @param ccId Component carrier ID within the eNodeB.
+     */
+    void Bind(uint16_t cellId, uint8_t ccId)
+    {
+        m_cellId = cellId;
+        m_ccId = ccId;
+        m_profile = &g_schedulerProfiles[{cellId, ccId}];
+        m_profile->dl.costBins.assign(LogHistogram::BINS, 0);
+        m_profile->ul.costBins.assign(LogHistogram::BINS, 0);
+    }
+
+    void SetFfMacCschedSapUser(FfMacCschedSapUser* s) override
+    {
+        m_scheduler->SetFfMacCschedSapUser(s);
+    }
+
+    void SetFfMacSchedSapUser(FfMacSchedSapUser* s) override
+    {
+        m_macSapUser = s;
+        m_scheduler->SetFfMacSchedSapUser(&m_user);
+    }
+
+    FfMacCschedSapProvider* GetFfMacCschedSapProvider() override
+    {
+        return m_scheduler->GetFfMacCschedSapProvider();
+    }
+
+    FfMacSchedSapProvider* GetFfMacSchedSapProvider() override
+    {
+        return &m_provider;
+    }
+
+    void SetLteFfrSapProvider(LteFfrSapProvider* s) override
+    {
+        m_scheduler->SetLteFfrSapProvider(s);
+    }
+
+    LteFfrSapUser* GetLteFfrSapUser() override
+    {
+        return m_scheduler->GetLteFfrSapUser();
+    }
+
+  protected:
+    void NotifyConstructionCompleted() override
+    {
+        FfMacScheduler::NotifyConstructionCompleted();
+        ObjectFactory factory;
+        factory.SetTypeId(m_schedulerType);
+        m_scheduler = factory.Create<FfMacScheduler>();
+        m_schedulerSapProvider = m_scheduler->GetFfMacSchedSapProvider();
+    }
+
+    void DoInitialize() override
+    {
+        m_scheduler->Initialize();
+        FfMacScheduler::DoInitialize();
+    }
+
+    void DoDispose() override
+    {
+        m_scheduler->Dispose();
+        m_scheduler = nullptr;
+        FfMacScheduler::DoDispose();
+    }
+
+  private:
+    using Clock = std::chrono::steady_clock; ///< Clock used for the call cost
+
+    /**
+     * @brief Scheduling SAP seen by the MAC: times the triggers, forwards everything.
+     */
+    class ProviderProxy : public FfMacSchedSapProvider
+    {
+      public:
+        /**
+         * @brief Constructor.
+         * @param owner Owning decorator.
+         */
+        explicit ProviderProxy(ProfilingFfMacScheduler* owner)
+            : m_owner(owner)
+        {
+        }
+
+        void SchedDlRlcBufferReq(const SchedDlRlcBufferReqParameters& params) override
+        {
+            m_owner->m_schedulerSapProvider->SchedDlRlcBufferReq(params);
+        }
+
+        void SchedDlPagingBufferReq(const SchedDlPagingBufferReqParameters& params) override
+        {
+            m_owner->m_schedulerSapProvider->SchedDlPagingBufferReq(params);
+        }
+
+        void SchedDlMacBufferReq(const SchedDlMacBufferReqParameters& params) override
+        {
+            m_owner->m_schedulerSapProvider->SchedDlMacBufferReq(params);
+        }
+
+        void SchedDlTriggerReq(const SchedDlTriggerReqParameters& params) override
+        {
+            m_owner->m_forwardNs = 0.0;
+            auto start = Clock::now();
+            m_owner->m_schedulerSapProvider->SchedDlTriggerReq(params);
+            m_owner->RecordTrigger(&SchedulerProfile::dl, 'D', start);
+        }
+
+        void SchedDlRachInfoReq(const SchedDlRachInfoReqParameters& params) override
+        {
+            m_owner->m_schedulerSapProvider->SchedDlRachInfoReq(params);
+        }
+
+        void SchedDlCqiInfoReq(const SchedDlCqiInfoReqParameters& params) override
+        {
+            m_owner->m_schedulerSapProvider->SchedDlCqiInfoReq(params);
+        }
+
+        void SchedUlTriggerReq(const SchedUlTriggerReqParameters& params) override
+        {
+            m_owner->m_forwardNs = 0.0;
+            auto start = Clock::now();
+            m_owner->m_schedulerSapProvider->SchedUlTriggerReq(params);
+            m_owner->RecordTrigger(&SchedulerProfile::ul, 'U', start);
+        }
+
+        void SchedUlNoiseInterferenceReq(
+            const SchedUlNoiseInterferenceReqParameters& params) override
+        {
+            m_owner->m_schedulerSapProvider->SchedUlNoiseInterferenceReq(params);
+        }
+
+        void SchedUlSrInfoReq(const SchedUlSrInfoReqParameters& params) override
+        {
+            m_owner->m_schedulerSapProvider->SchedUlSrInfoReq(params);
+        }
+
+        void SchedUlMacCtrlInfoReq(const SchedUlMacCtrlInfoReqParameters& params) override
+        {
+            m_owner->m_schedulerSapProvider->SchedUlMacCtrlInfoReq(params);
+        }
+
+        void SchedUlCqiInfoReq(const SchedUlCqiInfoReqParameters& params) override
+        {
+            m_owner->m_schedulerSapProvider->SchedUlCqiInfoReq(params);
+        }
+
+      private:
+        ProfilingFfMacScheduler* m_owner; ///< Owning decorator
+    };
+
+    /**
+     * @brief Scheduling SAP seen by the scheduler: counts the allocations, forwards them.
+     */
+    class UserProxy : public FfMacSchedSapUser
+    {
+      public:
+        /**
+         * @brief Constructor.
+         * @param owner Owning decorator.
+         */
+        explicit UserProxy(ProfilingFfMacScheduler* owner)
+            : m_owner(owner)
+        {
+        }
+
+        void SchedDlConfigInd(const SchedDlConfigIndParameters& params) override
+        {
+            uint32_t rbs = 0;
+            uint32_t bytes = 0;
+            for (const auto& element : params.m_buildDataList)
+            {
+                rbs += __builtin_popcount(element.m_dci.m_rbBitmap) * m_owner->m_rbgSize;
+                for (uint16_t tbSize : element.m_dci.m_tbsSize)
+                {
+                    bytes += tbSize;
+                }
+            }
+            m_owner->CountAllocations(params.m_buildDataList.size(), rbs, bytes);
+            auto start = Clock::now();
+            m_owner->m_macSapUser->SchedDlConfigInd(params);
+            m_owner->m_forwardNs +=
+                std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        }
+
+        void SchedUlConfigInd(const SchedUlConfigIndParameters& params) override
+        {
+            uint32_t rbs = 0;
+            uint32_t bytes = 0;
+            for (const auto& dci : params.m_dciList)
+            {
+                rbs += dci.m_rbLen;
+                bytes += dci.m_tbSize;
+            }
+            m_owner->CountAllocations(params.m_dciList.size(), rbs, bytes);
+            auto start = Clock::now();
+            m_owner->m_macSapUser->SchedUlConfigInd(params);
+            m_owner->m_forwardNs +=
+                std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        }
+
+      private:
+        ProfilingFfMacScheduler* m_owner; ///< Owning decorator
+    };
+
+    /**
+     * @brief Remembers the allocations of the running trigger call.
+     * @param ues Scheduled UEs.
+     * @param rbs Allocated resource blocks.
+     * @param bytes Allocated transport block bytes.
+     */
+    void CountAllocations(uint32_t ues, uint32_t rbs, uint32_t bytes)
+    {
+        m_pendingUes += ues;
+        m_pendingRbs += rbs;
+        m_pendingBytes += bytes;
+    }
+
+    /**
+     * @brief Accounts one finished trigger call.
+     * @param direction Direction counters of the profile to update.
+     * @param tag 'D' or 'U', for the per-TTI file.
+     * @param start Time the trigger call started.
+     */
+    void RecordTrigger(SchedulerDirectionStats SchedulerProfile::*direction,
+                       char tag,
+                       Clock::time_point start)
+    {
+        double costNs = std::max(
+            0.0,
+            std::chrono::duration<double, std::nano>(Clock::now() - start).count() - m_forwardNs);
+        if (!m_profile)
+        {
+            return; // Not bound to a carrier
+        }
+        SchedulerDirectionStats& stats = m_profile->*direction;
+        stats.ttis++;
+        stats.activeTtis += (m_pendingUes > 0);
+        stats.allocations += m_pendingUes;
+        stats.rbs += m_pendingRbs;
+        stats.bytes += m_pendingBytes;
+        stats.totalNs += costNs;
+        stats.maxNs = std::max(stats.maxNs, costNs);
+        // Nanoseconds fed as microseconds: the bins then resolve 1 ns up to about 4.2 ms
+        stats.costBins[LogHistogram::BinIndex(costNs * 1e-6)]++;
+        if (g_schedulerTtiFile.is_open())
+        {
+            g_schedulerTtiFile << Simulator::Now().GetSeconds() << "," << m_cellId << ","
+                               << (uint32_t)m_ccId << "," << tag << "," << costNs / 1000.0 << ","
+                               << m_pendingUes << "," << m_pendingRbs << "," << m_pendingBytes
+                               << "\n";
+        }
+        m_pendingUes = 0;
+        m_pendingRbs = 0;
+        m_pendingBytes = 0;
+    }
+
+    std::string m_schedulerType;                             ///< TypeId of the profiled scheduler
+    uint32_t m_rbgSize = 1;                                  ///< RBs per DL RBG
+    Ptr<FfMacScheduler> m_scheduler;                         ///< Profiled scheduler
+    FfMacSchedSapProvider* m_schedulerSapProvider = nullptr; ///< SAP of the profiled scheduler
+    FfMacSchedSapUser* m_macSapUser = nullptr;               ///< SAP of the eNB MAC
+    ProviderProxy m_provider;                                ///< SAP handed to the MAC
+    UserProxy m_user;                                        ///< SAP handed to the scheduler
+    SchedulerProfile* m_profile = nullptr;                   ///< Entry in g_schedulerProfiles
+    uint16_t m_cellId = 0;                                   ///< Cell ID of the carrier
+    uint8_t m_ccId = 0;                                      ///< Component carrier ID
+    double m_forwardNs = 0.0;    ///< Time spent in the MAC during the running trigger
+    uint32_t m_pendingUes = 0;   ///< UEs allocated by the running trigger
+    uint32_t m_pendingRbs = 0;   ///< RBs allocated by the running trigger
+    uint32_t m_pendingBytes = 0; ///< TB bytes allocated by the running trigger
+};
+
+NS_OBJECT_ENSURE_REGISTERED(ProfilingFfMacScheduler);
+
+/**
+ * @class EnbSpatialIndex
+ * @brief Uniform grid over eNodeB positions for nearest-eNodeB queries.
+ *
+ * The grid is sized for about one eNodeB per cell, and a query scans rings of cells around
+ * the query point until no unvisited cell can hold a closer eNodeB. This makes a query O(1)
+ * on average instead of O(numEnb). Distances are full 3D (as CalculateDistance), and ties go
+ * to the lowest eNodeB index, so results are identical to a brute-force scan.
+ */
+class EnbSpatialIndex
+{
+  public:
+    /**
+     * @brief Builds the index.
+     * @param positions eNodeB positions, indexed by eNodeB index.
+     */
+    void Build(const std::vector<Vector>& positions)
+    {
+        m_positions = positions;
+        m_cols = m_rows = 0;
+        m_cellStart.clear();
+        m_cellItems.clear();
+        if (m_positions.empty())
+        {
+            return;
+        }
+
+        double maxX = m_positions[0].x;
+        double maxY = m_positions[0].y;
+        m_minX = maxX;
+        m_minY = maxY;
+        for (const auto& pos : m_positions)
+        {
+            m_minX = std::min(m_minX, pos.x);
+            m_minY = std::min(m_minY, pos.y);
+            maxX = std::max(maxX, pos.x);
+            maxY = std::max(maxY, pos.y);
+        }
+        double width = std::max(maxX - m_minX, 1.0);
+        double height = std::max(maxY - m_minY, 1.0);
+        m_cellSize = std::sqrt(width * height / m_positions.size());
+        m_cellSize = std::max(m_cellSize, std::max(width, height) / 1024.0);
+        m_cols = static_cast<int32_t>(width / m_cellSize) + 1;
+        m_rows = static_cast<int32_t>(height / m_cellSize) + 1;
+
+        // Bucket the eNodeBs per cell in compressed (CSR) form
+        std::vector<uint32_t> counts(m_cols * m_rows + 1, 0);
+        for (const auto& pos : m_positions)
+        {
+            counts[CellOf(pos.x, pos.y) + 1]++;
+        }
+        for (size_t c = 1; c < counts.size(); ++c)
+        {
+            counts[c] += counts[c - 1];
+        }
+        m_cellStart = counts;
+        m_cellItems.resize(m_positions.size());
+        for (uint32_t i = 0; i < m_positions.size(); ++i)
+        {
+            m_cellItems[counts[CellOf(m_positions[i].x, m_positions[i].y)]++] = i;
+        }
+    }
+
+    /**
+     * @brief Finds the eNodeB closest to a position.
+     * @param pos Query position.
+     * @return Index of the closest eNodeB (0 if the index is empty).
+     */
+    uint32_t FindNearest(const Vector& pos) const
+    {
+        if (m_positions.empty())
+        {
+            return 0;
+        }
+
+        int32_t cx = ClampCol(pos.x);
+        int32_t cy = ClampRow(pos.y);
+        double bestDistSq = std::numeric_limits<double>::max();
+        uint32_t best = 0;
+        int32_t maxRing = std::max(m_cols, m_rows);
+        for (int32_t ring = 0; ring <= maxRing; ++ring)
+        {
+            // Visit the cells on the border of the (2 * ring + 1)^2 block around (cx, cy)
+            for (int32_t y = cy - ring; y <= cy + ring; ++y)
+            {
+                if (y < 0 || y >= m_rows)
+                    continue;
+                bool edgeRow = (y == cy - ring || y == cy + ring);
+                int32_t step = edgeRow ? 1 : 2 * ring;
+                for (int32_t x = cx - ring; x <= cx + ring; x += std::max(step, 1))
+                {
+                    if (x < 0 || x >= m_cols)
+                        continue;
+                    uint32_t cell = y * m_cols + x;
+                    for (uint32_t k = m_cellStart[cell]; k < m_cellStart[cell + 1]; ++k)
+                    {
+                        uint32_t idx = m_cellItems[k];
+                        const Vector& enb = m_positions[idx];
+                        double dx = enb.x - pos.x;
+                        double dy = enb.y - pos.y;
+                        double dz = enb.z - pos.z;
+                        double distSq = dx * dx + dy * dy + dz * dz;
+                        if (distSq < bestDistSq || (distSq == bestDistSq && idx < best))
+                        {
+                            bestDistSq = distSq;
+                            best = idx;
+                        }
+                    }
+                }
+            }
+
+            // Lower bound on the 2D distance to any cell outside the visited block, taken
+            // over the sides that still have grid cells beyond them
+            double bound = std::numeric_limits<double>::max();
+            if (cx - ring > 0)
+                bound = std::min(bound, pos.x - (m_minX + (cx - ring) * m_cellSize));
+            if (cx + ring < m_cols - 1)
+                bound = std::min(bound, m_minX + (cx + ring + 1) * m_cellSize - pos.x);
+            if (cy - ring > 0)
+                bound = std::min(bound, pos.y - (m_minY + (cy - ring) * m_cellSize));
+            if (cy + ring < m_rows - 1)
+                bound = std::min(bound, m_minY + (cy + ring + 1) * m_cellSize - pos.y);
+            if (bound == std::numeric_limits<double>::max() ||
+                (bound > 0 && bound * bound > bestDistSq))
+            {
+                break;
+            }
+        }
+        return best;
+    }
+
+    /**
+     * @return Number of indexed eNodeBs.
+     */
+    size_t GetN() const
+    {
+        return m_positions.size();
+    }
+
+  private:
+    /// @return Column of x, clamped to the grid.
+    int32_t ClampCol(double x) const
+    {
+        int32_t col = static_cast<int32_t>(std::floor((x - m_minX) / m_cellSize));
+        return std::max(0, std::min(col, m_cols - 1));
+    }
+
+    /// @return Row of y, clamped to the grid.
+    int32_t ClampRow(double y) const
+    {
+        int32_t row = static_cast<int32_t>(std::floor((y - m_minY) / m_cellSize));
+        return std::max(0, std::min(row, m_rows - 1));
+    }
+
+    /// @return Flat cell index of (x, y).
+    uint32_t CellOf(double x, double y) const
+    {
+        return ClampRow(y) * m_cols + ClampCol(x);
+    }
+
+    std::vector<Vector> m_positions;  ///< eNodeB positions
+    double m_minX = 0.0;              ///< Grid origin X
+    double m_minY = 0.0;              ///< Grid origin Y
+    double m_cellSize = 1.0;          ///< Grid cell edge in meters
+    int32_t m_cols = 0;               ///< Grid columns
+    int32_t m_rows = 0;               ///< Grid rows
+    std::vector<uint32_t> m_cellStart; ///< Per-cell start offsets into m_cellItems (+1 sentinel)
+    std::vector<uint32_t> m_cellItems; ///< eNodeB indices grouped by cell
+};
+
+EnbSpatialIndex g_enbSpatialIndex; ///< Nearest-eNodeB index, built once eNodeBs are placed
+
+/**
+ * @class BatchedThreeLogDistanceLossModel
+ * @brief Drop-in replacement for ThreeLogDistancePropagationLossModel that evaluates the
+ *        losses of one UE to all eNodeBs at once and caches them until the UE moves.
+ *
+ * The ns-3 model computes CalcDistance and log10 for every (transmitter, receiver) pair of
+ * every transmission. Here mobility models whose node carries an LteEnbNetDevice are
+ * "anchors" kept in contiguous x/y/z arrays; every other model (a UE) owns one cache row
+ * with its loss to each anchor, refilled in one branch-free loop over the anchor arrays.
+ *
+ * Rows are invalidated by the CourseChange trace of the mobility models rather than by
+ * polling positions: a row is refilled after its UE (or any anchor) changed course, and for
+ * a UE moving at non-zero velocity at most once per simulation time. UEs that never move,
+ * such as in the CONSTANT_* mobility modes, compute their row once for the whole run and
+ * every DL or UL lookup after that is a table read.
+ *
+ * Attributes and results match the ns-3 model: no loss below Distance0, then Exponent0,
+ * Exponent1 and Exponent2 from Distance0, Distance1 and Distance2 on, relative to
+ * ReferenceLoss at Distance0. UE-UE and eNB-eNB pairs are computed directly.
+ */
+class BatchedThreeLogDistanceLossModel : public PropagationLossModel
+{
+  public:
+    /**
+     * @brief Registers the model type and its attributes.
+     * @return The TypeId.
+     */
+    static TypeId GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("BatchedThreeLogDistanceLossModel")
+                .SetParent<PropagationLossModel>()
+                .SetGroupName("Propagation")
+                .AddConstructor<BatchedThreeLogDistanceLossModel>()
+                .AddAttribute("Distance0",
+                              "Beginning of the first (near) distance field",
+                              DoubleValue(1.0),
+                              MakeDoubleAccessor(&BatchedThreeLogDistanceLossModel::m_distance0),
+                              MakeDoubleChecker<double>())
+                .AddAttribute("Distance1",
+                              "Beginning of the second (middle) distance field",
+                              DoubleValue(200.0),
+                              MakeDoubleAccessor(&BatchedThreeLogDistanceLossModel::m_distance1),
+                              MakeDoubleChecker<double>())
+                .AddAttribute("Distance2",
+                              "Beginning of the third (far) distance field",
+                              DoubleValue(500.0),
+                              MakeDoubleAccessor(&BatchedThreeLogDistanceLossModel::m_distance2),
+                              MakeDoubleChecker<double>())
+                .AddAttribute("Exponent0",
+                              "The exponent for the first field",
+                              DoubleValue(1.9),
+                              MakeDoubleAccessor(&BatchedThreeLogDistanceLossModel::m_exponent0),
+                              MakeDoubleChecker<double>())
+                .AddAttribute("Exponent1",
+                              "The exponent for the second field",
+                              DoubleValue(3.8),
+                              MakeDoubleAccessor(&BatchedThreeLogDistanceLossModel::m_exponent1),
+                              MakeDoubleChecker<double>())
+                .AddAttribute("Exponent2",
+                              "The exponent for the third field",
+                              DoubleValue(3.8),
+                              MakeDoubleAccessor(&BatchedThreeLogDistanceLossModel::m_exponent2),
+                              MakeDoubleChecker<double>())
+                .AddAttribute(
+                    "ReferenceLoss",
+                    "The reference loss at distance d0 (dB)",
+                    DoubleValue(46.6777),
+                    MakeDoubleAccessor(&BatchedThreeLogDistanceLossModel::m_referenceLoss),
+                    MakeDoubleChecker<double>());
+        return tid;
+    }
+
+  private:
+    double DoCalcRxPower(double txPowerDbm,
+                         Ptr<MobilityModel> a,
+                         Ptr<MobilityModel> b) const override
+    {
+        uint32_t idA = Lookup(a);
+        uint32_t idB = Lookup(b);
+        bool anchorA = idA & ANCHOR_FLAG;
+        bool anchorB = idB & ANCHOR_FLAG;
+        if (anchorA == anchorB)
+        {
+            double distance = a->GetDistanceFrom(b);
+            return txPowerDbm - PathLossDb(std::log10(std::max(distance, 1e-9)), distance);
+        }
+
+        uint32_t ue = anchorA ? idB : idA;
+        uint32_t anchor = (anchorA ? idA : idB) & ~ANCHOR_FLAG;
+        if (m_movingAnchors > 0)
+        {
+            RefreshAnchors();
+        }
+        UeRow& row = m_rows[ue];
+        if (row.generation != m_anchorGeneration ||
+            (row.moving && row.filledAt != Simulator::Now()))
+        {
+            FillRow((anchorA ? b : a)->GetPosition(), &m_loss[static_cast<size_t>(ue) * m_stride]);
+            row.generation = m_anchorGeneration;
+            row.filledAt = Simulator::Now();
+        }
+        return txPowerDbm - m_loss[static_cast<size_t>(ue) * m_stride + anchor];
+    }
+
+    int64_t DoAssignStreams([[maybe_unused]] int64_t stream) override
+    {
+        return 0; // Deterministic model, no random variables
+    }
+
+    void DoDispose() override
+    {
+        // m_ids is keyed by raw model pointers; drop them with the Ptrs to the anchors
+        m_ids.clear();
+        m_anchors.clear();
+        m_anchorX.clear();
+        m_anchorY.clear();
+        m_anchorZ.clear();
+        m_anchorMoving.clear();
+        m_movingAnchors = 0;
+        m_rows.clear();
+        m_loss.clear();
+        m_stride = 0;
+        PropagationLossModel::DoDispose();
+    }
+
+    static constexpr uint32_t ANCHOR_FLAG = 0x80000000u; ///< Marks anchor ids in m_ids
+
+    /**
+     * @brief Cache row state of one UE.
+     */
+    struct UeRow
+    {
+        Time filledAt = Seconds(-1); ///< Simulation time the row was last filled
+        uint64_t generation = 0;     ///< Anchor generation it was filled for (0 = stale)
+        bool moving = false;         ///< UE velocity was non-zero at its last course change
+    };
+
+    /**
+     * @brief Path loss as a function of distance.
+     * @param log10Distance log10 of the distance in meters.
+     * @param distance Distance in meters.
+     * @return Loss in dB.
+     */
+    double PathLossDb(double log10Distance, double distance) const
+    {
+        if (distance < m_distance0)
+        {
+            return 0.0;
+        }
+        uint32_t field = (distance >= m_distance1) + (distance >= m_distance2);
+        return m_offset[field] + m_slope[field] * log10Distance;
+    }
+
+    /**
+     * @brief Computes the loss of one UE position to every anchor.
+     * @param pos UE position.
+     * @param out m_stride losses in dB.
+     */
+    void FillRow(const Vector& pos, double* out) const
+    {
+        const size_t n = m_anchorX.size();
+        const double* ax = m_anchorX.data();
+        const double* ay = m_anchorY.data();
+        const double* az = m_anchorZ.data();
+        for (size_t i = 0; i < n; ++i)
+        {
+            double dx = ax[i] - pos.x;
+            double dy = ay[i] - pos.y;
+            double dz = az[i] - pos.z;
+            out[i] = dx * dx + dy * dy + dz * dz;
+        }
+        // Locals instead of members so the compiler can keep them in registers
+        const double d0Sq = m_distance0 * m_distance0;
+        const double d1Sq = m_distance1 * m_distance1;
+        const double d2Sq = m_distance2 * m_distance2;
+        const double o0 = m_offset[0], o1 = m_offset[1], o2 = m_offset[2];
+        const double s0 = m_slope[0], s1 = m_slope[1], s2 = m_slope[2];
+        for (size_t i = 0; i < n; ++i)
+        {
+            double distSq = out[i];
+            double lg = 0.5 * std::log10(std::max(distSq, 1e-18)); // log10 of the distance
+            bool mid = distSq >= d1Sq;
+            bool far = distSq >= d2Sq;
+            double offset = far ? o2 : (mid ? o1 : o0);
+            double slope = far ? s2 : (mid ? s1 : s0);
+            out[i] = (distSq < d0Sq) ? 0.0 : offset + slope * lg;
+        }
+    }
+
+    /**
+     * @brief Returns the id of a mobility model, classifying it on first sight.
+     * @param model Mobility model.
+     * @return UE row index, or anchor index with ANCHOR_FLAG set.
+     */
+    uint32_t Lookup(const Ptr<MobilityModel>& model) const
+    {
+        auto it = m_ids.find(PeekPointer(model));
+        if (it != m_ids.end())
+        {
+            return it->second;
+        }
+
+        bool isEnb = false;
+        Ptr<Node> node = model->GetObject<Node>();
+        for (uint32_t i = 0; node && i < node->GetNDevices() && !isEnb; ++i)
+        {
+            isEnb = static_cast<bool>(DynamicCast<LteEnbNetDevice>(node->GetDevice(i)));
+        }
+
+        uint32_t id;
+        if (isEnb)
+        {
+            id = static_cast<uint32_t>(m_anchors.size()) | ANCHOR_FLAG;
+            m_anchors.push_back(model);
+            m_anchorMoving.push_back(false);
+            m_anchorX.push_back(0.0);
+            m_anchorY.push_back(0.0);
+            m_anchorZ.push_back(0.0);
+            // The stride changes: rebuild the table and force every row to be refilled
+            m_stride = m_anchors.size();
+            m_loss.assign(m_rows.size() * m_stride, 0.0);
+        }
+        else
+        {
+            id = static_cast<uint32_t>(m_rows.size());
+            m_rows.emplace_back();
+            m_loss.resize(m_rows.size() * m_stride, 0.0);
+        }
+        if (!m_fieldsReady)
+        {
+            SetupFields();
+            m_fieldsReady = true;
+        }
+        m_ids.emplace(PeekPointer(model), id);
+        model->TraceConnectWithoutContext(
+            "CourseChange",
+            MakeCallback(&BatchedThreeLogDistanceLossModel::CourseChanged, this));
+        CourseChanged(model);
+        return id;
+    }
+
+    /**
+     * @brief CourseChange sink of every classified mobility model.
+     *
+     * A UE's row is marked stale and its moving state updated; an anchor's coordinates are
+     * re-read, which bumps the generation so every row is refilled.
+     * @param model Mobility model that changed course.
+     */
+    void CourseChanged(Ptr<const MobilityModel> model) const
+    {
+        auto it = m_ids.find(PeekPointer(model));
+        if (it == m_ids.end())
+        {
+            return;
+        }
+        Vector velocity = model->GetVelocity();
+        bool moving = velocity.x != 0.0 || velocity.y != 0.0 || velocity.z != 0.0;
+        if (it->second & ANCHOR_FLAG)
+        {
+            uint32_t anchor = it->second & ~ANCHOR_FLAG;
+            Vector pos = model->GetPosition();
+            m_anchorX[anchor] = pos.x;
+            m_anchorY[anchor] = pos.y;
+            m_anchorZ[anchor] = pos.z;
+            m_movingAnchors += static_cast<int32_t>(moving) - m_anchorMoving[anchor];
+            m_anchorMoving[anchor] = moving;
+            m_anchorGeneration++;
+        }
+        else
+        {
+            UeRow& row = m_rows[it->second];
+            row.generation = 0;
+            row.moving = moving;
+        }
+    }
+
+    /**
+     * @brief Re-reads the positions of moving anchors once per simulation time.
+     *
+     * Only called while some anchor has a non-zero velocity; eNodeBs normally never move.
+     */
+    void RefreshAnchors() const
+    {
+        if (m_anchorsCheckedAt == Simulator::Now())
+        {
+            return;
+        }
+        m_anchorsCheckedAt = Simulator::Now();
+        for (size_t i = 0; i < m_anchors.size(); ++i)
+        {
+            if (m_anchorMoving[i])
+            {
+                Vector pos = m_anchors[i]->GetPosition();
+                m_anchorX[i] = pos.x;
+                m_anchorY[i] = pos.y;
+                m_anchorZ[i] = pos.z;
+            }
+        }
+        m_anchorGeneration++;
+    }
+
+    /**
+     * @brief Precomputes loss = offset + slope * log10(d) for the three distance fields.
+     */
+    void SetupFields() const
+    {
+        double lg0 = std::log10(m_distance0);
+        double lg1 = std::log10(m_distance1);
+        double lg2 = std::log10(m_distance2);
+        double loss1 = m_referenceLoss + 10 * m_exponent0 * (lg1 - lg0); // Loss at Distance1
+        double loss2 = loss1 + 10 * m_exponent1 * (lg2 - lg1);           // Loss at Distance2
+        m_slope = {10 * m_exponent0, 10 * m_exponent1, 10 * m_exponent2};
+        m_offset = {m_referenceLoss - m_slope[0] * lg0,
+                    loss1 - m_slope[1] * lg1,
+                    loss2 - m_slope[2] * lg2};
+    }
+
+    double m_distance0 = 1.0;         ///< Start of the first distance field in meters
+    double m_distance1 = 200.0;       ///< Start of the second distance field in meters
+    double m_distance2 = 500.0;       ///< Start of the third distance field in meters
+    double m_exponent0 = 1.9;         ///< Path loss exponent of the first field
+    double m_exponent1 = 3.8;         ///< Path loss exponent of the second field
+    double m_exponent2 = 3.8;         ///< Path loss exponent of the third field
+    double m_referenceLoss = 46.6777; ///< Loss at Distance0 in dB
+
+    mutable bool m_fieldsReady = false;                ///< m_offset/m_slope computed
+    mutable std::array<double, 3> m_offset{};          ///< Per-field loss offset in dB
+    mutable std::array<double, 3> m_slope{};           ///< Per-field dB per decade
+    mutable std::unordered_map<const MobilityModel*, uint32_t> m_ids; ///< Model -> id
+    mutable std::vector<Ptr<MobilityModel>> m_anchors; ///< eNodeB mobility models
+    mutable std::vector<double> m_anchorX;             ///< Anchor x coordinates
+    mutable std::vector<double> m_anchorY;             ///< Anchor y coordinates
+    mutable std::vector<double> m_anchorZ;             ///< Anchor z coordinates
+    mutable std::vector<bool> m_anchorMoving;          ///< Anchor velocity is non-zero
+    mutable int32_t m_movingAnchors = 0;               ///< Number of moving anchors
+    mutable Time m_anchorsCheckedAt = Seconds(-1);     ///< Last RefreshAnchors time
+    mutable uint64_t m_anchorGeneration = 1;           ///< Bumped when anchors change
+    mutable std::vector<UeRow> m_rows;                 ///< Cache row state per UE
+    mutable std::vector<double> m_loss;                ///< UE x anchor losses in dB
+    mutable size_t m_stride = 0;                       ///< Anchors per row of m_loss
+};
+
+NS_OBJECT_ENSURE_REGISTERED(BatchedThreeLogDistanceLossModel);
+
+// NetAnim State
+AnimationInterface* g_anim = nullptr;  ///< NetAnim interface (nullptr when disabled)
+std::vector<Ptr<Node>> g_animUeNodes;  ///< UE nodes by UE index, for NetAnim annotations
+std::vector<uint32_t> g_imsiToUeIndex; ///< Dense IMSI -> UE index
+
+// Function Prototypes
+void ConfigureLogging(bool enableRrc);
+bool GenerateEnbLayout(const SimulationParameters& params, std::vector<EnbCell>& cells);
+void ConfigureEnbMobility(NodeContainer& enbNodes, const std::vector<EnbCell>& cells);
+uint32_t SelectSector(const std::vector<EnbCell>& cells, uint32_t nearestCell, const Vector& pos);
+bool SaveTopologySnapshot(const std::string& path, const TopologySnapshot& snapshot);
+bool LoadTopologySnapshot(const std::string& path, TopologySnapshot& snapshot);
+bool CheckTopologySnapshot(const std::string& path,
+                           const TopologySnapshot& snapshot,
+                           const SimulationParameters& params,
+                           const std::vector<EnbCell>& cells);
+void ConfigureUeMobility(NodeContainer& ueNodes,
+                         double areaSize,
+                         NodeContainer& enbNodes,
+                         SimulationParameters::MobilityMode mobilityMode,
+                         const SimulationParameters& params);
+Ipv4Address CreateRemoteHost(Ptr<PointToPointEpcHelper> epcHelper,
+                             NodeContainer& remoteHostContainer,
+                             double areaSize);
+void InstallVoipApplications(NodeContainer& ueNodes,
+                             const NetDeviceContainer& ueDevs,
+                             const std::vector<Ipv4Address>& ueAddresses,
+                             Ipv4Address remoteAddr,
+                             double simTime,
+                             NodeContainer& remoteHostContainer,
+                             const SimulationParameters& params);
+Ptr<FlowMonitor> SetupFlowMonitor(FlowMonitorHelper& flowHelper,
+                                  NodeContainer& ueNodes,
+                                  NodeContainer& remoteHostContainer);
+bool EnableLteTraces(Ptr<LteHelper> lteHelper,
+                     const NetDeviceContainer& enbDevs,
+                     const NetDeviceContainer& ueDevs,
+                     const SimulationParameters& params);
+bool SchedulerTypeName(const std::string& name, std::string& typeName);
+bool WriteSchedulerProfile(const std::string& path, const SimulationParameters& params);
+void PeriodicStatsUpdate(const SimulationParameters& params);
+double EstimateMos(const SimulationParameters::VoipCodec& codec,
+                   double networkDelayMs,
+                   double lossPercent);
+bool WriteFlowMonitorResults(Ptr<FlowMonitor> flowMonitor,
+                             Ptr<Ipv4FlowClassifier> classifier,
+                             const SimulationParameters& params);
+void AnalyzeData(Ptr<FlowMonitor> flowMonitor,
+                 Ptr<Ipv4FlowClassifier> classifier,
+                 const SimulationParameters& params);
+static std::vector<std::string> SplitList(const std::string& list);
+static bool ParseUnsigned(const std::string& text, uint64_t& value);
+bool WritePerformanceReport(const std::string& path,
+                            double setupWallSeconds,
+                            double runWallSeconds,
+                            double simSeconds);
+bool LoadConfigFile(const std::string& path, std::vector<std::string>& args);
+static std::string FindArgument(const std::vector<std::string>& args, const std::string& name);
+static void RunConfigStore(const std::string& path,
+                           const std::string& mode,
+                           bool defaults,
+                           bool attributes);
+int RunBenchmarkSuite(const BenchmarkParameters& benchmark, const std::vector<std::string>& args);
+int RunParameterSweep(const SweepParameters& sweep,
+                      const SimulationParameters& params,
+                      const std::vector<std::string>& args);
+
+/**
+ * @brief Annotates a UE in NetAnim with its serving cell (description and colour).
+ * @param imsi UE IMSI.
+ * @param cellId Serving cell ID.
+ */
+void
+AnimUpdateServingCell(uint64_t imsi, uint16_t cellId)
+{
+    if (!g_anim || imsi >= g_imsiToUeIndex.size())
+    {
+        return;
+    }
+    static const uint8_t palette[][3] = {{0, 200, 0},
+                                         {255, 140, 0},
+                                         {160, 32, 240},
+                                         {0, 180, 180},
+                                         {220, 20, 60},
+                                         {128, 128, 0}};
+    static const size_t paletteSize = sizeof(palette) / sizeof(palette[0]);
+    uint32_t ueIndex = g_imsiToUeIndex[imsi];
+    Ptr<Node> ueNode = g_animUeNodes[ueIndex];
+    const uint8_t* rgb = palette[cellId % paletteSize];
+    g_anim->UpdateNodeDescription(ueNode,
+                                  "UE_" + std::to_string(ueIndex) + " (cell " +
+                                      std::to_string(cellId) + ")");
+    g_anim->UpdateNodeColor(ueNode, rgb[0], rgb[1], rgb[2]);
+}
+
+// Handover Callback Functions
+void
+HandoverStartCallback(uint64_t imsi, uint16_t cellId, uint16_t targetCellId, unsigned short reason)
+{
+    Time currentTime = Simulator::Now();
+    g_handoverStartCount++;
+    g_statsScheduler.Densify();
+    g_handoverLogger.Push({currentTime.GetMilliSeconds(),
+                           imsi,
+                           cellId,
+                           targetCellId,
+                           reason,
+                           HandoverEventLogger::START});
+}
+
+void
+HandoverSuccessCallback(uint64_t imsi,
+                        uint16_t cellId,
+                        uint16_t targetCellId,
+                        unsigned short reason)
+{
+    Time currentTime = Simulator::Now();
+    g_handoverSuccessCount++;
+    g_handoverLogger.Push({currentTime.GetMilliSeconds(),
+                           imsi,
+                           cellId,
+                           targetCellId,
+                           reason,
+                           HandoverEventLogger::SUCCESS});
+    g_cellKpi.Handover(imsi, targetCellId);
+    AnimUpdateServingCell(imsi, targetCellId);
+}
+
+void
+HandoverFailureCallback(uint64_t imsi,
+                        uint16_t cellId,
+                        uint16_t targetCellId,
+                        unsigned short reason)
+{
+    Time currentTime = Simulator::Now();
+    g_handoverFailureCount++;
+    g_statsScheduler.Densify();
+    g_cellKpi.HandoverFailure(cellId);
+    g_handoverLogger.Push({currentTime.GetMilliSeconds(),
+                           imsi,
+                           cellId,
+                           targetCellId,
+                           reason,
+                           HandoverEventLogger::FAILURE});
+}
+
+// LTE Trace Sampling Callbacks
+/**
+ * @brief Starts tracing a traced UE's new (cellId, rnti) after connection or handover.
+ * @param imsi UE IMSI.
+ * @param cellId Serving cell ID.
+ * @param rnti RNTI within the cell.
+ */
+void
+TraceUeConnectionUp([[maybe_unused]] uint64_t imsi, uint16_t cellId, uint16_t rnti)
+{
+    g_lteTraceSampler.tracedKeys.insert(LteTraceSampler::Key(cellId, rnti));
+}
+
+/**
+ * @brief Stops tracing a traced UE's (cellId, rnti) when it fails.
+ * @param imsi UE IMSI.
+ * @param cellId Serving cell ID.
+ * @param rnti RNTI within the cell.
+ */
+void
+TraceUeConnectionDown([[maybe_unused]] uint64_t imsi, uint16_t cellId, uint16_t rnti)
+{
+    g_lteTraceSampler.tracedKeys.erase(LteTraceSampler::Key(cellId, rnti));
+}
+
+/**
+ * @brief Stops tracing a traced UE's source (cellId, rnti) when it starts a handover.
+ * @param imsi UE IMSI.
+ * @param cellId Source cell ID.
+ * @param rnti RNTI within the source cell.
+ * @param targetCellId Target cell ID.
+ */
+void
+TraceUeHandoverStart(uint64_t imsi,
+                     uint16_t cellId,
+                     uint16_t rnti,
+                     [[maybe_unused]] uint16_t targetCellId)
+{
+    TraceUeConnectionDown(imsi, cellId, rnti);
+}
+
+void
+TracePhyRsrpSinr(uint32_t ueIndex,
+                 uint16_t cellId,
+                 uint16_t rnti,
+                 double rsrp,
+                 double sinr,
+                 uint8_t componentCarrierId)
+{
+    if (g_lteTraceSampler.phyReportCount[ueIndex]++ % g_lteTraceSampler.decimation != 0)
+    {
+        return;
+    }
+    g_lteTraceSampler.phyFile << Simulator::Now().GetSeconds() << "\t" << cellId << "\t"
+                              << g_lteTraceSampler.ueImsi[ueIndex] << "\t" << rnti << "\t" << rsrp
+                              << "\t" << sinr << "\t" << (uint32_t)componentCarrierId << "\n";
+}
+
+void
+TraceMacDlScheduling(uint16_t cellId, DlSchedulingCallbackInfo info)
+{
+    if ((info.frameNo * 10 + info.subframeNo) % g_lteTraceSampler.decimation != 0 ||
+        !g_lteTraceSampler.IsTraced(cellId, info.rnti))
+    {
+        return;
+    }
+    g_lteTraceSampler.macFile << Simulator::Now().GetSeconds() << "\tDL\t" << cellId << "\t"
+                              << info.frameNo << "\t" << info.subframeNo << "\t" << info.rnti
+                              << "\t" << (uint32_t)info.mcsTb1 << "\t" << info.sizeTb1 << "\t"
+                              << (uint32_t)info.mcsTb2 << "\t" << info.sizeTb2 << "\t"
+                              << (uint32_t)info.componentCarrierId << "\n";
+}
+
+void
+TraceMacUlScheduling(uint16_t cellId,
+                     uint32_t frameNo,
+                     uint32_t subframeNo,
+                     uint16_t rnti,
+                     uint8_t mcs,
+                     uint16_t tbsSize,
+                     uint8_t componentCarrierId)
+{
+    if ((frameNo * 10 + subframeNo) % g_lteTraceSampler.decimation != 0 ||
+        !g_lteTraceSampler.IsTraced(cellId, rnti))
+    {
+        return;
+    }
+    g_lteTraceSampler.macFile << Simulator::Now().GetSeconds() << "\tUL\t" << cellId << "\t"
+                              << frameNo << "\t" << subframeNo << "\t" << rnti << "\t"
+                              << (uint32_t)mcs << "\t" << tbsSize << "\t0\t0\t"
+                              << (uint32_t)componentCarrierId << "\n";
+}
+
+/**
+ * @brief Tags an outgoing VoIP packet with its UE and transmit time.
+ * @param ueIndex Sending UE index (bound at connect time).
+ * @param packet Packet about to be sent by the UE's VoipCallApplication.
+ */
+void
+VoipTxTrace(uint32_t ueIndex, Ptr<const Packet> packet)
+{
+    VoipTimestampTag tag;
+    tag.ueIndex = ueIndex;
+    tag.txTimeNs = Simulator::Now().GetNanoSeconds();
+    packet->AddPacketTag(tag);
+
+    g_voipKpi.txPackets[ueIndex]++;
+    g_voipKpi.firstTxTime[ueIndex] =
+        std::min(g_voipKpi.firstTxTime[ueIndex], Simulator::Now().GetSeconds());
+}
+
+/**
+ * @brief Accounts an uplink VoIP packet received by the remote host's VoipMuxServer.
+ * @param ue Sending UE index, from the server's demux table.
+ * @param packet Received packet.
+ */
+void
+VoipRxTrace(uint32_t ue, Ptr<const Packet> packet)
+{
+    VoipTimestampTag tag;
+    if (!packet->PeekPacketTag(tag) || ue >= g_voipKpi.rxPackets.size())
+    {
+        return;
+    }
+
+    double now = Simulator::Now().GetSeconds();
+    double transit = now - tag.txTimeNs * 1e-9;
+    g_voipKpi.rxPackets[ue]++;
+    g_voipKpi.rxBytes[ue] += packet->GetSize();
+    g_voipKpi.delaySum[ue] += transit;
+    uint32_t delayBin = LogHistogram::BinIndex(transit);
+    g_voipKpi.delayBins[static_cast<size_t>(ue) * LogHistogram::BINS + delayBin]++;
+    g_voipKpi.intervalDelayBins[delayBin]++;
+    if (g_voipKpi.lastTransit[ue] >= 0)
+    {
+        double d = std::fabs(transit - g_voipKpi.lastTransit[ue]);
+        g_voipKpi.jitter[ue] += (d - g_voipKpi.jitter[ue]) / 16.0;
+        uint32_t jitterBin = LogHistogram::BinIndex(d);
+        g_voipKpi.jitterBins[static_cast<size_t>(ue) * LogHistogram::BINS + jitterBin]++;
+        g_voipKpi.intervalJitterBins[jitterBin]++;
+    }
+    g_voipKpi.lastTransit[ue] = transit;
+    g_voipKpi.lastRxTime[ue] = now;
+}
+
+/**
+ * @brief Accounts a downlink VoIP packet received by a UE.
+ * @param ueIndex Receiving UE index.
+ * @param packet Received packet.
+ */
+void
+VoipDownlinkRxTrace(uint32_t ueIndex, Ptr<const Packet> packet)
+{
+    VoipTimestampTag tag;
+    if (!packet->PeekPacketTag(tag) || ueIndex >= g_voipKpi.dlRxPackets.size())
+    {
+        return;
+    }
+    g_voipKpi.dlRxPackets[ueIndex]++;
+    g_voipKpi.dlRxBytes[ueIndex] += packet->GetSize();
+    g_voipKpi.dlDelaySum[ueIndex] += Simulator::Now().GetSeconds() - tag.txTimeNs * 1e-9;
+}
+
+/**
+ * @struct TalkspurtModel
+ * @brief Voice activity of a call direction: exponential talkspurts and silences.
+ *
+ * The two-state on/off speech model of ITU-T P.59 (mean talkspurt 1.004 s, mean silence
+ * 1.587 s, about 39% activity). Within a talkspurt one frame is sent every frame interval;
+ * a silence mean of 0 keeps the source always on, i.e. constant bit rate. One model (and
+ * its two random variables) serves every call of an application.
+ */
+struct TalkspurtModel
+{
+    Time frameInterval;                       ///< Time between frames within a talkspurt
+    Ptr<ExponentialRandomVariable> talkspurt; ///< Talkspurt durations (nullptr = always on)
+    Ptr<ExponentialRandomVariable> silence;   ///< Silence durations
+    int64_t stream = -1;                      ///< First of the two RNG streams (-1 = automatic)
+
+    /**
+     * @brief Sets the frame interval and the on/off means.
+     * @param interval Frame interval.
+     * @param talkspurtMean Mean talkspurt duration in seconds.
+     * @param silenceMean Mean silence duration in seconds (0 = always on).
+     */
+    void Configure(Time interval, double talkspurtMean, double silenceMean)
+    {
+        frameInterval = interval;
+        talkspurt = nullptr;
+        silence = nullptr;
+        if (silenceMean > 0.0)
+        {
+            talkspurt = CreateObject<ExponentialRandomVariable>();
+            talkspurt->SetAttribute("Mean", DoubleValue(talkspurtMean));
+            silence = CreateObject<ExponentialRandomVariable>();
+            silence->SetAttribute("Mean", DoubleValue(silenceMean));
+            if (stream >= 0)
+            {
+                talkspurt->SetStream(stream);
+                silence->SetStream(stream + 1);
+            }
+        }
+    }
+
+    /**
+     * @brief Starts a talkspurt.
+     * @param now Current time.
+     * @return End of the talkspurt.
+     */
+    Time BeginTalkspurt(Time now) const
+    {
+        return talkspurt ? now + Seconds(talkspurt->GetValue()) : Time::Max();
+    }
+
+    /**
+     * @brief Delay from the frame just sent to the next one.
+     * @param now Current time.
+     * @param talkspurtEnd End of the current talkspurt; moved on past any silence.
+     * @return Delay until the next frame.
+     */
+    Time NextFrameDelay(Time now, Time& talkspurtEnd) const
+    {
+        if (now + frameInterval < talkspurtEnd)
+        {
+            return frameInterval;
+        }
+        Time gap = Seconds(silence->GetValue());
+        talkspurtEnd = BeginTalkspurt(now + frameInterval + gap);
+        return frameInterval + gap;
+    }
+};
+
+/**
+ * @class VoipCallApplication
+ * @brief UE end of a VoIP call.
+ *
+ * Sends timestamp-tagged codec frames to the remote host's VoipMuxServer following the
+ * talkspurt model, and receives the downlink half of a bidirectional call on the same
+ * socket. One event per frame and no per-call objects besides the socket.
+ */
+class VoipCallApplication : public Application
+{
+  public:
+    /**
+     * @brief Registers the application type and its attributes.
+     * @return The TypeId.
+     */
+    static TypeId GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("VoipCallApplication")
+                .SetParent<Application>()
+                .SetGroupName("Applications")
+                .AddConstructor<VoipCallApplication>()
+                .AddAttribute("PacketSize",
+                              "Codec frame payload in bytes",
+                              UintegerValue(80),
+                              MakeUintegerAccessor(&VoipCallApplication::m_packetSize),
+                              MakeUintegerChecker<uint32_t>(1))
+                .AddAttribute("FrameInterval",
+                              "Time between frames within a talkspurt",
+                              TimeValue(MilliSeconds(10)),
+                              MakeTimeAccessor(&VoipCallApplication::m_frameInterval),
+                              MakeTimeChecker())
+                .AddAttribute("TalkspurtMean",
+                              "Mean talkspurt duration in seconds",
+                              DoubleValue(1.004),
+                              MakeDoubleAccessor(&VoipCallApplication::m_talkspurtMean),
+                              MakeDoubleChecker<double>(0.0))
+                .AddAttribute("SilenceMean",
+                              "Mean silence duration in seconds (0 = always on)",
+                              DoubleValue(0.0),
+                              MakeDoubleAccessor(&VoipCallApplication::m_silenceMean),
+                              MakeDoubleChecker<double>(0.0));
+        return tid;
+    }
+
+    /**
+     * @brief Sets the call identity and the server address.
+     * @param ueIndex UE index used by the KPI collector.
+     * @param server Remote host address.
+     * @param port Call port, on the UE and on the server.
+     */
+    void Setup(uint32_t ueIndex, Ipv4Address server, uint16_t port)
+    {
+        m_ueIndex = ueIndex;
+        m_server = server;
+        m_port = port;
+    }
+
+    /**
+     * @brief Fixes the RNG streams of the voice activity model.
+     * @param stream First stream number.
+     * @return Number of streams used (2).
+     */
+    int64_t AssignVoiceActivityStreams(int64_t stream)
+    {
+        m_model.stream = stream;
+        return 2;
+    }
+
+    /**
+     * @brief Starts the call now, ahead of its start time.
+     * @return false if the call is already running.
+     */
+    bool StartCall()
+    {
+        if (m_socket)
+        {
+            return false;
+        }
+        StartApplication();
+        return true;
+    }
+
+  private:
+    void StartApplication() override
+    {
+        if (m_socket)
+        {
+            return;
+        }
+        m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+        m_socket->Bind(InetSocketAddress(Ipv4Address::GetAny(), m_port));
+        m_socket->Connect(InetSocketAddress(m_server, m_port));
+        m_socket->SetRecvCallback(MakeCallback(&VoipCallApplication::HandleRead, this));
+
+        m_model.Configure(m_frameInterval, m_talkspurtMean, m_silenceMean);
+        m_talkspurtEnd = m_model.BeginTalkspurt(Simulator::Now());
+        m_sendEvent = Simulator::ScheduleNow(&VoipCallApplication::SendFrame, this);
+    }
+
+    void StopApplication() override
+    {
+        m_sendEvent.Cancel();
+        if (m_socket)
+        {
+            m_socket->Close();
+            m_socket = nullptr;
+        }
+    }
+
+    /**
+     * @brief Sends one frame and schedules the next.
+     */
+    void SendFrame()
+    {
+        Ptr<Packet> packet = Create<Packet>(m_packetSize);
+        VoipTxTrace(m_ueIndex, packet);
+        m_socket->Send(packet);
+        Time delay = m_model.NextFrameDelay(Simulator::Now(), m_talkspurtEnd);
+        m_sendEvent = Simulator::Schedule(delay, &VoipCallApplication::SendFrame, this);
+    }
+
+    /**
+     * @brief Receives downlink frames.
+     * @param socket Call socket.
+     */
+    void HandleRead(Ptr<Socket> socket)
+    {
+        Ptr<Packet> packet;
+        while ((packet = socket->Recv()))
+        {
+            VoipDownlinkRxTrace(m_ueIndex, packet);
+        }
+    }
+
+    uint32_t m_packetSize = 80;   ///< Frame payload in bytes
+    Time m_frameInterval;         ///< Time between frames within a talkspurt
+    double m_talkspurtMean = 0.0; ///< Mean talkspurt duration in seconds
+    double m_silenceMean = 0.0;   ///< Mean silence duration in seconds
+    uint32_t m_ueIndex = 0;       ///< UE index
+    Ipv4Address m_server;         ///< Remote host address
+    uint16_t m_port = 5000;       ///< Call port
+    Ptr<Socket> m_socket;         ///< Call socket
+    TalkspurtModel m_model;       ///< Uplink voice activity
+    Time m_talkspurtEnd;          ///< End of the current uplink talkspurt
+    EventId m_sendEvent;          ///< Next frame
+};
+
+NS_OBJECT_ENSURE_REGISTERED(VoipCallApplication);
+
+/**
+ * @class VoipMuxServer
+ * @brief Remote-host end of every VoIP call, on a single socket.
+ *
+ * All UEs send to the same port. A demux table keyed by the UE's IPv4 address maps each
+ * datagram to its call, so N calls need one application, one socket and one receive path
+ * instead of N PacketSinks. For bidirectional calls the server also runs the downlink
+ * talkspurt source of every call, with one pending event per call.
+ */
+class VoipMuxServer : public Application
+{
+  public:
+    /**
+     * @brief Registers the application type and its attributes.
+     * @return The TypeId.
+     */
+    static TypeId GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("VoipMuxServer")
+                .SetParent<Application>()
+                .SetGroupName("Applications")
+                .AddConstructor<VoipMuxServer>()
+                .AddAttribute("Port",
+                              "Port shared by all calls",
+                              UintegerValue(5000),
+                              MakeUintegerAccessor(&VoipMuxServer::m_port),
+                              MakeUintegerChecker<uint16_t>())
+                .AddAttribute("Bidirectional",
+                              "Send a downlink voice stream to every call",
+                              BooleanValue(false),
+                              MakeBooleanAccessor(&VoipMuxServer::m_bidirectional),
+                              MakeBooleanChecker())
+                .AddAttribute("CallsOnDemand",
+                              "Start each downlink stream from StartCall, not at start time",
+                              BooleanValue(false),
+                              MakeBooleanAccessor(&VoipMuxServer::m_callsOnDemand),
+                              MakeBooleanChecker())
+                .AddAttribute("PacketSize",
+                              "Downlink codec frame payload in bytes",
+                              UintegerValue(80),
+                              MakeUintegerAccessor(&VoipMuxServer::m_packetSize),
+                              MakeUintegerChecker<uint32_t>(1))
+                .AddAttribute("FrameInterval",
+                              "Time between downlink frames within a talkspurt",
+                              TimeValue(MilliSeconds(10)),
+                              MakeTimeAccessor(&VoipMuxServer::m_frameInterval),
+                              MakeTimeChecker())
+                .AddAttribute("TalkspurtMean",
+                              "Mean downlink talkspurt duration in seconds",
+                              DoubleValue(1.004),
+                              MakeDoubleAccessor(&VoipMuxServer::m_talkspurtMean),
+                              MakeDoubleChecker<double>(0.0))
+                .AddAttribute("SilenceMean",
+                              "Mean downlink silence duration in seconds (0 = always on)",
+                              DoubleValue(0.0),
+                              MakeDoubleAccessor(&VoipMuxServer::m_silenceMean),
+                              MakeDoubleChecker<double>(0.0));
+        return tid;
+    }
+
+    /**
+     * @brief Adds a call to the demux table.
+     * @param ueIndex UE index used by the KPI collector.
+     * @param ueAddress UE IPv4 address.
+     */
+    void AddCall(uint32_t ueIndex, Ipv4Address ueAddress)
+    {
+        m_callByAddress[ueAddress.Get()] = m_calls.size();
+        m_calls.push_back({ueIndex, ueAddress, Time(), EventId()});
+    }
+
+    /**
+     * @brief Fixes the RNG streams of the downlink voice activity model.
+     * @param stream First stream number.
+     * @return Number of streams used (2).
+     */
+    int64_t AssignVoiceActivityStreams(int64_t stream)
+    {
+        m_model.stream = stream;
+        return 2;
+    }
+
+    /**
+     * @brief Starts the downlink stream of one call (CallsOnDemand only).
+     * @param index Call index, in AddCall order.
+     */
+    void StartCall(uint32_t index)
+    {
+        if (!m_bidirectional || !m_socket || index >= m_calls.size() ||
+            m_calls[index].sendEvent.IsRunning())
+        {
+            return;
+        }
+        m_calls[index].talkspurtEnd = m_model.BeginTalkspurt(Simulator::Now());
+        m_calls[index].sendEvent = Simulator::ScheduleNow(&VoipMuxServer::SendFrame, this, index);
+    }
+
+    /**
+     * @return Datagrams dropped because their source matched no call.
+     */
+    uint64_t GetUnknownPackets() const
+    {
+        return m_unknownPackets;
+    }
+
+  private:
+    /**
+     * @struct Call
+     * @brief Demux table entry and downlink state of one call.
+     */
+    struct Call
+    {
+        uint32_t ueIndex;    ///< UE index
+        Ipv4Address address; ///< UE address
+        Time talkspurtEnd;   ///< End of the current downlink talkspurt
+        EventId sendEvent;   ///< Next downlink frame
+    };
+
+    void StartApplication() override
+    {
+        m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+        m_socket->Bind(InetSocketAddress(Ipv4Address::GetAny(), m_port));
+        m_socket->SetRecvCallback(MakeCallback(&VoipMuxServer::HandleRead, this));
+
+        if (m_bidirectional)
+        {
+            m_model.Configure(m_frameInterval, m_talkspurtMean, m_silenceMean);
+            for (uint32_t call = 0; call < m_calls.size() && !m_callsOnDemand; ++call)
+            {
+                m_calls[call].talkspurtEnd = m_model.BeginTalkspurt(Simulator::Now());
+                m_calls[call].sendEvent =
+                    Simulator::ScheduleNow(&VoipMuxServer::SendFrame, this, call);
+            }
+        }
+    }
+
+    void StopApplication() override
+    {
+        for (auto& call : m_calls)
+        {
+            call.sendEvent.Cancel();
+        }
+        if (m_socket)
+        {
+            m_socket->Close();
+            m_socket = nullptr;
+        }
+        if (m_unknownPackets > 0)
+        {
+            NS_LOG_WARN("VoipMuxServer dropped " << m_unknownPackets
+                                                 << " datagrams from unknown sources");
+        }
+    }
+
+    /**
+     * @brief Sends one downlink frame of a call and schedules the next.
+     * @param index Call index.
+     */
+    void SendFrame(uint32_t index)
+    {
+        Call& call = m_calls[index];
+        Ptr<Packet> packet = Create<Packet>(m_packetSize);
+        VoipTimestampTag tag;
+        tag.ueIndex = call.ueIndex;
+        tag.txTimeNs = Simulator::Now().GetNanoSeconds();
+        packet->AddPacketTag(tag);
+        g_voipKpi.dlTxPackets[call.ueIndex]++;
+        m_socket->SendTo(packet, 0, InetSocketAddress(call.address, m_port));
+
+        Time delay = m_model.NextFrameDelay(Simulator::Now(), call.talkspurtEnd);
+        call.sendEvent = Simulator::Schedule(delay, &VoipMuxServer::SendFrame, this, index);
+    }
+
+    /**
+     * @brief Receives uplink frames and demultiplexes them to their calls.
+     * @param socket Server socket.
+     */
+    void HandleRead(Ptr<Socket> socket)
+    {
+        Ptr<Packet> packet;
+        Address from;
+        while ((packet = socket->RecvFrom(from)))
+        {
+            auto it = m_callByAddress.find(InetSocketAddress::ConvertFrom(from).GetIpv4().Get());
+            if (it == m_callByAddress.end())
+            {
+                m_unknownPackets++;
+                continue;
+            }
+            VoipRxTrace(m_calls[it->second].ueIndex, packet);
+        }
+    }
+
+    uint16_t m_port = 5000;                                 ///< Port shared by all calls
+    bool m_bidirectional = false;                           ///< Send downlink streams
+    bool m_callsOnDemand = false;                           ///< Streams started by StartCall
+    uint32_t m_packetSize = 80;                             ///< Downlink frame payload
+    Time m_frameInterval;                                   ///< Downlink frame interval
+    double m_talkspurtMean = 0.0;                           ///< Mean talkspurt in seconds
+    double m_silenceMean = 0.0;                             ///< Mean silence in seconds
+    std::vector<Call> m_calls;                              ///< Calls by call index
+    std::unordered_map<uint32_t, uint32_t> m_callByAddress; ///< UE IPv4 address -> call
+    Ptr<Socket> m_socket;                                   ///< Server socket
+    TalkspurtModel m_model;                                 ///< Downlink voice activity
+    uint64_t m_unknownPackets = 0;                          ///< Datagrams matching no call
+};
+
+NS_OBJECT_ENSURE_REGISTERED(VoipMuxServer);
+
+// ============================================================================
+/**
+ * @brief The main function that sets up and runs the simulation.
+ */
+int
+main(int argc, char* argv[])
+{
+    auto wallStart = std::chrono::steady_clock::now();
+
+    // Initialize simulation parameters
+    SimulationParameters params;
+
+    SweepParameters sweep;
+    BenchmarkParameters benchmark;
+    std::string codecName = params.codec.name;
+    uint16_t mobilityMode = params.mobilityMode;
+
+    // Optionally, parse command-line arguments to override defaults
+    CommandLine cmd;
+    cmd.AddValue("numUe", "Number of UEs", params.numUe);
+    cmd.AddValue("lteBandwidth", "LTE bandwidth in MHz (1, 3, 5, 10, 15, 20)", params.lteBandwidth);
+    cmd.AddValue("codec", "VoIP codec (G.711, G.722.2, G.723.1, G.729)", codecName);
+    cmd.AddValue("voipActivity",
+                 "VoIP voice activity: constant (always on) or p59 (ITU-T P.59 talkspurts)",
+                 params.voipActivity);
+    cmd.AddValue("talkspurtMean", "p59: mean talkspurt duration [s]", params.talkspurtMean);
+    cmd.AddValue("silenceMean", "p59: mean silence duration [s]", params.silenceMean);
+    cmd.AddValue("voipBidirectional",
+                 "Bidirectional calls: the remote host also talks to every UE",
+                 params.voipBidirectional);
+    cmd.AddValue("pathlossModel",
+                 "Three-log-distance path loss: batched (cached UE x eNB rows) or ns3",
+                 params.pathlossModel);
+    cmd.AddValue("scheduler",
+                 "MAC scheduler: rr, pf, fdmt, tdmt, tta, fdbet, tdbet, fdtbfq, tdtbfq, pss, cqa "
+                 "or an ns-3 TypeId name",
+                 params.scheduler);
+    cmd.AddValue("schedulerProfile",
+                 "Scheduler profiling: none, summary (scheduler_profile.csv) or tti (also "
+                 "scheduler_tti.csv)",
+                 params.schedulerProfile);
+    cmd.AddValue("mobilityMode",
+                 "UE mobility mode (0=RandomWaypoint, 1=UnderDistance0, 2=UnderDistance1, "
+                 "3=AboveDistance1)",
+                 mobilityMode);
+    cmd.AddValue("distance0", "Path loss: first distance threshold [m]", params.distance0);
+    cmd.AddValue("distance1", "Path loss: second distance threshold [m]", params.distance1);
+    cmd.AddValue("exponent0", "Path loss exponent below distance0", params.exponent0);
+    cmd.AddValue("exponent1",
+                 "Path loss exponent between distance0 and distance1",
+                 params.exponent1);
+    cmd.AddValue("exponent2", "Path loss exponent beyond distance1", params.exponent2);
+    cmd.AddValue("handoverHysteresis",
+                 "A3 handover hysteresis [dB]",
+                 params.handoverHysteresis);
+    cmd.AddValue("handoverTimeToTrigger",
+                 "A3 handover Time-To-Trigger [ms]",
+                 params.handoverTimeToTrigger);
+    cmd.AddValue("numEnb", "Number of eNodeB sites", params.numEnb);
+    cmd.AddValue("simTime", "Simulation time [s]", params.simTime);
+    cmd.AddValue("areaSize", "Side of the square simulation area [m]", params.areaSize);
+    cmd.AddValue("enbLayout",
+                 "eNodeB layout: auto (2/4-cell layouts, hex otherwise), hex or file",
+                 params.enbLayout);
+    cmd.AddValue("interSiteDistance",
+                 "Hex layout inter-site distance [m] (0 = areaSize/2)",
+                 params.interSiteDistance);
+    cmd.AddValue("triSector", "Split every site into three sectors", params.triSector);
+    cmd.AddValue("enbSiteFile",
+                 "Site list for enbLayout=file, one \"x y [z [azimuth]]\" per line",
+                 params.enbSiteFile);
+    cmd.AddValue("enbHeight", "eNodeB antenna height [m]", params.enbHeight);
+    cmd.AddValue("topologySave",
+                 "Write the layout (cells, UE positions, attach map) to a file",
+                 params.topologySave);
+    cmd.AddValue("topologyLoad",
+                 "Take UE positions and attach map from a --topologySave file and start "
+                 "each call on bearer setup instead of at 1 s",
+                 params.topologyLoad);
+    cmd.AddValue("statsInterval",
+                 "Statistics sampling interval [s] (adaptive: dense interval)",
+                 params.statsInterval);
+    cmd.AddValue("statsMode",
+                 "Statistics sampling: fixed or adaptive (dense around handovers and loss "
+                 "bursts, backing off to statsIntervalMax)",
+                 params.statsMode);
+    cmd.AddValue("statsIntervalMax",
+                 "Adaptive sampling: coarsest steady-state interval [s]",
+                 params.statsIntervalMax);
+    cmd.AddValue("statsLossThreshold",
+                 "Adaptive sampling: interval packet loss [%] treated as a loss burst",
+                 params.statsLossThreshold);
+    cmd.AddValue("metricsFlushInterval",
+                 "Simulated seconds between metrics file flushes",
+                 params.metricsFlushInterval);
+    cmd.AddValue("metricsFormat",
+                 "Metrics output: csv (simulation_metrics.csv) or binary (simulation_metrics.bin)",
+                 params.metricsFormat);
+    cmd.AddValue("enableCellMetrics",
+                 "Write per-cell throughput, load, latency and handovers to cell_metrics.csv",
+                 params.enableCellMetrics);
+    cmd.AddValue("trajectoryMode",
+                 "UE trajectory (ue_trajectory.bin): none, changes (UEs whose course changed "
+                 "since the last sample) or interval (all UEs)",
+                 params.trajectoryMode);
+    cmd.AddValue("trajectoryInterval",
+                 "UE trajectory sampling interval [s]",
+                 params.trajectoryInterval);
+    cmd.AddValue("enableFlowMonitor",
+                 "Install FlowMonitor on UEs and remote host and write flowmon.xml",
+                 params.enableFlowMonitor);
+    cmd.AddValue("flowMonitorFormat",
+                 "FlowMonitor output: xml (flowmon.xml with histograms), binary (flowmon.bin) or "
+                 "csv (flowmon-chunk-NNNN.csv per shard)",
+                 params.flowMonitorFormat);
+    cmd.AddValue("flowMonitorChunk",
+                 "FlowMonitor binary/csv: flows per analysis shard and chunk file",
+                 params.flowMonitorChunk);
+    cmd.AddValue("analysisThreads",
+                 "Post-run FlowMonitor analysis threads (0 = all cores)",
+                 params.analysisThreads);
+    cmd.AddValue("enableReport",
+                 "Write final_ue_metrics.csv, the Gnuplot scripts and the final summary",
+                 params.enableReport);
+    cmd.AddValue("logRrc", "Log LteEnbRrc and LteUeRrc at INFO level", params.logRrc);
+    cmd.AddValue("statusFile",
+                 "Live JSON status file refreshed every statusInterval wall seconds",
+                 params.statusFile);
+    cmd.AddValue("statusInterval",
+                 "Wall seconds between live status file updates",
+                 params.statusInterval);
+    cmd.AddValue("statusPort",
+                 "Serve live status on 127.0.0.1:<port> (/metrics: Prometheus, else JSON)",
+                 params.statusPort);
+    cmd.AddValue("perfReport",
+                 "Write wall-clock, events and peak RSS of this run to the given CSV file",
+                 params.perfReport);
+    cmd.AddValue("config",
+                 "INI (name = value) or flat JSON file of option values; the command line "
+                 "overrides it",
+                 params.configFile);
+    cmd.AddValue("configStoreIn",
+                 "Load ns-3 attribute values from this ConfigStore file (.xml or raw text)",
+                 params.configStoreIn);
+    cmd.AddValue("configStoreOut",
+                 "Save the ns-3 attribute values of this run to a ConfigStore file",
+                 params.configStoreOut);
+    cmd.AddValue("enableNetAnim", "Enable NetAnim output", params.enableNetAnim);
+    cmd.AddValue("animMode",
+                 "NetAnim mode: full (every packet) or lite (positions, cell changes, "
+                 "packets only in the animPacket window)",
+                 params.animMode);
+    cmd.AddValue("animPollInterval",
+                 "NetAnim lite: position sampling interval [s]",
+                 params.animPollInterval);
+    cmd.AddValue("animPacketStart",
+                 "NetAnim lite: packet window start [s]",
+                 params.animPacketStart);
+    cmd.AddValue("animPacketStop", "NetAnim lite: packet window stop [s]", params.animPacketStop);
+    cmd.AddValue("animChunkPackets",
+                 "NetAnim lite: packets per XML chunk before rolling to a new file",
+                 params.animChunkPackets);
+    cmd.AddValue("traceProfile",
+                 "LTE traces: none, kpi (sampled RSRP/SINR), rlc-pdcp (kpi + RLC/PDCP), full",
+                 params.traceProfile);
+    cmd.AddValue("traceDecimation",
+                 "Keep every Nth UE PHY report and MAC TTI in the LTE traces",
+                 params.traceDecimation);
+    cmd.AddValue("traceEpoch", "RLC/PDCP trace aggregation epoch [s]", params.traceEpoch);
+    cmd.AddValue("traceUes", "Comma-separated UE indices to trace (empty = all)", params.traceUes);
+    cmd.AddValue("sweep",
+                 "Run the parameter grid below as parallel child processes",
+                 sweep.enabled);
+    cmd.AddValue("sweepCodecs", "Sweep: comma-separated codec names", sweep.codecs);
+    cmd.AddValue("sweepBandwidths", "Sweep: comma-separated LTE bandwidths", sweep.lteBandwidths);
+    cmd.AddValue("sweepSchedulers", "Sweep: comma-separated MAC schedulers", sweep.schedulers);
+    cmd.AddValue("sweepMobilityModes",
+                 "Sweep: comma-separated mobility modes",
+                 sweep.mobilityModes);
+    cmd.AddValue("sweepNumUe", "Sweep: comma-separated UE counts", sweep.numUes);
+    cmd.AddValue("sweepRuns", "Sweep: RngRun values, ranges allowed (e.g. 1-10)", sweep.runs);
+    cmd.AddValue("sweepJobs", "Sweep: max concurrent runs (0 = all cores)", sweep.jobs);
+    cmd.AddValue("sweepDir", "Sweep: output directory", sweep.outputDir);
+    cmd.AddValue("sweepReports",
+                 "Sweep: also write each run's final report (skipped by default)",
+                 sweep.reports);
+    cmd.AddValue("sweepResume",
+                 "Sweep: reuse runs whose directory holds a completed run with the same "
+                 "arguments",
+                 sweep.resume);
+    cmd.AddValue("benchmark",
+                 "Run the scaling benchmark matrix and write benchmark_results.csv",
+                 benchmark.enabled);
+    cmd.AddValue("benchmarkMaxUe", "Benchmark: skip scales above this UE count", benchmark.maxUe);
+    cmd.AddValue("benchmarkSimTime", "Benchmark: simulated seconds per run", benchmark.simTime);
+    cmd.AddValue("benchmarkDir", "Benchmark: output directory", benchmark.outputDir);
+
+    // Config file entries go in front of the real arguments, so the command line wins
+    std::vector<std::string> args{argv[0]};
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg(argv[i]);
+        if (arg.rfind("--config=", 0) == 0 && !LoadConfigFile(arg.substr(9), args))
+        {
+            return 1;
+        }
+    }
+    args.insert(args.end(), argv + 1, argv + argc);
+
+    // ConfigStore defaults are loaded first, so --ns3::... arguments still override them
+    std::string configStoreIn = FindArgument(args, "configStoreIn");
+    if (!configStoreIn.empty())
+    {
+        RunConfigStore(configStoreIn, "Load", true, false);
+    }
+    cmd.Parse(args);
+
+    if (!params.SelectCodec(codecName))
+    {
+        NS_LOG_ERROR("Unknown VoIP codec: " << codecName);
+        return 1;
+    }
+    if (params.voipActivity != "constant" && params.voipActivity != "p59")
+    {
+        NS_LOG_ERROR("Unknown VoIP activity model: " << params.voipActivity);
+        return 1;
+    }
+    if (params.voipActivity == "p59" && (params.talkspurtMean <= 0.0 || params.silenceMean <= 0.0))
+    {
+        NS_LOG_ERROR("talkspurtMean and silenceMean must be positive");
+        return 1;
+    }
+    if (mobilityMode > SimulationParameters::CONSTANT_ABOVE_DISTANCE1)
+    {
+        NS_LOG_ERROR("Unknown mobility mode: " << mobilityMode);
+        return 1;
+    }
+    params.mobilityMode = static_cast<SimulationParameters::MobilityMode>(mobilityMode);
+    if (params.distance0 <= 0.0 || params.distance1 <= params.distance0)
+    {
+        NS_LOG_ERROR("Path loss distances must satisfy 0 < distance0 < distance1");
+        return 1;
+    }
+    if (params.statsInterval <= 0.0 || params.metricsFlushInterval <= 0.0)
+    {
+        NS_LOG_ERROR("statsInterval and metricsFlushInterval must be positive");
+        return 1;
+    }
+    if (params.statusInterval <= 0.0)
+    {
+        NS_LOG_ERROR("statusInterval must be positive");
+        return 1;
+    }
+    if (params.statsMode != "fixed" && params.statsMode != "adaptive")
+    {
+        NS_LOG_ERROR("Unknown statistics mode: " << params.statsMode);
+        return 1;
+    }
+    if (params.statsIntervalMax < params.statsInterval || params.statsLossThreshold < 0.0)
+    {
+        NS_LOG_ERROR("statsIntervalMax must be >= statsInterval and statsLossThreshold >= 0");
+        return 1;
+    }
+    if (params.trajectoryMode != "none" && params.trajectoryMode != "changes" &&
+        params.trajectoryMode != "interval")
+    {
+        NS_LOG_ERROR("Unknown trajectory mode: " << params.trajectoryMode);
+        return 1;
+    }
+    if (params.flowMonitorFormat != "xml" && params.flowMonitorFormat != "binary" &&
+        params.flowMonitorFormat != "csv")
+    {
+        NS_LOG_ERROR("Unknown FlowMonitor format: " << params.flowMonitorFormat);
+        return 1;
+    }
+    if (params.trajectoryInterval <= 0.0)
+    {
+        NS_LOG_ERROR("trajectoryInterval must be positive");
+        return 1;
+    }
+    if (params.animMode != "full" && params.animMode != "lite")
+    {
+        NS_LOG_ERROR("Unknown NetAnim mode: " << params.animMode);
+        return 1;
+    }
+
+    if (sweep.enabled)
+    {
+        ConfigureLogging(false);
+        return RunParameterSweep(sweep, params, args);
+    }
+    if (benchmark.enabled)
+    {
+        ConfigureLogging(false);
+        return RunBenchmarkSuite(benchmark, args);
+    }
+
+    // Initialize per-UE sampler state
+    g_ueFlowState.Reset(params.numUe);
+    g_voipKpi.Reset(params.numUe);
+
+    // Enable logging
+    ConfigureLogging(params.logRrc);
+
+    // Open the handover log file
+    if (!g_handoverLogger.Open("handover_events.log"))
+    {
+        NS_LOG_ERROR("Failed to open handover_events.log for writing.");
+        return 1;
+    }
+
+    // Open the streaming metrics sink
+    MetricsStreamWriter::Format metricsFormat = MetricsStreamWriter::CSV;
+    std::string metricsPath = "simulation_metrics.csv";
+    if (params.metricsFormat == "binary")
+    {
+        metricsFormat = MetricsStreamWriter::BINARY;
+        metricsPath = "simulation_metrics.bin";
+    }
+    else if (params.metricsFormat != "csv")
+    {
+        NS_LOG_ERROR("Unknown metrics format: " << params.metricsFormat);
+        return 1;
+    }
+    // One binary block per flush interval, so both formats reach disk at the same cadence
+    uint32_t blockRows =
+        std::max<long>(1, std::lround(params.metricsFlushInterval / params.statsInterval));
+    if (!g_metricsWriter.Open(metricsPath,
+                              params.numUe,
+                              params.metricsFlushInterval,
+                              metricsFormat,
+                              blockRows))
+    {
+        NS_LOG_ERROR("Failed to open " << metricsPath << " for writing.");
+        return 1;
+    }
+
+    // Generate the eNodeB layout; a loaded topology layout file must match it
+    TopologySnapshot snapshot;
+    std::vector<EnbCell> enbCells;
+    if (!GenerateEnbLayout(params, enbCells))
+    {
+        return 1;
+    }
+    if (!params.topologyLoad.empty() &&
+        (!LoadTopologySnapshot(params.topologyLoad, snapshot) ||
+         !CheckTopologySnapshot(params.topologyLoad, snapshot, params, enbCells)))
+    {
+        return 1;
+    }
+    NS_LOG_INFO("eNodeB layout: " << enbCells.size() << " cells");
+
+    // Create nodes
+    NodeContainer enbNodes, ueNodes, remoteHostContainer;
+    enbNodes.Create(enbCells.size()); // eNB nodes, one per cell
+    ueNodes.Create(params.numUe);     // UE nodes
+    remoteHostContainer.Create(1);    // Remote Host
+
+    // LTE and EPC Helpers
+    Ptr<LteHelper> lteHelper = CreateObject<LteHelper>();
+    Ptr<PointToPointEpcHelper> epcHelper = CreateObject<PointToPointEpcHelper>();
+    lteHelper->SetEpcHelper(epcHelper);
+
+    // Configure Path Loss Model
+    if (params.pathlossModel == "batched")
+    {
+        lteHelper->SetPathlossModelType(BatchedThreeLogDistanceLossModel::GetTypeId());
+    }
+    else if (params.pathlossModel == "ns3")
+    {
+        lteHelper->SetPathlossModelType(
+            TypeId::LookupByName("ns3::ThreeLogDistancePropagationLossModel"));
+    }
+    else
+    {
+        NS_LOG_ERROR("Unknown path loss model: " << params.pathlossModel);
+        return 1;
+    }
+    lteHelper->SetPathlossModelAttribute("Distance0", DoubleValue(params.distance0));
+    lteHelper->SetPathlossModelAttribute("Distance1", DoubleValue(params.distance1));
+    lteHelper->SetPathlossModelAttribute("Exponent0", DoubleValue(params.exponent0));
+    lteHelper->SetPathlossModelAttribute("Exponent1", DoubleValue(params.exponent1));
+    lteHelper->SetPathlossModelAttribute("Exponent2", DoubleValue(params.exponent2));
+
+    // LTE Bandwidth Configuration using Bandwidth Map
+    uint16_t dlBandwidth; // Downlink Bandwidth in RBs
+    uint16_t ulBandwidth; // Uplink Bandwidth in RBs
+
+    auto it = params.lteBandwidthMap.find(params.lteBandwidth);
+    if (it != params.lteBandwidthMap.end())
+    {
+        dlBandwidth = it->second.first;
+        ulBandwidth = it->second.second;
+    }
+    else
+    {
+        NS_LOG_WARN("Unsupported LTE bandwidth: " << params.lteBandwidth
+                                                  << " MHz. Defaulting to 20 MHz.");
+        auto defaultIt = params.lteBandwidthMap.find(20);
+        if (defaultIt != params.lteBandwidthMap.end())
+        {
+            dlBandwidth = defaultIt->second.first;
+            ulBandwidth = defaultIt->second.second;
+        }
+        else
+        {
+            NS_LOG_ERROR("Default LTE bandwidth not found in bandwidth map.");
+            return 1;
+        }
+    }
+
+    lteHelper->SetEnbDeviceAttribute("DlBandwidth", UintegerValue(dlBandwidth));
+    lteHelper->SetEnbDeviceAttribute("UlBandwidth", UintegerValue(ulBandwidth));
+
+    // LTE Scheduler Configuration
+    std::string schedulerType;
+    if (!SchedulerTypeName(params.scheduler, schedulerType))
+    {
+        return 1;
+    }
+    if (params.schedulerProfile == "none")
+    {
+        lteHelper->SetSchedulerType(schedulerType);
+    }
+    else if (params.schedulerProfile == "summary" || params.schedulerProfile == "tti")
+    {
+        // Type 0 RBG size of TS 36.213 Table 7.1.6.1-1, as used by the LENA schedulers
+        uint32_t rbgSize =
+            (dlBandwidth <= 10) ? 1 : (dlBandwidth <= 26) ? 2 : (dlBandwidth <= 63) ? 3 : 4;
+        lteHelper->SetSchedulerType("ProfilingFfMacScheduler");
+        lteHelper->SetSchedulerAttribute("Scheduler", StringValue(schedulerType));
+        lteHelper->SetSchedulerAttribute("RbgSize", UintegerValue(rbgSize));
+        g_schedulerProfiles.clear();
+        if (params.schedulerProfile == "tti")
+        {
+            g_schedulerTtiFile.open("scheduler_tti.csv");
+            if (!g_schedulerTtiFile.is_open())
+            {
+                NS_LOG_ERROR("Failed to open scheduler_tti.csv for writing.");
+                return 1;
+            }
+            g_schedulerTtiFile << "Time(s),Cell,CC,Direction,Cost(us),UEs,RBs,Bytes\n";
+        }
+    }
+    else
+    {
+        NS_LOG_ERROR("Unknown scheduler profile: " << params.schedulerProfile);
+        return 1;
+    }
+
+    // Handover Configuration
+    lteHelper->SetHandoverAlgorithmType("ns3::A3RsrpHandoverAlgorithm");
+    lteHelper->SetHandoverAlgorithmAttribute(
+        "Hysteresis",
+        DoubleValue(params.handoverHysteresis));
+    lteHelper->SetHandoverAlgorithmAttribute(
+        "TimeToTrigger",
+        TimeValue(MilliSeconds(params.handoverTimeToTrigger)));
+
+    // Configure Mobility for eNodeBs
+    ConfigureEnbMobility(enbNodes, enbCells);
+
+    // Configure Mobility for UEs based on selected mobility mode
+    ConfigureUeMobility(ueNodes, params.areaSize, enbNodes, params.mobilityMode, params);
+    if (!params.topologyLoad.empty())
+    {
+        // Models keep their type (and random waypoints); only the start positions are restored
+        for (uint32_t i = 0; i < ueNodes.GetN(); ++i)
+        {
+            ueNodes.Get(i)->GetObject<MobilityModel>()->SetPosition(snapshot.uePositions[i]);
+        }
+    }
+
+    // Position Remote Host and PGW
+    MobilityHelper remoteMobility;
+    remoteMobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+    remoteMobility.Install(remoteHostContainer.Get(0));
+    remoteHostContainer.Get(0)->GetObject<MobilityModel>()->SetPosition(
+        Vector(params.areaSize / 2, params.areaSize / 2, 1.5));
+
+    remoteMobility.Install(epcHelper->GetPgwNode());
+    epcHelper->GetPgwNode()->GetObject<MobilityModel>()->SetPosition(
+        Vector(params.areaSize / 2, params.areaSize / 2, 1.5));
+
+    // Install LTE Devices, one eNodeB at a time so each sector gets its own antenna orientation
+    NetDeviceContainer enbDevs;
+    for (uint32_t i = 0; i < enbNodes.GetN(); ++i)
+    {
+        if (enbCells[i].sectorized)
+        {
+            lteHelper->SetEnbAntennaModelType("ns3::ParabolicAntennaModel");
+            lteHelper->SetEnbAntennaModelAttribute("Orientation",
+                                                   DoubleValue(enbCells[i].azimuth));
+            lteHelper->SetEnbAntennaModelAttribute("Beamwidth", DoubleValue(70.0));
+        }
+        else
+        {
+            lteHelper->SetEnbAntennaModelType("ns3::IsotropicAntennaModel");
+        }
+        enbDevs.Add(lteHelper->InstallEnbDevice(enbNodes.Get(i)));
+    }
+    NetDeviceContainer ueDevs = lteHelper->InstallUeDevice(ueNodes);
+
+    // Profiled schedulers: one per component carrier, keyed by (cellId, ccId)
+    for (uint32_t i = 0; i < enbDevs.GetN(); ++i)
+    {
+        for (const auto& cc : DynamicCast<LteEnbNetDevice>(enbDevs.Get(i))->GetCcMap())
+        {
+            Ptr<ComponentCarrierEnb> carrier = DynamicCast<ComponentCarrierEnb>(cc.second);
+            Ptr<ProfilingFfMacScheduler> profiler =
+                DynamicCast<ProfilingFfMacScheduler>(carrier->GetFfMacScheduler());
+            if (profiler)
+            {
+                profiler->Bind(carrier->GetCellId(), cc.first);
+            }
+        }
+    }
+    int64_t stream = STREAM_LTE;
+    stream += lteHelper->AssignStreams(enbDevs, stream);
+    lteHelper->AssignStreams(ueDevs, stream);
+
+    // Install Internet Stack
+    InternetStackHelper internet;
+    internet.Install(ueNodes);
+    internet.Install(remoteHostContainer);
+    internet.Install(epcHelper->GetPgwNode());
+
+    // Assign IP Addresses to UEs
+    Ipv4InterfaceContainer ueInterfaces = epcHelper->AssignUeIpv4Address(ueDevs);
+    std::vector<Ipv4Address> ueAddresses;
+    for (uint32_t i = 0; i < ueInterfaces.GetN(); ++i)
+    {
+        ueAddresses.push_back(ueInterfaces.GetAddress(i));
+        NS_LOG_INFO("UE " << i << " IP Address: " << ueAddresses.back());
+    }
+
+    // Attach UEs to the Nearest eNodeB
+    std::vector<uint16_t> ueAttachCellId(ueDevs.GetN());
+    std::vector<Vector> enbPositions(enbNodes.GetN());
+    for (uint32_t i = 0; i < enbNodes.GetN(); ++i)
+    {
+        enbPositions[i] = enbNodes.Get(i)->GetObject<MobilityModel>()->GetPosition();
+    }
+    g_enbSpatialIndex.Build(enbPositions);
+    bool useSnapshotAttach = !params.topologyLoad.empty();
+    if (!params.topologySave.empty())
+    {
+        snapshot.numUe = params.numUe;
+        snapshot.mobilityMode = params.mobilityMode;
+        snapshot.areaSize = params.areaSize;
+        snapshot.numEnb = params.numEnb;
+        snapshot.cells = enbCells;
+        snapshot.uePositions.resize(ueNodes.GetN());
+        snapshot.ueAttachEnb.resize(ueNodes.GetN());
+    }
+    for (uint32_t i = 0; i < ueDevs.GetN(); ++i)
+    {
+        Ptr<MobilityModel> ueMobility = ueNodes.Get(i)->GetObject<MobilityModel>();
+        Vector uePosition = ueMobility->GetPosition();
+        uint32_t closestEnb =
+            useSnapshotAttach
+                ? snapshot.ueAttachEnb[i]
+                : SelectSector(enbCells, g_enbSpatialIndex.FindNearest(uePosition), uePosition);
+        if (!params.topologySave.empty())
+        {
+            snapshot.uePositions[i] = uePosition;
+            snapshot.ueAttachEnb[i] = closestEnb;
+        }
+        lteHelper->Attach(ueDevs.Get(i), enbDevs.Get(closestEnb));
+        ueAttachCellId[i] = DynamicCast<LteEnbNetDevice>(enbDevs.Get(closestEnb))->GetCellId();
+        NS_LOG_INFO("UE " << i << " attached to eNodeB " << closestEnb);
+    }
+
+    // Per-cell KPIs start from the attach map; handovers move UEs from there
+    if (params.enableCellMetrics)
+    {
+        if (!g_cellKpi.Open("cell_metrics.csv", enbDevs, params.numUe))
+        {
+            NS_LOG_ERROR("Failed to open cell_metrics.csv for writing.");
+            return 1;
+        }
+        for (uint32_t i = 0; i < ueDevs.GetN(); ++i)
+        {
+            uint64_t imsi = DynamicCast<LteUeNetDevice>(ueDevs.Get(i))->GetImsi();
+            g_cellKpi.Attach(i, imsi, ueAttachCellId[i]);
+        }
+    }
+
+    if (!params.topologySave.empty() && !SaveTopologySnapshot(params.topologySave, snapshot))
+    {
+        NS_LOG_ERROR("Failed to write topology layout " << params.topologySave);
+        return 1;
+    }
+
+    // Create Remote Host Link
+    Ipv4Address remoteHostAddr = CreateRemoteHost(epcHelper, remoteHostContainer, params.areaSize);
+
+    // Install VoIP Applications
+    InstallVoipApplications(ueNodes,
+                            ueDevs,
+                            ueAddresses,
+                            remoteHostAddr,
+                            params.simTime,
+                            remoteHostContainer,
+                            params);
+
+    // Set Default Routes for UEs
+    Ipv4StaticRoutingHelper ipv4RoutingHelper;
+    for (uint32_t u = 0; u < ueNodes.GetN(); ++u)
+    {
+        Ptr<Ipv4> ipv4 = ueNodes.Get(u)->GetObject<Ipv4>();
+        Ptr<Ipv4StaticRouting> ueStaticRouting = ipv4RoutingHelper.GetStaticRouting(ipv4);
+        ueStaticRouting->SetDefaultRoute(epcHelper->GetUeDefaultGatewayAddress(), 1);
+        NS_LOG_INFO("UE " << u << " default route set to "
+                          << epcHelper->GetUeDefaultGatewayAddress());
+    }
+
+    // Enable LTE Traces
+    if (!EnableLteTraces(lteHelper, enbDevs, ueDevs, params))
+    {
+        return 1;
+    }
+
+    // Setup FlowMonitor
+    FlowMonitorHelper flowHelper;
+    Ptr<FlowMonitor> flowMonitor;
+    if (params.enableFlowMonitor)
+    {
+        flowMonitor = SetupFlowMonitor(flowHelper, ueNodes, remoteHostContainer);
+    }
+
+    // Connect Handover Trace Sources to Callbacks
+    for (uint32_t i = 0; i < enbDevs.GetN(); ++i)
+    {
+        Ptr<LteEnbNetDevice> enbNetDevice = DynamicCast<LteEnbNetDevice>(enbDevs.Get(i));
+        if (enbNetDevice)
+        {
+            Ptr<LteEnbRrc> enbRrc = enbNetDevice->GetRrc();
+            if (enbRrc)
+            {
+                // Connect Handover Start
+                enbRrc->TraceConnectWithoutContext("HandoverStart",
+                                                   MakeCallback(&HandoverStartCallback));
+
+                // Connect Handover Success
+                enbRrc->TraceConnectWithoutContext("HandoverSuccess",
+                                                   MakeCallback(&HandoverSuccessCallback));
+
+                // Connect Handover Failure
+                enbRrc->TraceConnectWithoutContext("HandoverFailure",
+                                                   MakeCallback(&HandoverFailureCallback));
+            }
+            else
+            {
+                NS_LOG_WARN("eNodeB RRC not found for device " << i);
+            }
+        }
+        else
+        {
+            NS_LOG_WARN("eNodeB NetDevice not found for device " << i);
+        }
+    }
+
+    // Initialize NetAnim
+    AnimationInterface* anim = nullptr;
+    if (params.enableNetAnim)
+    {
+        anim = new AnimationInterface("animation.xml");
+        if (params.animMode == "lite")
+        {
+            // Coarse positions for the whole run; packet tracing is switched off at the end
+            // of the window. NetAnim cannot switch it back on, so a window starting after 0 s
+            // falls back to the global start time, which also drops earlier positions.
+            anim->SetMobilityPollInterval(Seconds(params.animPollInterval));
+            anim->SetMaxPktsPerTraceFile(params.animChunkPackets);
+            if (params.animPacketStop <= params.animPacketStart)
+            {
+                anim->SkipPacketTracing();
+            }
+            else
+            {
+                if (params.animPacketStart > 0.0)
+                {
+                    NS_LOG_WARN("NetAnim cannot start packet tracing late; positions before "
+                                << params.animPacketStart << " s are dropped as well");
+                    anim->SetStartTime(Seconds(params.animPacketStart));
+                }
+                Simulator::Schedule(Seconds(params.animPacketStop),
+                                    &AnimationInterface::SkipPacketTracing,
+                                    anim);
+            }
+        }
+        else
+        {
+            anim->SetMaxPktsPerTraceFile(5000000);
+        }
+
+        // Configure eNodeBs in NetAnim
+        for (uint32_t i = 0; i < enbNodes.GetN(); ++i)
+        {
+            Ptr<Node> enbNode = enbNodes.Get(i);
+            Vector pos = enbNode->GetObject<MobilityModel>()->GetPosition();
+            anim->UpdateNodeDescription(enbNode, "eNodeB_" + std::to_string(i));
+            anim->UpdateNodeColor(enbNode, 0, 0, 255); // Blue
+            anim->SetConstantPosition(enbNode, pos.x, pos.y);
+        }
+
+        // Configure UEs in NetAnim
+        for (uint32_t i = 0; i < ueNodes.GetN(); ++i)
+        {
+            Ptr<Node> ueNode = ueNodes.Get(i);
+            Vector pos = ueNode->GetObject<MobilityModel>()->GetPosition();
+            anim->UpdateNodeDescription(ueNode, "UE_" + std::to_string(i));
+            anim->UpdateNodeColor(ueNode, 0, 255, 0); // Green
+            anim->SetConstantPosition(ueNode, pos.x, pos.y);
+        }
+
+        // Configure Remote Host in NetAnim
+        anim->UpdateNodeDescription(remoteHostContainer.Get(0), "RemoteHost");
+        anim->UpdateNodeColor(remoteHostContainer.Get(0), 255, 0, 0); // Red
+
+        // Annotate initial attachment; handovers update it from HandoverSuccessCallback
+        g_anim = anim;
+        g_animUeNodes.clear();
+        for (uint32_t i = 0; i < ueNodes.GetN(); ++i)
+        {
+            g_animUeNodes.push_back(ueNodes.Get(i));
+            uint64_t imsi = DynamicCast<LteUeNetDevice>(ueDevs.Get(i))->GetImsi();
+            if (imsi >= g_imsiToUeIndex.size())
+            {
+                g_imsiToUeIndex.resize(imsi + 1, 0);
+            }
+            g_imsiToUeIndex[imsi] = i;
+            AnimUpdateServingCell(imsi, ueAttachCellId[i]);
+        }
+    }
+
+    // UE trajectory sampling
+    if (params.trajectoryMode != "none")
+    {
+        TrajectorySampler::Mode mode = (params.trajectoryMode == "interval")
+                                           ? TrajectorySampler::INTERVAL
+                                           : TrajectorySampler::CHANGES;
+        if (!g_trajectorySampler.Open("ue_trajectory.bin",
+                                      ueNodes,
+                                      mode,
+                                      params.trajectoryInterval))
+        {
+            NS_LOG_ERROR("Failed to open ue_trajectory.bin for writing.");
+            return 1;
+        }
+    }
+
+    // Schedule Periodic Statistics Updates
+    g_statsScheduler.Start(params);
+
+    // Attribute values of the objects built above, from/to ConfigStore files
+    if (!params.configStoreIn.empty())
+    {
+        RunConfigStore(params.configStoreIn, "Load", false, true);
+    }
+    if (!params.configStoreOut.empty())
+    {
+        RunConfigStore(params.configStoreOut, "Save", true, true);
+    }
+
+    // Live status of the run, published from PeriodicStatsUpdate
+    if ((!params.statusFile.empty() || params.statusPort != 0) &&
+        !g_liveStatus.Start(params.statusFile,
+                            params.statusInterval,
+                            params.statusPort,
+                            params.simTime))
+    {
+        NS_LOG_ERROR("Failed to listen on status port " << params.statusPort);
+        return 1;
+    }
+
+    // Run Simulation
+    auto runStart = std::chrono::steady_clock::now();
+    Simulator::Stop(Seconds(params.simTime));
+    Simulator::Run();
+    auto runEnd = std::chrono::steady_clock::now();
+
+    // Finalize logging
+    g_liveStatus.Stop();
+    g_handoverLogger.Close();
+    g_metricsWriter.Close();
+    g_lteTraceSampler.Close();
+    g_trajectorySampler.Close();
+    if (g_cellKpi.file.is_open())
+    {
+        g_cellKpi.file.close();
+    }
+    if (g_schedulerTtiFile.is_open())
+    {
+        g_schedulerTtiFile.close();
+    }
+
+    // Final Analysis of the collected KPIs
+    AnalyzeData(flowMonitor, DynamicCast<Ipv4FlowClassifier>(flowHelper.GetClassifier()), params);
+
+    // Scheduler cost and allocation profile
+    if (!g_schedulerProfiles.empty() &&
+        !WriteSchedulerProfile("scheduler_profile.csv", params))
+    {
+        NS_LOG_ERROR("Failed to write scheduler_profile.csv");
+    }
+
+    // Simulator performance summary (read back by the benchmark driver)
+    if (!params.perfReport.empty() &&
+        !WritePerformanceReport(params.perfReport,
+                                std::chrono::duration<double>(runStart - wallStart).count(),
+                                std::chrono::duration<double>(runEnd - runStart).count(),
+                                params.simTime))
+    {
+        NS_LOG_ERROR("Failed to write performance report " << params.perfReport);
+    }
+
+    // Clean Up
+    Simulator::Destroy();
+    NS_LOG_INFO("LTE simulation finished!");
+    return 0;
+}
+
+// ============================================================================
+/**
+ * @brief Configures the logging levels for various components.
+ *
+ * Builds without NS3_LOG_ENABLE (the ns-3 optimized profile) compile NS_LOG_* and the
+ * scenario's own log formatting out entirely, so this only matters for debug builds.
+ * @param enableRrc Also log LteEnbRrc and LteUeRrc at INFO level (--logRrc).
+ */
+void
+ConfigureLogging(bool enableRrc)
+{
+    LogComponentEnable("VoipLteSimulation", LOG_LEVEL_INFO);
+    if (enableRrc)
+    {
+        LogComponentEnable("LteEnbRrc", LOG_LEVEL_INFO);
+        LogComponentEnable("LteUeRrc", LOG_LEVEL_INFO);
+    }
+    // Uncomment to enable more detailed logging
+    // LogComponentEnable("OnOffApplication", LOG_LEVEL_INFO);
+    // LogComponentEnable("PacketSink", LOG_LEVEL_INFO);
+}
+
+/**
+ * @brief Generates the eNodeB cell layout in a single pass.
+ *
+ * Sites come from one of three sources:
+ * - "auto": the original 2- and 4-cell layouts for those counts, a hex grid otherwise.
+ * - "hex": numEnb sites on hexagonal rings around the area center, interSiteDistance apart.
+ * - "file": one site per line of enbSiteFile as "x y [z [azimuth]]"; '#' starts a comment.
+ *   A line with an azimuth is a single sectorized cell.
+ * With triSector, every site without an explicit azimuth becomes three cells at 30, 150 and
+ * 270 degrees, so numEnb counts sites and the number of eNodeB nodes is cells.size().
+ * @param params Simulation parameters (layout, area size, eNodeB height).
+ * @param cells Output cells, sectors of a site stored contiguously.
+ * @return true on success, false on an unknown layout or an unreadable/empty site file.
+ */
+bool
+GenerateEnbLayout(const SimulationParameters& params, std::vector<EnbCell>& cells)
+{
+    struct Site
+    {
+        Vector position;
+        bool hasAzimuth;
+        double azimuth;
+    };
+
+    std::vector<Site> sites;
+    double areaSize = params.areaSize;
+    double center = areaSize / 2;
+    std::string layout = params.enbLayout;
+    if (layout == "auto")
+    {
+        layout = (params.numEnb == 2 || params.numEnb == 4) ? "legacy" : "hex";
+    }
+
+    if (layout == "legacy" && params.numEnb == 4)
+    {
+        // Four sites: 1/4 of the area from the center in cardinal directions
+        double offset = areaSize / 4;
+        sites.push_back({Vector(center - offset, center, params.enbHeight), false, 0}); // Left
+        sites.push_back({Vector(center + offset, center, params.enbHeight), false, 0}); // Right
+        sites.push_back({Vector(center, center - offset, params.enbHeight), false, 0}); // Bottom
+        sites.push_back({Vector(center, center + offset, params.enbHeight), false, 0}); // Top
+    }
+    else if (layout == "legacy" && params.numEnb == 2)
+    {
+        // Two sites: at (areaSize/4, areaSize/2) and (3*areaSize/4, areaSize/2)
+        sites.push_back({Vector(areaSize / 4, center, params.enbHeight), false, 0});
+        sites.push_back({Vector(3 * areaSize / 4, center, params.enbHeight), false, 0});
+    }
+    else if (layout == "hex")
+    {
+        // Axial hex coordinates, walked ring by ring: the center site, then 6k sites on ring k
+        static const int directions[6][2] = {{1, 0}, {1, -1}, {0, -1}, {-1, 0}, {-1, 1}, {0, 1}};
+        double isd = params.interSiteDistance > 0 ? params.interSiteDistance : areaSize / 2;
+        auto addSite = [&](int q, int r) {
+            double x = center + isd * (q + r / 2.0);
+            double y = center + isd * (std::sqrt(3.0) / 2.0) * r;
+            sites.push_back({Vector(x, y, params.enbHeight), false, 0});
+        };
+
+        if (params.numEnb > 0)
+        {
+            addSite(0, 0);
+        }
+        for (int ring = 1; sites.size() < params.numEnb; ++ring)
+        {
+            int q = -ring;
+            int r = ring;
+            for (int side = 0; side < 6 && sites.size() < params.numEnb; ++side)
+            {
+                for (int step = 0; step < ring && sites.size() < params.numEnb; ++step)
+                {
+                    addSite(q, r);
+                    q += directions[side][0];
+                    r += directions[side][1];
+                }
+            }
+        }
+    }
+    else if (layout == "file")
+    {
+        std::ifstream siteFile(params.enbSiteFile);
+        if (!siteFile.is_open())
+        {
+            NS_LOG_ERROR("Failed to open eNodeB site file: " << params.enbSiteFile);
+            return false;
+        }
+        std::string line;
+        uint32_t lineNumber = 0;
+        while (std::getline(siteFile, line))
+        {
+            ++lineNumber;
+            line = line.substr(0, line.find('#'));
+            std::istringstream fields(line);
+            Site site{Vector(0, 0, params.enbHeight), false, 0};
+            if (!(fields >> site.position.x))
+            {
+                continue; // Blank or comment-only line
+            }
+            if (!(fields >> site.position.y))
+            {
+                NS_LOG_ERROR(params.enbSiteFile << ":" << lineNumber << ": expected \"x y\"");
+                return false;
+            }
+            if (fields >> site.position.z)
+            {
+                site.hasAzimuth = static_cast<bool>(fields >> site.azimuth);
+            }
+            sites.push_back(site);
+        }
+        if (sites.empty())
+        {
+            NS_LOG_ERROR("No eNodeB sites in " << params.enbSiteFile);
+            return false;
+        }
+    }
+    else
+    {
+        NS_LOG_ERROR("Unknown eNodeB layout: " << params.enbLayout);
+        return false;
+    }
+
+    cells.clear();
+    cells.reserve(sites.size() * (params.triSector ? 3 : 1));
+    for (const Site& site : sites)
+    {
+        if (site.position.x < 0 || site.position.x > areaSize || site.position.y < 0 ||
+            site.position.y > areaSize)
+        {
+            NS_LOG_WARN("eNodeB site at (" << site.position.x << ", " << site.position.y
+                                           << ") lies outside the " << areaSize
+                                           << " m simulation area");
+        }
+
+        if (site.hasAzimuth)
+        {
+            cells.push_back({site.position, true, site.azimuth, 0, 1});
+        }
+        else if (params.triSector)
+        {
+            for (uint16_t sector = 0; sector < 3; ++sector)
+            {
+                cells.push_back({site.position, true, 30.0 + 120.0 * sector, sector, 3});
+            }
+        }
+        else
+        {
+            cells.push_back({site.position, false, 0, 0, 1});
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Places the eNodeBs at the generated cell positions.
+ * @param enbNodes Container of eNodeB nodes, one per cell.
+ * @param cells Cell layout from GenerateEnbLayout.
+ */
+void
+ConfigureEnbMobility(NodeContainer& enbNodes, const std::vector<EnbCell>& cells)
+{
+    MobilityHelper enbMobility;
+    Ptr<ListPositionAllocator> posAlloc = CreateObject<ListPositionAllocator>();
+    for (const EnbCell& cell : cells)
+    {
+        posAlloc->Add(cell.position);
+    }
+
+    enbMobility.SetPositionAllocator(posAlloc);
+    enbMobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+    enbMobility.Install(enbNodes);
+}
+
+/**
+ * @brief Picks the sector of the nearest site whose boresight is closest to a position.
+ *
+ * Co-located sectors are equidistant from every UE, so distance alone always picks the
+ * first one; the bearing from the site decides instead.
+ * @param cells Cell layout from GenerateEnbLayout.
+ * @param nearestCell Index of the nearest cell (any sector of the nearest site).
+ * @param pos UE position.
+ * @return Index of the selected cell.
+ */
+uint32_t
+SelectSector(const std::vector<EnbCell>& cells, uint32_t nearestCell, const Vector& pos)
+{
+    const EnbCell& nearest = cells[nearestCell];
+    uint32_t firstSector = nearestCell - nearest.sectorIndex;
+    if (nearest.siteSectors <= 1)
+    {
+        return nearestCell;
+    }
+
+    double bearing =
+        std::atan2(pos.y - nearest.position.y, pos.x - nearest.position.x) * 180.0 / M_PI;
+    uint32_t bestCell = firstSector;
+    double bestOffset = std::numeric_limits<double>::max();
+    for (uint32_t i = firstSector; i < firstSector + nearest.siteSectors; ++i)
+    {
+        double offset = std::fabs(std::remainder(bearing - cells[i].azimuth, 360.0));
+        if (offset < bestOffset)
+        {
+            bestOffset = offset;
+            bestCell = i;
+        }
+    }
+    return bestCell;
+}
+
+/**
+ * @brief Writes a topology layout file as text.
+ *
+ * Format (one record per line, '#' comments):
+ * - "topology <numUe> <mobilityMode> <areaSize> <numEnb> <numCells>"
+ * - "cell <x> <y> <z> <sectorized> <azimuth> <sectorIndex> <siteSectors>", numCells times
+ * - "ue <x> <y> <z> <attachEnb>", numUe times
+ * Values are written with full double precision so a reload reproduces the run exactly.
+ * @param path Output file path.
+ * @param snapshot Layout to write.
+ * @return true on success.
+ */
+bool
+SaveTopologySnapshot(const std::string& path, const TopologySnapshot& snapshot)
+{
+    std::ofstream out(path);
+    if (!out.is_open())
+    {
+        return false;
+    }
+    out.precision(std::numeric_limits<double>::max_digits10);
+    out << "# lte-voip-simulation topology layout\n";
+    out << "topology " << snapshot.numUe << " " << snapshot.mobilityMode << " "
+        << snapshot.areaSize << " " << snapshot.numEnb << " " << snapshot.cells.size() << "\n";
+    for (const EnbCell& cell : snapshot.cells)
+    {
+        out << "cell " << cell.position.x << " " << cell.position.y << " " << cell.position.z
+            << " " << cell.sectorized << " " << cell.azimuth << " " << cell.sectorIndex << " "
+            << cell.siteSectors << "\n";
+    }
+    for (size_t i = 0; i < snapshot.uePositions.size(); ++i)
+    {
+        const Vector& pos = snapshot.uePositions[i];
+        out << "ue " << pos.x << " " << pos.y << " " << pos.z << " " << snapshot.ueAttachEnb[i]
+            << "\n";
+    }
+    NS_LOG_INFO("Topology layout written to " << path);
+    return out.good();
+}
+
+/**
+ * @brief Reads a topology layout file written by SaveTopologySnapshot.
+ * @param path Layout file path.
+ * @param snapshot Output snapshot.
+ * @return false if the file cannot be read or is inconsistent.
+ */
+bool
+LoadTopologySnapshot(const std::string& path, TopologySnapshot& snapshot)
+{
+    std::ifstream in(path);
+    if (!in.is_open())
+    {
+        NS_LOG_ERROR("Failed to open topology layout " << path);
+        return false;
+    }
+
+    std::string line;
+    size_t numCells = 0;
+    bool haveHeader = false;
+    while (std::getline(in, line))
+    {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::string kind;
+        if (!(fields >> kind))
+        {
+            continue;
+        }
+
+        bool ok = true;
+        if (kind == "topology")
+        {
+            ok = static_cast<bool>(fields >> snapshot.numUe >> snapshot.mobilityMode >>
+                                   snapshot.areaSize >> snapshot.numEnb >> numCells);
+            haveHeader = ok;
+        }
+        else if (kind == "cell")
+        {
+            EnbCell cell;
+            ok = static_cast<bool>(fields >> cell.position.x >> cell.position.y >>
+                                   cell.position.z >> cell.sectorized >> cell.azimuth >>
+                                   cell.sectorIndex >> cell.siteSectors);
+            snapshot.cells.push_back(cell);
+        }
+        else if (kind == "ue")
+        {
+            Vector pos;
+            uint32_t attachEnb = 0;
+            ok = static_cast<bool>(fields >> pos.x >> pos.y >> pos.z >> attachEnb);
+            snapshot.uePositions.push_back(pos);
+            snapshot.ueAttachEnb.push_back(attachEnb);
+        }
+        else
+        {
+            ok = false;
+        }
+        if (!ok)
+        {
+            NS_LOG_ERROR(path << ": malformed line \"" << line << "\"");
+            return false;
+        }
+    }
+
+    if (!haveHeader || snapshot.cells.size() != numCells || numCells == 0 ||
+        snapshot.uePositions.size() != snapshot.numUe)
+    {
+        NS_LOG_ERROR(path << ": incomplete topology layout");
+        return false;
+    }
+    for (uint32_t attachEnb : snapshot.ueAttachEnb)
+    {
+        if (attachEnb >= numCells)
+        {
+            NS_LOG_ERROR(path << ": attach index " << attachEnb << " out of range");
+            return false;
+        }
+    }
+    NS_LOG_INFO("Topology layout loaded from " << path << " (" << numCells << " cells, "
+                                                 << snapshot.numUe << " UEs)");
+    return true;
+}
+
+/**
+ * @brief Checks that a loaded topology layout file belongs to this run's configuration.
+ *
+ * The file only replaces UE placement and attachment, so the run's numUe, mobility mode,
+ * area size, numEnb and generated eNodeB cells must all match the ones it was written with.
+ * @param path Layout file path (for messages).
+ * @param snapshot Loaded layout.
+ * @param params Parameters of this run.
+ * @param cells eNodeB cells generated for this run.
+ * @return false (with an error logged) on the first mismatch.
+ */
+bool
+CheckTopologySnapshot(const std::string& path,
+                      const TopologySnapshot& snapshot,
+                      const SimulationParameters& params,
+                      const std::vector<EnbCell>& cells)
+{
+    const double tolerance = 1e-6; // Meters / degrees; the file keeps full precision
+    if (snapshot.numUe != params.numUe || snapshot.mobilityMode != params.mobilityMode ||
+        snapshot.numEnb != params.numEnb ||
+        std::fabs(snapshot.areaSize - params.areaSize) > tolerance)
+    {
+        NS_LOG_ERROR("Topology layout " << path << " is for numUe=" << snapshot.numUe
+                                        << " mobilityMode=" << snapshot.mobilityMode
+                                        << " numEnb=" << snapshot.numEnb
+                                        << " areaSize=" << snapshot.areaSize);
+        return false;
+    }
+    if (snapshot.cells.size() != cells.size())
+    {
+        NS_LOG_ERROR("Topology layout " << path << " has " << snapshot.cells.size()
+                                        << " cells, this run's layout has " << cells.size());
+        return false;
+    }
+    for (size_t i = 0; i < cells.size(); ++i)
+    {
+        const EnbCell& saved = snapshot.cells[i];
+        if (CalculateDistance(saved.position, cells[i].position) > tolerance ||
+            saved.sectorized != cells[i].sectorized ||
+            (saved.sectorized && std::fabs(saved.azimuth - cells[i].azimuth) > tolerance))
+        {
+            NS_LOG_ERROR("Topology layout " << path << ": cell " << i << " at "
+                                            << saved.position << " does not match this run's "
+                                            << "eNodeB site at " << cells[i].position);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Configures the mobility model for UEs based on the selected mobility mode.
+ * @param ueNodes Container of UE nodes.
+ * @param areaSize Size of the simulation area.
+ * @param enbNodes Container of eNodeB nodes.
+ * @param mobilityMode Selected mobility mode.
+ * @param params Simulation parameters including path loss distances.
+ */
+void
+ConfigureUeMobility(NodeContainer& ueNodes,
+                    double areaSize,
+                    NodeContainer& enbNodes,
+                    SimulationParameters::MobilityMode mobilityMode,
+                    const SimulationParameters& params)
+{
+    switch (mobilityMode)
+    {
+    case SimulationParameters::RANDOM_WAYPOINT: {
+        MobilityHelper ueMobility;
+        Ptr<RandomRectanglePositionAllocator> positionAlloc =
+            CreateObject<RandomRectanglePositionAllocator>();
+
+        std::ostringstream xBound, yBound;
+        xBound << "ns3::UniformRandomVariable[Min=0.0|Max=" << areaSize << "]";
+        yBound << "ns3::UniformRandomVariable[Min=0.0|Max=" << areaSize << "]";
+        positionAlloc->SetAttribute("X", StringValue(xBound.str()));
+        positionAlloc->SetAttribute("Y", StringValue(yBound.str()));
+        positionAlloc->AssignStreams(STREAM_UE_PLACEMENT);
+
+        ueMobility.SetPositionAllocator(positionAlloc);
+        ueMobility.SetMobilityModel("ns3::RandomWaypointMobilityModel",
+                                    "Speed",
+                                    StringValue("ns3::UniformRandomVariable[Min=10.0|Max=30.0]"),
+                                    "Pause",
+                                    StringValue("ns3::ConstantRandomVariable[Constant=2.0]"),
+                                    "PositionAllocator",
+                                    PointerValue(positionAlloc));
+        ueMobility.Install(ueNodes);
+        ueMobility.AssignStreams(ueNodes, STREAM_UE_MOBILITY);
+        NS_LOG_INFO("Configured UEs with RandomWaypoint Mobility Model.");
+        break;
+    }
+    case SimulationParameters::CONSTANT_UNDER_DISTANCE0:
+    case SimulationParameters::CONSTANT_UNDER_DISTANCE1:
+    case SimulationParameters::CONSTANT_ABOVE_DISTANCE1: {
+        // Constant Position Mobility Model with random placement based on distance
+        MobilityHelper ueMobility;
+        ueMobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+        ueMobility.Install(ueNodes);
+
+        // Define distance range based on mobility mode
+        double minDist = 0.0;
+        double maxDist = 0.0;
+        if (mobilityMode == SimulationParameters::CONSTANT_UNDER_DISTANCE0)
+        {
+            minDist = 0.0;
+            maxDist = params.distance0;
+        }
+        else if (mobilityMode == SimulationParameters::CONSTANT_UNDER_DISTANCE1)
+        {
+            minDist = (params.distance1 / 2.0) - 10.0;
+            maxDist = (params.distance1 / 2.0) + 10.0;
+        }
+        else if (mobilityMode == SimulationParameters::CONSTANT_ABOVE_DISTANCE1)
+        {
+            minDist = params.distance1;
+            maxDist = params.areaSize / 2.0; // Assuming maximum possible distance from center
+        }
+
+        // Position offsets from the scenario's own RNG streams
+        Ptr<UniformRandomVariable> distanceRv = CreateObject<UniformRandomVariable>();
+        distanceRv->SetAttribute("Min", DoubleValue(minDist));
+        distanceRv->SetAttribute("Max", DoubleValue(maxDist));
+        distanceRv->SetStream(STREAM_UE_PLACEMENT);
+        Ptr<UniformRandomVariable> angleRv = CreateObject<UniformRandomVariable>();
+        angleRv->SetAttribute("Min", DoubleValue(0.0));
+        angleRv->SetAttribute("Max", DoubleValue(2 * M_PI));
+        angleRv->SetStream(STREAM_UE_PLACEMENT + 1);
+
+        for (uint32_t i = 0; i < ueNodes.GetN(); ++i)
+        {
+            Ptr<Node> ue = ueNodes.Get(i);
+            Ptr<MobilityModel> ueMob = ue->GetObject<MobilityModel>();
+            if (!ueMob)
+            {
+                NS_LOG_WARN("UE " << i << " has no MobilityModel!");
+                continue;
+            }
+
+            // Generate random distance and angle
+            double distance = distanceRv->GetValue();
+            double angle = angleRv->GetValue();
+
+            // Calculate UE position relative to the center of the simulation area
+            double centerX = params.areaSize / 2.0;
+            double centerY = params.areaSize / 2.0;
+            double ueX = centerX + distance * cos(angle);
+            double ueY = centerY + distance * sin(angle);
+
+            // Ensure UE is within the simulation area
+            ueX = std::max(0.0, std::min(ueX, params.areaSize));
+            ueY = std::max(0.0, std::min(ueY, params.areaSize));
+
+            // Set the calculated position
+            ueMob->SetPosition(Vector(ueX, ueY, 0.0));
+
+            NS_LOG_INFO("UE " << i << " positioned at (" << ueX << ", " << ueY << ", 0.0)");
+        }
+
+        NS_LOG_INFO("Configured UEs with Constant Position Mobility Model.");
+        break;
+    }
+    default:
+        NS_LOG_ERROR("Misconfigured, stop simulation.");
+        exit(1);
+    }
+}
+
+/**
+ * @brief Creates a remote host connected to the PGW via a Point-to-Point link.
+ * @param epcHelper EPC helper.
+ * @param remoteHostContainer Container holding the remote host node.
+ * @param areaSize Size of the simulation area.
+ * @return Ipv4Address of the remote host.
+ */
+Ipv4Address
+CreateRemoteHost(Ptr<PointToPointEpcHelper> epcHelper,
+                 NodeContainer& remoteHostContainer,
+                 double areaSize)
+{
+    Ptr<Node> pgw = epcHelper->GetPgwNode();
+    PointToPointHelper p2p;
+    p2p.SetDeviceAttribute("DataRate", StringValue("1Gbps"));
+    p2p.SetChannelAttribute("Delay", StringValue("10ms"));
+
+    NetDeviceContainer devices = p2p.Install(pgw, remoteHostContainer.Get(0));
+    Ipv4AddressHelper ipv4;
+    ipv4.SetBase("1.0.0.0", "255.255.255.0");
+    Ipv4InterfaceContainer interfaces = ipv4.Assign(devices);
+
+    // Enable PCAP tracing
+    p2p.EnablePcap("pgw-p2p", devices.Get(0), true);
+    p2p.EnablePcap("remote-host-p2p", devices.Get(1), true);
+
+    NS_LOG_INFO("Remote Host IP Address: " << interfaces.GetAddress(1));
+
+    return interfaces.GetAddress(1); // Remote Host IP
+}
+
+/**
+ * @brief Starts a call once its UE's RRC reconfiguration has set up the default bearer.
+ *
+ * Connected to the UE RRC ConnectionReconfiguration trace with a loaded topology layout.
+ * Later reconfigurations of a running call are ignored.
+ * @param call UE end of the call.
+ * @param server Server holding the downlink end.
+ * @param ueIndex UE index (call index on the server).
+ * @param imsi UE IMSI.
+ * @param cellId Serving cell ID.
+ * @param rnti UE RNTI.
+ */
+void
+StartCallOnBearerSetup(Ptr<VoipCallApplication> call,
+                       Ptr<VoipMuxServer> server,
+                       uint32_t ueIndex,
+                       [[maybe_unused]] uint64_t imsi,
+                       [[maybe_unused]] uint16_t cellId,
+                       [[maybe_unused]] uint16_t rnti)
+{
+    if (call->StartCall())
+    {
+        server->StartCall(ueIndex);
+    }
+}
+
+/**
+ * @brief Installs the VoIP calls: one VoipCallApplication per UE and one VoipMuxServer.
+ *
+ * Frames of codec.packetSize bytes are sent every packetSize * 8 / bitrate. With
+ * voipActivity=p59 both directions follow the ITU-T P.59 talkspurt model; otherwise frames
+ * are sent at a constant rate. All calls share one port and the single server socket on
+ * the remote host; with voipBidirectional the server also sends a downlink stream per call.
+ *
+ * The calls start at 1 s, by which time every UE has attached. With a loaded topology
+ * layout (topologyLoad) each call instead starts when its UE's default bearer is set up
+ * (StartCallOnBearerSetup), typically a few tens of milliseconds into the run.
+ * @param ueNodes Container of UE nodes.
+ * @param ueDevs UE LTE devices, in UE index order.
+ * @param ueAddresses UE IPv4 addresses, in UE index order.
+ * @param remoteAddr IP address of the remote host.
+ * @param simTime Total simulation time.
+ * @param remoteHostContainer Container holding the remote host node.
+ * @param params Simulation parameters including VoIP codec configurations.
+ */
+void
+InstallVoipApplications(NodeContainer& ueNodes,
+                        const NetDeviceContainer& ueDevs,
+                        const std::vector<Ipv4Address>& ueAddresses,
+                        Ipv4Address remoteAddr,
+                        double simTime,
+                        NodeContainer& remoteHostContainer,
+                        const SimulationParameters& params)
+{
+    const uint16_t port = 5000;
+    bool startOnBearer = !params.topologyLoad.empty();
+    Time frameInterval = Seconds(params.codec.packetSize * 8.0 / (params.codec.bitrate * 1000.0));
+    double silenceMean = (params.voipActivity == "p59") ? params.silenceMean : 0.0;
+
+    // One server for all calls on the remote host. It starts with the calls, so the first
+    // downlink frames find the UE sockets bound; on bearer setup it starts each stream.
+    Ptr<VoipMuxServer> server = CreateObject<VoipMuxServer>();
+    server->SetAttribute("Port", UintegerValue(port));
+    server->SetAttribute("Bidirectional", BooleanValue(params.voipBidirectional));
+    server->SetAttribute("CallsOnDemand", BooleanValue(startOnBearer));
+    server->SetAttribute("PacketSize", UintegerValue(params.codec.packetSize));
+    server->SetAttribute("FrameInterval", TimeValue(frameInterval));
+    server->SetAttribute("TalkspurtMean", DoubleValue(params.talkspurtMean));
+    server->SetAttribute("SilenceMean", DoubleValue(silenceMean));
+    server->AssignVoiceActivityStreams(STREAM_VOIP);
+    remoteHostContainer.Get(0)->AddApplication(server);
+    server->SetStartTime(Seconds(startOnBearer ? 0.0 : 1.0));
+    server->SetStopTime(Seconds(simTime));
+
+    for (uint32_t i = 0; i < ueNodes.GetN(); ++i)
+    {
+        server->AddCall(i, ueAddresses[i]);
+
+        // Install the call on the UE
+        Ptr<VoipCallApplication> call = CreateObject<VoipCallApplication>();
+        call->SetAttribute("PacketSize", UintegerValue(params.codec.packetSize));
+        call->SetAttribute("FrameInterval", TimeValue(frameInterval));
+        call->SetAttribute("TalkspurtMean", DoubleValue(params.talkspurtMean));
+        call->SetAttribute("SilenceMean", DoubleValue(silenceMean));
+        call->Setup(i, remoteAddr, port);
+        call->AssignVoiceActivityStreams(STREAM_VOIP + 2 + 2 * int64_t(i));
+        ueNodes.Get(i)->AddApplication(call);
+        if (startOnBearer)
+        {
+            // Never reached: the simulation stops first unless the bearer starts the call
+            call->SetStartTime(Seconds(simTime));
+            DynamicCast<LteUeNetDevice>(ueDevs.Get(i))
+                ->GetRrc()
+                ->TraceConnectWithoutContext(
+                    "ConnectionReconfiguration",
+                    MakeBoundCallback(&StartCallOnBearerSetup, call, server, i));
+        }
+        else
+        {
+            call->SetStartTime(Seconds(1.0));
+        }
+        call->SetStopTime(Seconds(simTime));
+    }
+
+    NS_LOG_INFO("Installed " << ueNodes.GetN() << " VoIP calls on port " << port << " ("
+                             << params.voipActivity
+                             << (params.voipBidirectional ? ", bidirectional" : "")
+                             << (startOnBearer ? ", started on bearer setup)" : ")"));
+}
+
+/**
+ * @brief Sets up FlowMonitor for a detailed per-flow record (flowmon.xml).
+ *
+ * The KPIs themselves come from the timestamp-tag collector; FlowMonitor is only installed
+ * on the flow endpoints (UEs and remote host), not on every forwarding node.
+ * @param flowHelper FlowMonitorHelper instance.
+ * @param ueNodes Container of UE nodes.
+ * @param remoteHostContainer Container holding the remote host node.
+ * @return Pointer to the installed FlowMonitor.
+ */
+Ptr<FlowMonitor>
+SetupFlowMonitor(FlowMonitorHelper& flowHelper,
+                 NodeContainer& ueNodes,
+                 NodeContainer& remoteHostContainer)
+{
+    Ptr<FlowMonitor> flowMonitor = flowHelper.Install(NodeContainer(ueNodes, remoteHostContainer));
+    NS_LOG_INFO("FlowMonitor installed.");
+    return flowMonitor;
+}
+
+/**
+ * @brief Enables LTE tracing according to the selected trace profile.
+ *
+ * Profiles are cumulative:
+ * | Profile  | Output                                                               |
+ * |----------|----------------------------------------------------------------------|
+ * | none     | no LTE traces                                                        |
+ * | kpi      | lte-kpi-phy.txt: sampled UE RSRP/SINR                                |
+ * | rlc-pdcp | kpi + RlcStats/PdcpStats aggregated every traceEpoch                 |
+ * | full     | rlc-pdcp + PHY/MAC traces                                            |
+ *
+ * In the full profile the built-in PHY/MAC traces are used unchanged unless decimation or
+ * a UE subset is requested; then they are replaced by lte-kpi-phy.txt and lte-mac-sampled.txt.
+ * The UE subset applies to the PHY and MAC layers; RLC/PDCP statistics always cover all UEs.
+ * @param lteHelper LTE helper instance.
+ * @param enbDevs eNodeB devices.
+ * @param ueDevs UE devices.
+ * @param params Simulation parameters.
+ * @return false if the trace configuration is invalid or a trace file cannot be opened.
+ */
+bool
+EnableLteTraces(Ptr<LteHelper> lteHelper,
+                const NetDeviceContainer& enbDevs,
+                const NetDeviceContainer& ueDevs,
+                const SimulationParameters& params)
+{
+    static const std::map<std::string, uint32_t> profileLevels = {{"none", 0},
+                                                                  {"kpi", 1},
+                                                                  {"rlc-pdcp", 2},
+                                                                  {"full", 3}};
+    auto levelIt = profileLevels.find(params.traceProfile);
+    if (levelIt == profileLevels.end())
+    {
+        NS_LOG_ERROR("Unknown LTE trace profile: " << params.traceProfile);
+        return false;
+    }
+    uint32_t level = levelIt->second;
+
+    // Resolve the traced UE subset
+    std::vector<uint32_t> tracedUes;
+    for (const auto& item : SplitList(params.traceUes))
+    {
+        uint64_t ueIndex = 0;
+        if (!ParseUnsigned(item, ueIndex))
+        {
+            NS_LOG_ERROR("Invalid traced UE index '" << item << "' in --traceUes");
+            return false;
+        }
+        if (ueIndex >= ueDevs.GetN())
+        {
+            NS_LOG_ERROR("Traced UE index out of range: " << ueIndex << " (numUe "
+                                                          << ueDevs.GetN() << ")");
+            return false;
+        }
+        tracedUes.push_back(ueIndex);
+    }
+    bool filtered = !tracedUes.empty() || params.traceDecimation > 1;
+    if (tracedUes.empty())
+    {
+        for (uint32_t i = 0; i < ueDevs.GetN(); ++i)
+        {
+            tracedUes.push_back(i);
+        }
+    }
+
+    g_lteTraceSampler.decimation = std::max(1u, params.traceDecimation);
+    g_lteTraceSampler.phyReportCount.assign(ueDevs.GetN(), 0);
+    g_lteTraceSampler.ueImsi.assign(ueDevs.GetN(), 0);
+    g_lteTraceSampler.filterUes = false;
+    g_lteTraceSampler.tracedKeys.clear();
+
+    // KPI: sampled RSRP/SINR reports of the traced UEs
+    if (level >= 1 && (level < 3 || filtered))
+    {
+        g_lteTraceSampler.phyFile.open("lte-kpi-phy.txt", std::ios::out | std::ios::trunc);
+        if (!g_lteTraceSampler.phyFile.is_open())
+        {
+            NS_LOG_ERROR("Failed to open lte-kpi-phy.txt for writing.");
+            return false;
+        }
+        g_lteTraceSampler.phyFile << "% time\tcellId\tIMSI\tRNTI\trsrp\tsinr\tcomponentCarrierId\n";
+        for (uint32_t ueIndex : tracedUes)
+        {
+            Ptr<LteUeNetDevice> ueDev = DynamicCast<LteUeNetDevice>(ueDevs.Get(ueIndex));
+            g_lteTraceSampler.ueImsi[ueIndex] = ueDev->GetImsi();
+            ueDev->GetPhy()->TraceConnectWithoutContext(
+                "ReportCurrentCellRsrpSinr",
+                MakeBoundCallback(&TracePhyRsrpSinr, ueIndex));
+        }
+    }
+
+    // RLC and PDCP statistics, aggregated over traceEpoch
+    if (level >= 2)
+    {
+        lteHelper->EnableRlcTraces();
+        lteHelper->EnablePdcpTraces();
+        lteHelper->GetRlcStats()->SetAttribute("EpochDuration",
+                                               TimeValue(Seconds(params.traceEpoch)));
+        lteHelper->GetPdcpStats()->SetAttribute("EpochDuration",
+                                                TimeValue(Seconds(params.traceEpoch)));
+    }
+
+    // PHY and MAC: built-in traces, or sampled MAC scheduling when filtering is requested
+    if (level >= 3 && !filtered)
+    {
+        lteHelper->EnablePhyTraces();
+        lteHelper->EnableMacTraces();
+    }
+    else if (level >= 3)
+    {
+        // Follow each traced UE's (cellId, rnti) through connection, handover and failure
+        if (tracedUes.size() != ueDevs.GetN())
+        {
+            g_lteTraceSampler.filterUes = true;
+            for (uint32_t ueIndex : tracedUes)
+            {
+                Ptr<LteUeRrc> ueRrc = DynamicCast<LteUeNetDevice>(ueDevs.Get(ueIndex))->GetRrc();
+                ueRrc->TraceConnectWithoutContext("ConnectionEstablished",
+                                                  MakeCallback(&TraceUeConnectionUp));
+                ueRrc->TraceConnectWithoutContext("HandoverEndOk",
+                                                  MakeCallback(&TraceUeConnectionUp));
+                ueRrc->TraceConnectWithoutContext("HandoverStart",
+                                                  MakeCallback(&TraceUeHandoverStart));
+                ueRrc->TraceConnectWithoutContext("RadioLinkFailure",
+                                                  MakeCallback(&TraceUeConnectionDown));
+            }
+        }
+
+        g_lteTraceSampler.macFile.open("lte-mac-sampled.txt", std::ios::out | std::ios::trunc);
+        if (!g_lteTraceSampler.macFile.is_open())
+        {
+            NS_LOG_ERROR("Failed to open lte-mac-sampled.txt for writing.");
+            return false;
+        }
+        g_lteTraceSampler.macFile << "% time\tdir\tcellId\tframe\tsframe\tRNTI\tmcsTb1\tsizeTb1"
+                                     "\tmcsTb2\tsizeTb2\tcomponentCarrierId\n";
+        for (uint32_t i = 0; i < enbDevs.GetN(); ++i)
+        {
+            Ptr<LteEnbNetDevice> enbDev = DynamicCast<LteEnbNetDevice>(enbDevs.Get(i));
+            Ptr<LteEnbMac> enbMac = enbDev->GetMac();
+            enbMac->TraceConnectWithoutContext(
+                "DlScheduling",
+                MakeBoundCallback(&TraceMacDlScheduling, enbDev->GetCellId()));
+            enbMac->TraceConnectWithoutContext(
+                "UlScheduling",
+                MakeBoundCallback(&TraceMacUlScheduling, enbDev->GetCellId()));
+        }
+    }
+
+    NS_LOG_INFO("Enabled LTE Traces (profile " << params.traceProfile << ", decimation "
+                                               << g_lteTraceSampler.decimation << ", "
+                                               << tracedUes.size() << " UEs).");
+    return true;
+}
+
+/**
+ * @brief Periodically updates and logs network statistics.
+ *
+ * Reads the KPI collector (g_voipKpi) directly: throughput and latency come from the
+ * counter deltas since the previous sample, packet loss from the cumulative counters and
+ * jitter is the current RFC 3550 estimate.
+ * @param params Simulation parameters.
+ */
+void
+PeriodicStatsUpdate(const SimulationParameters& params)
+{
+    auto sampleStart = std::chrono::steady_clock::now();
+    g_currentTime = Simulator::Now().GetSeconds();
+    double interval = g_currentTime - g_statsScheduler.lastSample;
+    g_statsScheduler.lastSample = g_currentTime;
+
+    // Log handover counts
+    uint32_t handoverStarts = g_handoverStartCount;
+    uint32_t handoverSuccesses = g_handoverSuccessCount;
+    uint32_t handoverFailures = g_handoverFailureCount;
+
+    // Reset counters for the next interval
+    g_handoverStartCount = 0;
+    g_handoverSuccessCount = 0;
+    g_handoverFailureCount = 0;
+
+    // Initialize per-UE metrics
+    std::vector<double> ueThroughputKbps(params.numUe, 0.0);
+    std::vector<double> uePacketLossRate(params.numUe, 0.0);
+    std::vector<double> ueJitterMs(params.numUe, 0.0);
+
+    double totalLatencySum = 0.0;
+    uint64_t totalRxPackets = 0;
+    uint64_t totalTxPackets = 0;
+    uint64_t outstandingPackets = 0;
+
+    const VoipKpiCounters& kpi = g_voipKpi;
+    for (uint32_t ueIndex = 0; ueIndex < params.numUe; ueIndex++)
+    {
+        // Calculate throughput
+        uint64_t deltaBytes = kpi.rxBytes[ueIndex] - g_ueFlowState.prevRxBytes[ueIndex];
+        g_ueFlowState.prevRxBytes[ueIndex] = kpi.rxBytes[ueIndex];
+        ueThroughputKbps[ueIndex] = (deltaBytes * 8.0) / 1000.0 / interval;
+
+        // Calculate packet loss rate (packets still in flight count as lost)
+        uint64_t txPkts = kpi.txPackets[ueIndex];
+        uint64_t rxPkts = std::min(kpi.rxPackets[ueIndex], txPkts);
+        uePacketLossRate[ueIndex] =
+            (txPkts > 0) ? (double)(txPkts - rxPkts) / (double)txPkts * 100.0 : 0.0;
+        totalTxPackets += txPkts;
+        outstandingPackets += txPkts - rxPkts;
+
+        // Calculate latency
+        uint64_t deltaPackets = kpi.rxPackets[ueIndex] - g_ueFlowState.prevRxPackets[ueIndex];
+        g_ueFlowState.prevRxPackets[ueIndex] = kpi.rxPackets[ueIndex];
+        double deltaDelaySum = kpi.delaySum[ueIndex] - g_ueFlowState.prevDelaySum[ueIndex];
+        g_ueFlowState.prevDelaySum[ueIndex] = kpi.delaySum[ueIndex];
+        if (deltaPackets > 0)
+        {
+            totalLatencySum += deltaDelaySum * 1000.0;
+            totalRxPackets += deltaPackets;
+        }
+        if (g_cellKpi.file.is_open())
+        {
+            g_cellKpi.Add(ueIndex, deltaBytes, deltaPackets, deltaDelaySum);
+        }
+
+        // RFC 3550 jitter
+        ueJitterMs[ueIndex] = kpi.jitter[ueIndex] * 1000.0;
+    }
+
+    // Tail latency and jitter of this interval, then start the next interval afresh
+    LatencyQuantiles quantiles;
+    quantiles.p95LatencyMs = LogHistogram::Quantile(g_voipKpi.intervalDelayBins.data(), 0.95) * 1e3;
+    quantiles.p99LatencyMs = LogHistogram::Quantile(g_voipKpi.intervalDelayBins.data(), 0.99) * 1e3;
+    quantiles.p95JitterMs = LogHistogram::Quantile(g_voipKpi.intervalJitterBins.data(), 0.95) * 1e3;
+    quantiles.p99JitterMs = LogHistogram::Quantile(g_voipKpi.intervalJitterBins.data(), 0.99) * 1e3;
+    std::fill(g_voipKpi.intervalDelayBins.begin(), g_voipKpi.intervalDelayBins.end(), 0);
+    std::fill(g_voipKpi.intervalJitterBins.begin(), g_voipKpi.intervalJitterBins.end(), 0);
+
+    // Aggregate metrics
+    double aggregateThroughputKbps = 0.0;
+    for (uint32_t i = 0; i < params.numUe; i++)
+    {
+        aggregateThroughputKbps += ueThroughputKbps[i];
+    }
+
+    double avgLatencyMs = (totalRxPackets > 0) ? (totalLatencySum / (double)totalRxPackets) : 0.0;
+
+    // Compute average throughput across all UEs
+    double avgThroughputKbps = (params.numUe > 0) ? (aggregateThroughputKbps / params.numUe) : 0.0;
+
+    // Stream the sample to disk
+    g_metricsWriter.WriteSample(g_currentTime,
+                                avgThroughputKbps,
+                                ueThroughputKbps,
+                                avgLatencyMs,
+                                uePacketLossRate,
+                                ueJitterMs,
+                                handoverStarts,
+                                handoverSuccesses,
+                                handoverFailures,
+                                quantiles);
+
+    if (g_cellKpi.file.is_open())
+    {
+        g_cellKpi.WriteSample(g_currentTime, interval);
+    }
+
+#ifdef NS3_LOG_ENABLE
+    // Log current statistics; the per-UE strings are only built when their level is on
+    if (g_log.IsEnabled(LOG_INFO))
+    {
+        std::ostringstream oss;
+        oss << "Time: " << g_currentTime << "s, "
+            << "Aggregate Throughput: " << aggregateThroughputKbps << " Kbps, "
+            << "Average Throughput: " << avgThroughputKbps << " Kbps, "
+            << "Avg Latency: " << avgLatencyMs << " ms, "
+            << "P99 Latency: " << quantiles.p99LatencyMs << " ms";
+        for (uint32_t i = 0; i < params.numUe; i++)
+        {
+            oss << ", UE" << i << " Thr: " << ueThroughputKbps[i] << " Kbps";
+        }
+        NS_LOG_INFO(oss.str());
+    }
+
+    // Additional Debugging: Log per-UE Packet Loss and Jitter
+    if (g_log.IsEnabled(LOG_DEBUG))
+    {
+        std::ostringstream oss_detail;
+        oss_detail << "Time: " << g_currentTime << "s, ";
+        for (uint32_t i = 0; i < params.numUe; i++)
+        {
+            oss_detail << "UE" << i << " PL: " << uePacketLossRate[i] << "%, "
+                       << "Jitter: " << ueJitterMs[i] << " ms; ";
+        }
+        NS_LOG_DEBUG(oss_detail.str());
+    }
+#endif
+
+    // Schedule next statistics update: a loss burst is a rise in packets sent but not received
+    StatsScheduler& scheduler = g_statsScheduler;
+    uint64_t intervalTx = totalTxPackets - scheduler.lastTxPackets;
+    uint64_t intervalLost = (outstandingPackets > scheduler.lastOutstanding)
+                                ? outstandingPackets - scheduler.lastOutstanding
+                                : 0;
+    scheduler.lastTxPackets = totalTxPackets;
+    scheduler.lastOutstanding = outstandingPackets;
+    bool lossBurst =
+        intervalLost > 0 && intervalLost * 100.0 > scheduler.lossThreshold * intervalTx;
+    scheduler.ScheduleNext(handoverStarts + handoverFailures > 0 || lossBurst);
+
+    // Live status counters
+    g_totalHandovers += handoverStarts;
+    g_totalHandoverFailures += handoverFailures;
+    g_samplerNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - sampleStart)
+                       .count();
+    g_liveStatus.Publish(Simulator::GetEventCount(),
+                         g_currentTime,
+                         outstandingPackets,
+                         g_totalHandovers,
+                         g_totalHandoverFailures,
+                         g_samplerNs);
+}
+
+void
+StatsScheduler::Start(const SimulationParameters& p)
+{
+    params = &p;
+    adaptive = (p.statsMode == "adaptive");
+    minInterval = p.statsInterval;
+    maxInterval = adaptive ? p.statsIntervalMax : p.statsInterval;
+    lossThreshold = p.statsLossThreshold;
+    stopTime = p.simTime;
+    interval = minInterval;
+    lastSample = Simulator::Now().GetSeconds();
+    next = Simulator::Schedule(Seconds(interval), &PeriodicStatsUpdate, std::cref(*params));
+}
+
+void
+StatsScheduler::ScheduleNext(bool busy)
+{
+    interval = busy ? minInterval : std::min(interval * 2.0, maxInterval);
+    double now = Simulator::Now().GetSeconds();
+    if (now + interval <= stopTime)
+    {
+        next = Simulator::Schedule(Seconds(interval), &PeriodicStatsUpdate, std::cref(*params));
+    }
+    else if (adaptive && now + minInterval <= stopTime)
+    {
+        // Close the run with a final sample at stopTime instead of losing the tail
+        interval = stopTime - now;
+        next = Simulator::Schedule(Seconds(interval), &PeriodicStatsUpdate, std::cref(*params));
+    }
+}
+
+void
+StatsScheduler::Densify()
+{
+    if (!adaptive || !next.IsRunning())
+    {
+        return;
+    }
+    interval = minInterval;
+    if (Simulator::GetDelayLeft(next).GetSeconds() > minInterval)
+    {
+        next.Cancel();
+        next = Simulator::Schedule(Seconds(minInterval), &PeriodicStatsUpdate, std::cref(*params));
+    }
+}
+
+/**
+ * @brief Estimates the MOS of a call with the simplified ITU-T G.107 E-model.
+ *
+ * R = 93.2 - Id - Ie,eff with Id = 0.024 d + 0.11 (d - 177.3) H(d - 177.3) and
+ * Ie,eff = Ie + (95 - Ie) Ppl / (Ppl + Bpl) (random loss). The mouth-to-ear delay d adds
+ * the packetization time (packet size / bitrate) and the codec lookahead to the network
+ * delay. R is mapped to MOS per G.107 Annex B.
+ * @param codec VoIP codec (bitrate, packet size, Ie, Bpl, lookahead).
+ * @param networkDelayMs One-way network delay including the playout buffer in ms.
+ * @param lossPercent Packet loss in percent (network loss plus late packets).
+ * @return MOS in [1, 4.5].
+ */
+double
+EstimateMos(const SimulationParameters::VoipCodec& codec, double networkDelayMs, double lossPercent)
+{
+    double d = networkDelayMs + codec.packetSize * 8.0 / codec.bitrate + codec.lookaheadMs;
+    double id = 0.024 * d + (d > 177.3 ? 0.11 * (d - 177.3) : 0.0);
+    double ieEff = codec.ie + (95.0 - codec.ie) * lossPercent / (lossPercent + codec.bpl);
+    double r = 93.2 - id - ieEff;
+    if (r <= 0)
+    {
+        return 1.0;
+    }
+    if (r >= 100)
+    {
+        return 4.5;
+    }
+    return 1.0 + 0.035 * r + 7e-6 * r * (r - 60.0) * (100.0 - r);
+}
+
+/**
+ * @brief Runs fn(shard, begin, end) over the items [0, count) in shards on a thread pool.
+ *
+ * Workers take the next shard from an atomic counter, so uneven shards balance out. Callers
+ * keep one result per shard and reduce them in shard order, which makes the output
+ * independent of the number of threads.
+ * @param count Number of items.
+ * @param shardSize Items per shard.
+ * @param threads Worker threads (0 = all cores).
+ * @param fn Shard function, called concurrently for different shards.
+ */
+template <typename F>
+static void
+ParallelForShards(size_t count, size_t shardSize, uint32_t threads, F fn)
+{
+    shardSize = std::max<size_t>(1, shardSize);
+    size_t shards = (count + shardSize - 1) / shardSize;
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<uint32_t>(std::min<size_t>(threads, std::max<size_t>(1, shards)));
+
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t shard = next++; shard < shards; shard = next++)
+        {
+            fn(shard, shard * shardSize, std::min(count, (shard + 1) * shardSize));
+        }
+    };
+    std::vector<std::thread> pool;
+    for (uint32_t t = 1; t < threads; ++t)
+    {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool)
+    {
+        thread.join();
+    }
+}
+
+/**
+ * @brief Appends an unsigned value in little-endian byte order.
+ * @param out Output buffer.
+ * @param value Value to append.
+ * @param bytes Number of bytes (1 to 8).
+ */
+static void
+AppendLe(std::string& out, uint64_t value, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; ++i)
+    {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+/**
+ * @struct FlowShard
+ * @brief FlowMonitor totals and encoded output of one shard of flows.
+ */
+struct FlowShard
+{
+    uint64_t txPackets = 0;   ///< Packets sent
+    uint64_t rxPackets = 0;   ///< Packets received
+    uint64_t rxBytes = 0;     ///< Bytes received
+    uint64_t lostPackets = 0; ///< Packets declared lost by FlowMonitor
+    double delaySum = 0.0;    ///< Sum of delays in seconds
+    std::string output;       ///< Encoded binary records (binary format)
+    bool written = true;      ///< false if the shard's chunk file could not be written
+};
+
+/**
+ * @brief Writes the FlowMonitor results in the selected format.
+ *
+ * "xml" is FlowMonitor's own flowmon.xml with histograms and probes. "binary" and "csv" skip
+ * those and spread the per-flow work (five-tuple lookup, derived metrics, encoding) over
+ * analysisThreads threads in shards of flowMonitorChunk flows:
+ * - binary: flowmon.bin, header magic "KPMFLW01", uint32 headerSize (16), recordSize (96),
+ *   then per flow (little-endian) uint32 flowId, srcAddr, dstAddr, uint16 srcPort, dstPort,
+ *   uint8 protocol, 3 pad bytes, uint32 pad, uint64 txPackets, rxPackets, txBytes, rxBytes,
+ *   lostPackets, int64 delaySum, jitterSum, timeFirstTx, timeLastRx (ns);
+ * - csv: one flowmon-chunk-NNNN.csv per shard, written by the thread that built it.
+ * @param flowMonitor FlowMonitor.
+ * @param classifier Its IPv4 flow classifier.
+ * @param params Simulation parameters.
+ * @return false if an output file cannot be written.
+ */
+bool
+WriteFlowMonitorResults(Ptr<FlowMonitor> flowMonitor,
+                        Ptr<Ipv4FlowClassifier> classifier,
+                        const SimulationParameters& params)
+{
+    flowMonitor->CheckForLostPackets();
+    if (params.flowMonitorFormat == "xml")
+    {
+        flowMonitor->SerializeToXmlFile("flowmon.xml", true, true);
+        NS_LOG_INFO("FlowMonitor results stored in flowmon.xml.");
+        return true;
+    }
+
+    const FlowMonitor::FlowStatsContainer& stats = flowMonitor->GetFlowStats();
+    std::vector<const FlowMonitor::FlowStatsContainer::value_type*> flows;
+    flows.reserve(stats.size());
+    for (const auto& flow : stats)
+    {
+        flows.push_back(&flow);
+    }
+
+    static constexpr uint32_t RECORD_SIZE = 96;
+    const bool binary = (params.flowMonitorFormat == "binary");
+    const size_t chunk = std::max<uint32_t>(1, params.flowMonitorChunk);
+    std::vector<FlowShard> shards((flows.size() + chunk - 1) / chunk);
+    auto encodeShard = [&](size_t shard, size_t begin, size_t end) {
+        FlowShard& out = shards[shard];
+        std::ostringstream csv;
+        if (binary)
+        {
+            out.output.reserve((end - begin) * RECORD_SIZE);
+        }
+        else
+        {
+            csv << "FlowId,SrcAddr,SrcPort,DstAddr,DstPort,Protocol,TxPackets,RxPackets,TxBytes,"
+                   "RxBytes,LostPackets,Throughput(Kbps),Mean_Delay(ms),Mean_Jitter(ms),"
+                   "PacketLoss(%)\n";
+        }
+        for (size_t i = begin; i < end; ++i)
+        {
+            FlowId id = flows[i]->first;
+            const FlowMonitor::FlowStats& flow = flows[i]->second;
+            Ipv4FlowClassifier::FiveTuple tuple = classifier->FindFlow(id);
+            out.txPackets += flow.txPackets;
+            out.rxPackets += flow.rxPackets;
+            out.rxBytes += flow.rxBytes;
+            out.lostPackets += flow.lostPackets;
+            out.delaySum += flow.delaySum.GetSeconds();
+
+            if (binary)
+            {
+                AppendLe(out.output, id, 4);
+                AppendLe(out.output, tuple.sourceAddress.Get(), 4);
+                AppendLe(out.output, tuple.destinationAddress.Get(), 4);
+                AppendLe(out.output, tuple.sourcePort, 2);
+                AppendLe(out.output, tuple.destinationPort, 2);
+                AppendLe(out.output, tuple.protocol, 4);
+                AppendLe(out.output, 0, 4);
+                AppendLe(out.output, flow.txPackets, 8);
+                AppendLe(out.output, flow.rxPackets, 8);
+                AppendLe(out.output, flow.txBytes, 8);
+                AppendLe(out.output, flow.rxBytes, 8);
+                AppendLe(out.output, flow.lostPackets, 8);
+                AppendLe(out.output, flow.delaySum.GetNanoSeconds(), 8);
+                AppendLe(out.output, flow.jitterSum.GetNanoSeconds(), 8);
+                AppendLe(out.output, flow.timeFirstTxPacket.GetNanoSeconds(), 8);
+                AppendLe(out.output, flow.timeLastRxPacket.GetNanoSeconds(), 8);
+                continue;
+            }
+
+            double duration =
+                flow.timeLastRxPacket.GetSeconds() - flow.timeFirstTxPacket.GetSeconds();
+            double throughputKbps = (duration > 0) ? flow.rxBytes * 8.0 / 1000.0 / duration : 0.0;
+            double delayMs =
+                (flow.rxPackets > 0) ? flow.delaySum.GetSeconds() / flow.rxPackets * 1e3 : 0.0;
+            double jitterMs = (flow.rxPackets > 1)
+                                  ? flow.jitterSum.GetSeconds() / (flow.rxPackets - 1) * 1e3
+                                  : 0.0;
+            double lossPercent =
+                (flow.txPackets > 0) ? 100.0 * flow.lostPackets / flow.txPackets : 0.0;
+            csv << id << "," << tuple.sourceAddress << "," << tuple.sourcePort << ","
+                << tuple.destinationAddress << "," << tuple.destinationPort << ","
+                << (uint32_t)tuple.protocol << "," << flow.txPackets << "," << flow.rxPackets
+                << "," << flow.txBytes << "," << flow.rxBytes << "," << flow.lostPackets << ","
+                << throughputKbps << "," << delayMs << "," << jitterMs << "," << lossPercent
+                << "\n";
+        }
+        if (!binary)
+        {
+            char name[32];
+            std::snprintf(name, sizeof(name), "flowmon-chunk-%04zu.csv", shard);
+            std::ofstream file(name);
+            file << csv.str();
+            out.written = file.good();
+        }
+    };
+    ParallelForShards(flows.size(), chunk, params.analysisThreads, encodeShard);
+
+    // Reduce the shards in order
+    FlowShard total;
+    bool ok = true;
+    for (const auto& shard : shards)
+    {
+        total.txPackets += shard.txPackets;
+        total.rxPackets += shard.rxPackets;
+        total.rxBytes += shard.rxBytes;
+        total.lostPackets += shard.lostPackets;
+        total.delaySum += shard.delaySum;
+        ok = ok && shard.written;
+    }
+    if (binary)
+    {
+        std::ofstream file("flowmon.bin", std::ios::out | std::ios::trunc | std::ios::binary);
+        std::string header = "KPMFLW01";
+        AppendLe(header, 16, 4);
+        AppendLe(header, RECORD_SIZE, 4);
+        file.write(header.data(), header.size());
+        for (const auto& shard : shards)
+        {
+            file.write(shard.output.data(), shard.output.size());
+        }
+        ok = ok && file.good();
+    }
+    if (!ok)
+    {
+        NS_LOG_ERROR("Failed to write the FlowMonitor " << params.flowMonitorFormat << " output");
+        return false;
+    }
+
+    double meanDelayMs = (total.rxPackets > 0) ? total.delaySum / total.rxPackets * 1e3 : 0.0;
+    NS_LOG_INFO("FlowMonitor: " << flows.size() << " flows in " << shards.size() << " shards, "
+                                << total.rxPackets << "/" << total.txPackets
+                                << " packets received, " << total.lostPackets
+                                << " lost, mean delay " << meanDelayMs << " ms; stored in "
+                                << (binary ? "flowmon.bin" : "flowmon-chunk-*.csv"));
+    return true;
+}
+
+/**
+ * @brief Opens a Gnuplot script and writes its common preamble.
+ *
+ * The scripts plot columns of the streamed metrics CSV, so no sample data is copied into
+ * them; rerunning gnuplot on an edited script needs no rerun of the simulation.
+ * @param path Script file name; the PNG is named after it.
+ * @param title Plot title.
+ * @param ylabel Y axis label.
+ * @param out Receives the open script, positioned after "plot ".
+ * @return false if the file cannot be opened.
+ */
+static bool
+OpenPlotScript(const std::string& path,
+               const std::string& title,
+               const std::string& ylabel,
+               std::ofstream& out)
+{
+    out.open(path);
+    if (!out.is_open())
+    {
+        NS_LOG_ERROR("Failed to open " << path << " for writing.");
+        return false;
+    }
+    out << "set terminal png size 800,600\n";
+    out << "set output '" << std::filesystem::path(path).replace_extension(".png").string()
+        << "'\n";
+    out << "set title '" << title << "'\n";
+    out << "set xlabel 'Time (s)'\n";
+    out << "set ylabel '" << ylabel << "'\n";
+    out << "set key left top\n";
+    out << "set datafile separator ','\n";
+    out << "plot ";
+    return true;
+}
+
+/**
+ * @brief Computes the final metrics from the KPI collector and generates reports.
+ *
+ * One pass over the UEs produces the aggregates, final_ue_metrics.csv and the per-UE
+ * clauses of the throughput plot; the Gnuplot scripts reference the streamed metrics CSV
+ * instead of carrying the samples. Besides the means, p95/p99 latency and jitter come from
+ * the collector's histograms, per UE and merged across UEs. The MOS assumes a playout
+ * buffer sized to the p99 delay: its delay counts in full and the 1% of packets arriving
+ * later count as lost. With --enableReport=0 (the sweep default) only the FlowMonitor
+ * results are written.
+ * @param flowMonitor Optional FlowMonitor (nullptr when disabled), see WriteFlowMonitorResults.
+ * @param classifier IPv4 flow classifier of the FlowMonitor.
+ * @param params Simulation parameters.
+ */
+void
+AnalyzeData(Ptr<FlowMonitor> flowMonitor,
+            Ptr<Ipv4FlowClassifier> classifier,
+            const SimulationParameters& params)
+{
+    // FlowMonitor results
+    if (flowMonitor)
+    {
+        WriteFlowMonitorResults(flowMonitor, classifier, params);
+    }
+
+    NS_LOG_INFO("Simulation metrics streamed to simulation_metrics."
+                << (g_metricsWriter.GetFormat() == MetricsStreamWriter::BINARY ? "bin" : "csv")
+                << " (" << g_metricsWriter.GetSampleCount() << " samples).");
+    if (!params.enableReport)
+    {
+        return;
+    }
+
+    std::ofstream ueFile("final_ue_metrics.csv");
+    if (!ueFile.is_open())
+    {
+        NS_LOG_ERROR("Failed to open final_ue_metrics.csv for writing.");
+        return;
+    }
+    ueFile << "UE,TxPackets,RxPackets,Avg_Latency(ms),P95_Latency(ms),P99_Latency(ms),"
+              "Jitter(ms),P95_Jitter(ms),P99_Jitter(ms),PacketLoss(%),MOS,DL_TxPackets,"
+              "DL_RxPackets,DL_Avg_Latency(ms),DL_PacketLoss(%)\n";
+
+    // Gnuplot scripts read their data from the streamed metrics CSV (header row skipped)
+    const std::string dataSource = "'simulation_metrics.csv' every ::1 using 1:";
+    const bool plots = (g_metricsWriter.GetFormat() == MetricsStreamWriter::CSV);
+    std::ofstream throughputPlot;
+    if (!plots)
+    {
+        NS_LOG_INFO("Binary metrics selected; Gnuplot scripts (which read the CSV) skipped.");
+    }
+    else if (!OpenPlotScript("ue-throughput-time-plot.plt",
+                             "Per-UE Throughput Over Time",
+                             "Throughput (Kbps)",
+                             throughputPlot))
+    {
+        return;
+    }
+
+    const VoipKpiCounters& kpi = g_voipKpi;
+    double totalThroughputSum = 0.0;
+    double totalDelaySum = 0.0;
+    double totalJitterSum = 0.0;
+    uint64_t totalRxPackets = 0;
+    uint64_t totalTxPackets = 0;
+    uint32_t flowCount = 0;
+    uint32_t jitterFlowCount = 0;
+    double mosSum = 0.0;
+    uint64_t dlTxPackets = 0;
+    uint64_t dlRxPackets = 0;
+    double dlDelaySum = 0.0;
+    std::vector<uint32_t> allDelayBins(LogHistogram::BINS, 0);
+    std::vector<uint32_t> allJitterBins(LogHistogram::BINS, 0);
 
-                // Connect Handover Failure
-                enbRrc->TraceConnectWithoutContext("HandoverFailure",
-                                                   MakeCallback(&HandoverFailureCallback));
+    for (uint32_t ueIndex = 0; ueIndex < params.numUe; ueIndex++)
+    {
+        const uint32_t* delayBins = &kpi.delayBins[size_t(ueIndex) * LogHistogram::BINS];
+        const uint32_t* jitterBins = &kpi.jitterBins[size_t(ueIndex) * LogHistogram::BINS];
+        for (uint32_t bin = 0; bin < LogHistogram::BINS; ++bin)
+        {
+            allDelayBins[bin] += delayBins[bin];
+            allJitterBins[bin] += jitterBins[bin];
+        }
+
+        uint64_t tx = kpi.txPackets[ueIndex];
+        uint64_t rx = kpi.rxPackets[ueIndex];
+        if (tx > 0 || rx > 0) // UE carried traffic
+        {
+            flowCount++;
+            double duration = kpi.lastRxTime[ueIndex] - kpi.firstTxTime[ueIndex];
+            if (duration > 0)
+            {
+                totalThroughputSum += (kpi.rxBytes[ueIndex] * 8.0) / 1000.0 / duration;
             }
-            else
+            totalDelaySum += kpi.delaySum[ueIndex];
+            totalRxPackets += rx;
+            totalTxPackets += tx;
+            if (rx > 1)
             {
-                NS_LOG_WARN("eNodeB RRC not found for device " << i);
+                totalJitterSum += kpi.jitter[ueIndex];
+                jitterFlowCount++;
             }
         }
-        else
+
+        double lossPercent = (tx > 0) ? (double)(tx - std::min(rx, tx)) / tx * 100.0 : 0.0;
+        double avgDelayMs = (rx > 0) ? kpi.delaySum[ueIndex] / rx * 1e3 : 0.0;
+        double p95DelayMs = LogHistogram::Quantile(delayBins, 0.95) * 1e3;
+        double p99DelayMs = LogHistogram::Quantile(delayBins, 0.99) * 1e3;
+        double p95JitMs = LogHistogram::Quantile(jitterBins, 0.95) * 1e3;
+        double p99JitMs = LogHistogram::Quantile(jitterBins, 0.99) * 1e3;
+        double mos = EstimateMos(params.codec, p99DelayMs, std::min(100.0, lossPercent + 1.0));
+        mosSum += mos;
+
+        uint64_t dlTx = kpi.dlTxPackets[ueIndex];
+        uint64_t dlRx = kpi.dlRxPackets[ueIndex];
+        dlTxPackets += dlTx;
+        dlRxPackets += dlRx;
+        dlDelaySum += kpi.dlDelaySum[ueIndex];
+        double dlLossPercent =
+            (dlTx > 0) ? (double)(dlTx - std::min(dlRx, dlTx)) / dlTx * 100.0 : 0.0;
+        double dlDelayMs = (dlRx > 0) ? kpi.dlDelaySum[ueIndex] / dlRx * 1e3 : 0.0;
+
+        ueFile << ueIndex << "," << tx << "," << rx << "," << avgDelayMs << "," << p95DelayMs
+               << "," << p99DelayMs << "," << kpi.jitter[ueIndex] * 1e3 << "," << p95JitMs << ","
+               << p99JitMs << "," << lossPercent << "," << mos << "," << dlTx << "," << dlRx
+               << "," << dlDelayMs << "," << dlLossPercent << "\n";
+
+        if (plots)
         {
-            NS_LOG_WARN("eNodeB NetDevice not found for device " << i);
+            throughputPlot << (ueIndex > 0 ? ", " : "") << dataSource
+                           << MetricsStreamWriter::UeThroughputColumn(ueIndex)
+                           << " with linespoints title 'UE-" << ueIndex << "'";
         }
     }
+    ueFile.close();
 
-    // Initialize NetAnim
-    AnimationInterface* anim = nullptr;
-    if (params.enableNetAnim)
+    if (plots)
     {
-        anim = new AnimationInterface("animation.xml");
-        anim->SetMaxPktsPerTraceFile(5000000);
+        throughputPlot << "\n";
+        throughputPlot.close();
+        NS_LOG_INFO("UE Throughput Gnuplot script: ue-throughput-time-plot.plt");
 
-        // Configure eNodeBs in NetAnim
-        for (uint32_t i = 0; i < enbNodes.GetN(); ++i)
+        std::ofstream latencyPlot;
+        if (OpenPlotScript("latency-time-plot.plt",
+                           "Aggregate Latency Over Time",
+                           "Latency (ms)",
+                           latencyPlot))
         {
-            Ptr<Node> enbNode = enbNodes.Get(i);
-            Vector pos = enbNode->GetObject<MobilityModel>()->GetPosition();
-            anim->UpdateNodeDescription(enbNode, "eNodeB_" + std::to_string(i));
-            anim->UpdateNodeColor(enbNode, 0, 0, 255); // Blue
-            anim->SetConstantPosition(enbNode, pos.x, pos.y);
+            latencyPlot << dataSource << MetricsStreamWriter::AvgLatencyColumn(params.numUe)
+                        << " with linespoints title 'Avg Latency'\n";
+            NS_LOG_INFO("Latency Gnuplot script: latency-time-plot.plt");
         }
 
-        // Configure UEs in NetAnim
-        for (uint32_t i = 0; i < ueNodes.GetN(); ++i)
+        std::ofstream avgPlot;
+        if (OpenPlotScript("avg-throughput-time-plot.plt",
+                           "Average Throughput Over Time",
+                           "Average Throughput (Kbps)",
+                           avgPlot))
         {
-            Ptr<Node> ueNode = ueNodes.Get(i);
-            Vector pos = ueNode->GetObject<MobilityModel>()->GetPosition();
-            anim->UpdateNodeDescription(ueNode, "UE_" + std::to_string(i));
-            anim->UpdateNodeColor(ueNode, 0, 255, 0); // Green
-            anim->SetConstantPosition(ueNode, pos.x, pos.y);
+            avgPlot << dataSource << "2 with linespoints title 'Avg Throughput'\n";
+            NS_LOG_INFO("Average Throughput Gnuplot script: avg-throughput-time-plot.plt");
         }
-
-        // Configure Remote Host in NetAnim
-        anim->UpdateNodeDescription(remoteHostContainer.Get(0), "RemoteHost");
-        anim->UpdateNodeColor(remoteHostContainer.Get(0), 255, 0, 0); // Red
     }
 
-    // Schedule Periodic Logging of Node Positions (for Debugging)
-    Simulator::Schedule(Seconds(1.0), &LogAllNodePositions);
-
-    // Schedule Periodic Statistics Updates
-    Simulator::Schedule(Seconds(params.statsInterval),
-                        &PeriodicStatsUpdate,
-                        flowMonitor,
-                        std::ref(flowHelper),
-                        params);
-
-    // Run Simulation
-    Simulator::Stop(Seconds(params.simTime));
-    Simulator::Run();
-
-    // Finalize logging
-    handoverLogFile.close();
-
-    // Final Analysis of Flow Monitor Data
-    AnalyzeData(flowHelper, flowMonitor, params, remoteHostAddr, ueAddresses);
+    double overallAvgLatencyMs =
+        (totalRxPackets > 0) ? (totalDelaySum / (double)totalRxPackets) * 1000.0 : 0.0;
+    double overallAvgThroughput = (flowCount > 0) ? (totalThroughputSum / (double)flowCount) : 0.0;
+    double packetLossRate = 0.0;
+    if (totalTxPackets > 0)
+    {
+        uint64_t lostPackets = totalTxPackets - std::min(totalRxPackets, totalTxPackets);
+        packetLossRate = (double)lostPackets / (double)totalTxPackets * 100.0;
+    }
+    double overallAvgJitterMs =
+        (jitterFlowCount > 0) ? (totalJitterSum / jitterFlowCount) * 1000.0 : 0.0;
+    double p95LatencyMs = LogHistogram::Quantile(allDelayBins.data(), 0.95) * 1e3;
+    double p99LatencyMs = LogHistogram::Quantile(allDelayBins.data(), 0.99) * 1e3;
+    double p95JitterMs = LogHistogram::Quantile(allJitterBins.data(), 0.95) * 1e3;
+    double p99JitterMs = LogHistogram::Quantile(allJitterBins.data(), 0.99) * 1e3;
+    double avgMos = (params.numUe > 0) ? mosSum / params.numUe : 0.0;
 
-    // Clean Up
-    Simulator::Destroy();
-    NS_LOG_INFO("LTE simulation finished!");
-    return 0;
+    // Final Metrics Logging
+    NS_LOG_INFO("===== FINAL METRICS =====");
+    NS_LOG_INFO("Avg Throughput (Kbps) : " << overallAvgThroughput);
+    NS_LOG_INFO("Avg Latency (ms)     : " << overallAvgLatencyMs);
+    NS_LOG_INFO("Packet Loss (%)      : " << packetLossRate);
+    NS_LOG_INFO("Avg Jitter (ms)      : " << overallAvgJitterMs);
+    NS_LOG_INFO("P95/P99 Latency (ms) : " << p95LatencyMs << " / " << p99LatencyMs);
+    NS_LOG_INFO("P95/P99 Jitter (ms)  : " << p95JitterMs << " / " << p99JitterMs);
+    NS_LOG_INFO("Avg MOS (E-model)    : " << avgMos << " (" << params.codec.name << ")");
+    if (params.voipBidirectional)
+    {
+        double dlLoss =
+            (dlTxPackets > 0)
+                ? (double)(dlTxPackets - std::min(dlRxPackets, dlTxPackets)) / dlTxPackets * 100.0
+                : 0.0;
+        NS_LOG_INFO("DL Latency (ms)      : " << (dlRxPackets > 0 ? dlDelaySum / dlRxPackets * 1e3
+                                                                  : 0.0));
+        NS_LOG_INFO("DL Packet Loss (%)   : " << dlLoss);
+    }
+    NS_LOG_INFO("Per-UE metrics stored in final_ue_metrics.csv.");
 }
 
-// ============================================================================
 /**
- * @brief Configures the logging levels for various components.
+ * @brief Splits a comma-separated list, keeping empty items so CSV columns stay aligned.
+ * @param list Comma-separated string.
+ * @return Vector of list items; empty only if @p list is empty.
  */
-void
-ConfigureLogging()
+static std::vector<std::string>
+SplitList(const std::string& list)
 {
-    LogComponentEnable("VoipLteSimulation", LOG_LEVEL_INFO);
-    LogComponentEnable("LteEnbRrc", LOG_LEVEL_INFO);
-    LogComponentEnable("LteUeRrc", LOG_LEVEL_INFO);
-    // Uncomment to enable more detailed logging
-    // LogComponentEnable("OnOffApplication", LOG_LEVEL_INFO);
-    // LogComponentEnable("PacketSink", LOG_LEVEL_INFO);
+    std::vector<std::string> items;
+    if (list.empty())
+    {
+        return items;
+    }
+    size_t start = 0;
+    while (true)
+    {
+        size_t comma = list.find(',', start);
+        items.push_back(list.substr(start, comma - start));
+        if (comma == std::string::npos)
+        {
+            break;
+        }
+        start = comma + 1;
+    }
+    return items;
 }
 
 /**
- * @brief Configures the mobility model for eNodeBs, placing them strategically based on the number
- *        of eNodeBs.
- *        - If 4 eNodeBs: Position them at 1/4 offset from the center in cardinal directions.
- *        - If 2 eNodeBs: Align them centrally along the Y-axis at 1/4 and 3/4 of the X-axis.
- * @param enbNodes Container of eNodeB nodes.
- * @param areaSize Size of the simulation area.
+ * @brief Parses a whole string as a decimal unsigned integer.
+ * @param text Input string; signs, whitespace and trailing characters are rejected.
+ * @param value Parsed value, set on success.
+ * @return True if @p text is a valid number that fits in 64 bits.
  */
-void
-ConfigureEnbMobility(NodeContainer& enbNodes, double areaSize)
+static bool
+ParseUnsigned(const std::string& text, uint64_t& value)
 {
-    MobilityHelper enbMobility;
-    Ptr<ListPositionAllocator> posAlloc = CreateObject<ListPositionAllocator>();
-
-    if (enbNodes.GetN() == 4)
-    {
-        // Four eNodeBs: Positioned 1/4 from the center in cardinal directions
-        posAlloc->Add(Vector(areaSize / 2 - areaSize / 4, areaSize / 2, 30.0)); // Left
-        posAlloc->Add(Vector(areaSize / 2 + areaSize / 4, areaSize / 2, 30.0)); // Right
-        posAlloc->Add(Vector(areaSize / 2, areaSize / 2 - areaSize / 4, 30.0)); // Bottom
-        posAlloc->Add(Vector(areaSize / 2, areaSize / 2 + areaSize / 4, 30.0)); // Top
-    }
-    else if (enbNodes.GetN() == 2)
+    if (text.empty() || !std::isdigit(static_cast<unsigned char>(text[0])))
     {
-        // Two eNodeBs: Positioned at (areaSize/4, areaSize/2) and (3*areaSize/4, areaSize/2)
-        posAlloc->Add(Vector(areaSize / 4, areaSize / 2, 30.0));     // Center-left
-        posAlloc->Add(Vector(3 * areaSize / 4, areaSize / 2, 30.0)); // Center-right
+        return false;
     }
-    else
+    errno = 0;
+    char* end = nullptr;
+    unsigned long long parsed = std::strtoull(text.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0')
     {
-        NS_LOG_WARN("Unsupported number of eNodeBs: " << enbNodes.GetN());
-        // Place all eNodeBs at the center if unsupported number
-        for (uint32_t i = 0; i < enbNodes.GetN(); ++i)
-        {
-            posAlloc->Add(Vector(areaSize / 2, areaSize / 2, 30.0));
-        }
+        return false;
     }
-
-    enbMobility.SetPositionAllocator(posAlloc);
-    enbMobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
-    enbMobility.Install(enbNodes);
+    value = parsed;
+    return true;
 }
 
 /**
- * @brief Configures the mobility model for UEs based on the selected mobility mode.
- * @param ueNodes Container of UE nodes.
- * @param areaSize Size of the simulation area.
- * @param enbNodes Container of eNodeB nodes.
- * @param mobilityMode Selected mobility mode.
- * @param params Simulation parameters including path loss distances.
+ * @brief Trims leading and trailing whitespace.
+ * @param text Input string.
+ * @return Trimmed copy.
  */
-void
-ConfigureUeMobility(NodeContainer& ueNodes,
-                    double areaSize,
-                    NodeContainer& enbNodes,
-                    SimulationParameters::MobilityMode mobilityMode,
-                    const SimulationParameters& params)
+static std::string
+TrimSpace(const std::string& text)
 {
-    switch (mobilityMode)
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos)
     {
-    case SimulationParameters::RANDOM_WAYPOINT: {
-        MobilityHelper ueMobility;
-        Ptr<RandomRectanglePositionAllocator> positionAlloc =
-            CreateObject<RandomRectanglePositionAllocator>();
-
-        std::ostringstream xBound, yBound;
-        xBound << "ns3::UniformRandomVariable[Min=0.0|Max=" << areaSize << "]";
-        yBound << "ns3::UniformRandomVariable[Min=0.0|Max=" << areaSize << "]";
-        positionAlloc->SetAttribute("X", StringValue(xBound.str()));
-        positionAlloc->SetAttribute("Y", StringValue(yBound.str()));
-
-        ueMobility.SetPositionAllocator(positionAlloc);
-        ueMobility.SetMobilityModel("ns3::RandomWaypointMobilityModel",
-                                    "Speed",
-                                    StringValue("ns3::UniformRandomVariable[Min=10.0|Max=30.0]"),
-                                    "Pause",
-                                    StringValue("ns3::ConstantRandomVariable[Constant=2.0]"),
-                                    "PositionAllocator",
-                                    PointerValue(positionAlloc));
-        ueMobility.Install(ueNodes);
-        NS_LOG_INFO("Configured UEs with RandomWaypoint Mobility Model.");
-        break;
+        return "";
     }
-    case SimulationParameters::CONSTANT_UNDER_DISTANCE0:
-    case SimulationParameters::CONSTANT_UNDER_DISTANCE1:
-    case SimulationParameters::CONSTANT_ABOVE_DISTANCE1: {
-        // Constant Position Mobility Model with random placement based on distance
-        MobilityHelper ueMobility;
-        ueMobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
-        ueMobility.Install(ueNodes);
-
-        // Random number generators for position offsets
-        std::default_random_engine generator;
-        std::uniform_real_distribution<double> angleDist(0.0, 2 * M_PI);
-        std::uniform_real_distribution<double> distanceDist;
+    size_t end = text.find_last_not_of(" \t\r\n");
+    return text.substr(begin, end - begin + 1);
+}
 
-        // Define distance range based on mobility mode
-        double minDist = 0.0;
-        double maxDist = 0.0;
-        if (mobilityMode == SimulationParameters::CONSTANT_UNDER_DISTANCE0)
+/**
+ * @brief Parses a flat JSON object of string, number and boolean members.
+ * @param text JSON text.
+ * @param args Receives one "--name=value" argument per member.
+ * @return false on malformed input or nested objects and arrays.
+ */
+static bool
+ParseFlatJson(const std::string& text, std::vector<std::string>& args)
+{
+    size_t pos = 0;
+    auto skipSpace = [&]() {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos])))
         {
-            minDist = 0.0;
-            maxDist = params.distance0;
+            pos++;
         }
-        else if (mobilityMode == SimulationParameters::CONSTANT_UNDER_DISTANCE1)
+    };
+    auto readString = [&](std::string& out) {
+        if (pos >= text.size() || text[pos] != '"')
         {
-            minDist = (params.distance1 / 2.0) - 10.0;
-            maxDist = (params.distance1 / 2.0) + 10.0;
+            return false;
         }
-        else if (mobilityMode == SimulationParameters::CONSTANT_ABOVE_DISTANCE1)
+        out.clear();
+        for (pos++; pos < text.size() && text[pos] != '"'; pos++)
         {
-            minDist = params.distance1;
-            maxDist = params.areaSize / 2.0; // Assuming maximum possible distance from center
+            if (text[pos] == '\\' && pos + 1 < text.size())
+            {
+                pos++;
+                out += (text[pos] == 'n') ? '\n' : (text[pos] == 't') ? '\t' : text[pos];
+            }
+            else
+            {
+                out += text[pos];
+            }
         }
+        return pos++ < text.size();
+    };
 
-        // Set distance distribution based on mobility mode
-        if (mobilityMode == SimulationParameters::CONSTANT_ABOVE_DISTANCE1)
+    skipSpace();
+    if (pos >= text.size() || text[pos++] != '{')
+    {
+        return false;
+    }
+    skipSpace();
+    bool closed = (pos < text.size() && text[pos] == '}');
+    if (closed)
+    {
+        pos++;
+    }
+    while (!closed)
+    {
+        std::string name;
+        std::string value;
+        skipSpace();
+        if (!readString(name))
         {
-            distanceDist =
-                std::uniform_real_distribution<double>(params.distance1, params.areaSize / 2.0);
+            return false;
         }
-        else
+        skipSpace();
+        if (pos >= text.size() || text[pos++] != ':')
         {
-            distanceDist = std::uniform_real_distribution<double>(minDist, maxDist);
+            return false;
         }
-
-        for (uint32_t i = 0; i < ueNodes.GetN(); ++i)
+        skipSpace();
+        if (pos < text.size() && text[pos] == '"')
         {
-            Ptr<Node> ue = ueNodes.Get(i);
-            Ptr<MobilityModel> ueMob = ue->GetObject<MobilityModel>();
-            if (!ueMob)
+            if (!readString(value))
             {
-                NS_LOG_WARN("UE " << i << " has no MobilityModel!");
-                continue;
+                return false;
             }
-
-            // Generate random distance and angle
-            double distance = distanceDist(generator);
-            double angle = angleDist(generator);
-
-            // Calculate UE position relative to the center of the simulation area
-            double centerX = params.areaSize / 2.0;
-            double centerY = params.areaSize / 2.0;
-            double ueX = centerX + distance * cos(angle);
-            double ueY = centerY + distance * sin(angle);
-
-            // Ensure UE is within the simulation area
-            ueX = std::max(0.0, std::min(ueX, params.areaSize));
-            ueY = std::max(0.0, std::min(ueY, params.areaSize));
-
-            // Set the calculated position
-            ueMob->SetPosition(Vector(ueX, ueY, 0.0));
-
-            NS_LOG_INFO("UE " << i << " positioned at (" << ueX << ", " << ueY << ", 0.0)");
         }
+        else
+        {
+            size_t end = text.find_first_of(",} \t\r\n", pos);
+            value = text.substr(pos, end == std::string::npos ? end : end - pos);
+            if (value.empty() || value == "null" || value[0] == '{' || value[0] == '[')
+            {
+                return false;
+            }
+            pos += value.size();
+        }
+        args.push_back("--" + name + "=" + value);
 
-        NS_LOG_INFO("Configured UEs with Constant Position Mobility Model.");
-        break;
-    }
-    default:
-        NS_LOG_ERROR("Misconfigured, stop simulation.");
-        exit(1);
+        skipSpace();
+        if (pos >= text.size() || (text[pos] != ',' && text[pos] != '}'))
+        {
+            return false;
+        }
+        closed = (text[pos++] == '}');
     }
+    skipSpace();
+    return pos == text.size();
 }
 
 /**
- * @brief Creates a remote host connected to the PGW via a Point-to-Point link.
- * @param epcHelper EPC helper.
- * @param remoteHostContainer Container holding the remote host node.
- * @param areaSize Size of the simulation area.
- * @return Ipv4Address of the remote host.
- */
-Ipv4Address
-CreateRemoteHost(Ptr<PointToPointEpcHelper> epcHelper,
-                 NodeContainer& remoteHostContainer,
-                 double areaSize)
-{
-    Ptr<Node> pgw = epcHelper->GetPgwNode();
-    PointToPointHelper p2p;
-    p2p.SetDeviceAttribute("DataRate", StringValue("1Gbps"));
-    p2p.SetChannelAttribute("Delay", StringValue("10ms"));
-
-    NetDeviceContainer devices = p2p.Install(pgw, remoteHostContainer.Get(0));
-    Ipv4AddressHelper ipv4;
-    ipv4.SetBase("1.0.0.0", "255.255.255.0");
-    Ipv4InterfaceContainer interfaces = ipv4.Assign(devices);
-
-    // Enable PCAP tracing
-    p2p.EnablePcap("pgw-p2p", devices.Get(0), true);
-    p2p.EnablePcap("remote-host-p2p", devices.Get(1), true);
-
-    NS_LOG_INFO("Remote Host IP Address: " << interfaces.GetAddress(1));
-
-    return interfaces.GetAddress(1); // Remote Host IP
-}
-
-/**
- * @brief Installs VoIP applications on UEs and the remote host.
- * @param ueNodes Container of UE nodes.
- * @param remoteAddr IP address of the remote host.
- * @param simTime Total simulation time.
- * @param remoteHostContainer Container holding the remote host node.
- * @param params Simulation parameters including VoIP codec configurations.
+ * @brief Reads a config file into "--name=value" arguments for CommandLine.
+ *
+ * Names are the command-line option names, including ns-3 attribute paths such as
+ * "ns3::LteEnbRrc::SrsPeriodicity". Two formats are accepted: INI, one "name = value" per
+ * line with '#' or ';' comments and [section] headers ignored, and a flat JSON object of
+ * strings, numbers and booleans (".json" extension or a leading '{').
+ * @param path Config file.
+ * @param args Receives the arguments, in file order.
+ * @return false if the file cannot be read or is malformed.
  */
-void
-InstallVoipApplications(NodeContainer& ueNodes,
-                        Ipv4Address remoteAddr,
-                        double simTime,
-                        NodeContainer& remoteHostContainer,
-                        const SimulationParameters& params)
+bool
+LoadConfigFile(const std::string& path, std::vector<std::string>& args)
 {
-    uint16_t basePort = 5000;
-
-    for (uint32_t i = 0; i < ueNodes.GetN(); ++i)
+    std::ifstream in(path);
+    if (!in)
     {
-        uint16_t port = basePort + i;
-
-        // Configure OnOff application to simulate VoIP traffic
-        OnOffHelper onOff("ns3::UdpSocketFactory", InetSocketAddress(remoteAddr, port));
-        onOff.SetAttribute("DataRate", DataRateValue(DataRate(params.codec.bitrate * 1000)));
-        onOff.SetAttribute("PacketSize", UintegerValue(params.codec.packetSize));
-        onOff.SetAttribute("OnTime", StringValue("ns3::ConstantRandomVariable[Constant=1]"));
-        onOff.SetAttribute("OffTime", StringValue("ns3::ConstantRandomVariable[Constant=0]"));
-
-        // Install OnOff application on UE
-        ApplicationContainer apps = onOff.Install(ueNodes.Get(i));
-        apps.Start(Seconds(1.0));
-        apps.Stop(Seconds(simTime));
+        NS_LOG_ERROR("Failed to open config file " << path);
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    std::string text = buffer.str();
 
-        // Install PacketSink on Remote Host
-        PacketSinkHelper sinkHelper("ns3::UdpSocketFactory",
-                                    InetSocketAddress(Ipv4Address::GetAny(), port));
-        ApplicationContainer sinkApps = sinkHelper.Install(remoteHostContainer.Get(0));
-        sinkApps.Start(Seconds(0.5));
-        sinkApps.Stop(Seconds(simTime));
+    std::string trimmed = TrimSpace(text);
+    if (std::filesystem::path(path).extension() == ".json" ||
+        (!trimmed.empty() && trimmed[0] == '{'))
+    {
+        if (!ParseFlatJson(text, args))
+        {
+            NS_LOG_ERROR("Config file " << path << " is not a flat JSON object");
+            return false;
+        }
+        return true;
+    }
 
-        NS_LOG_INFO("Installed VoIP application on UE " << i << " with port " << port);
+    std::istringstream lines(text);
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(lines, line))
+    {
+        lineNumber++;
+        line = TrimSpace(line.substr(0, line.find_first_of("#;")));
+        if (line.empty() || line[0] == '[')
+        {
+            continue;
+        }
+        size_t eq = line.find('=');
+        std::string name = (eq == std::string::npos) ? "" : TrimSpace(line.substr(0, eq));
+        if (name.empty())
+        {
+            NS_LOG_ERROR(path << ":" << lineNumber << ": expected name = value");
+            return false;
+        }
+        std::string value = TrimSpace(line.substr(eq + 1));
+        if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+        {
+            value = value.substr(1, value.size() - 2);
+        }
+        args.push_back("--" + name + "=" + value);
     }
+    return true;
 }
 
 /**
- * @brief Sets up FlowMonitor to track flow statistics.
- * @param flowHelper FlowMonitorHelper instance.
- * @return Pointer to the installed FlowMonitor.
+ * @brief Finds the value of the last "--name=value" argument.
+ * @param args Arguments.
+ * @param name Option name.
+ * @return The value, or an empty string if the option is absent.
  */
-Ptr<FlowMonitor>
-SetupFlowMonitor(FlowMonitorHelper& flowHelper)
+static std::string
+FindArgument(const std::vector<std::string>& args, const std::string& name)
 {
-    Ptr<FlowMonitor> flowMonitor = flowHelper.InstallAll();
-    NS_LOG_INFO("FlowMonitor installed.");
-    return flowMonitor;
+    std::string prefix = "--" + name + "=";
+    std::string value;
+    for (const auto& arg : args)
+    {
+        if (arg.rfind(prefix, 0) == 0)
+        {
+            value = arg.substr(prefix.size());
+        }
+    }
+    return value;
 }
 
 /**
- * @brief Enables LTE tracing for PHY, MAC, RLC, and PDCP layers.
- * @param lteHelper LTE helper instance.
+ * @brief Loads or saves ns-3 attribute values through ConfigStore.
+ *
+ * Files ending in ".xml" use the XML format (ns-3 built with libxml2), others RawText.
+ * @param path ConfigStore file.
+ * @param mode "Load" or "Save".
+ * @param defaults Apply or save the attribute defaults.
+ * @param attributes Apply or save the attributes of the objects created so far.
  */
-void
-EnableLteTraces(Ptr<LteHelper> lteHelper)
+static void
+RunConfigStore(const std::string& path, const std::string& mode, bool defaults, bool attributes)
 {
-    lteHelper->EnablePhyTraces();
-    lteHelper->EnableMacTraces();
-    lteHelper->EnableRlcTraces();
-    lteHelper->EnablePdcpTraces();
-    NS_LOG_INFO("Enabled LTE Traces.");
+    bool xml = (std::filesystem::path(path).extension() == ".xml");
+    Config::SetDefault("ns3::ConfigStore::Filename", StringValue(path));
+    Config::SetDefault("ns3::ConfigStore::FileFormat", StringValue(xml ? "Xml" : "RawText"));
+    Config::SetDefault("ns3::ConfigStore::Mode", StringValue(mode));
+    ConfigStore store;
+    if (defaults)
+    {
+        store.ConfigureDefaults();
+    }
+    if (attributes)
+    {
+        store.ConfigureAttributes();
+    }
 }
 
 /**
- * @brief Periodically updates and logs network statistics.
- * @param flowMonitor FlowMonitor instance.
- * @param flowHelper FlowMonitorHelper instance.
- * @param params Simulation parameters.
+ * @brief Expands a list of RngRun values where items may be inclusive ranges ("1-10").
+ * @param list Comma-separated run list.
+ * @param runs Vector the run numbers are appended to.
+ * @return False (with an error logged) on an empty item, a malformed number or a
+ *         descending range.
  */
-void
-PeriodicStatsUpdate(Ptr<FlowMonitor> flowMonitor,
-                    FlowMonitorHelper& flowHelper,
-                    const SimulationParameters& params)
+static bool
+ExpandRunList(const std::string& list, std::vector<uint64_t>& runs)
 {
-    g_currentTime += params.statsInterval;
-    flowMonitor->CheckForLostPackets();
-
-    auto stats = flowMonitor->GetFlowStats();
-    Ptr<Ipv4FlowClassifier> classifier =
-        DynamicCast<Ipv4FlowClassifier>(flowHelper.GetClassifier());
-
-    // Log handover counts
-    g_handoverStartPlot.push_back(g_handoverStartCount);
-    g_handoverSuccessPlot.push_back(g_handoverSuccessCount);
-    g_handoverFailurePlot.push_back(g_handoverFailureCount);
-
-    // Reset counters for the next interval
-    g_handoverStartCount = 0;
-    g_handoverSuccessCount = 0;
-    g_handoverFailureCount = 0;
-
-    // Initialize per-UE metrics
-    std::vector<double> ueThroughputKbps(params.numUe, 0.0);
-    std::vector<double> uePacketLossRate(params.numUe, 0.0);
-    std::vector<double> ueJitterMs(params.numUe, 0.0);
-
-    double totalLatencySum = 0.0;
-    uint64_t totalRxPackets = 0;
-
-    // Process each flow
-    for (auto& iter : stats)
+    for (const auto& item : SplitList(list))
     {
-        Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow(iter.first);
-
-        // Consider only UDP flows (VoIP)
-        if (t.protocol != 17)
-            continue;
-
-        // Identify the UE based on destination port
-        uint16_t destPort = t.destinationPort;
-        if (destPort >= 5000 && destPort < (5000 + params.numUe))
+        size_t dash = item.find('-');
+        uint64_t first = 0;
+        uint64_t last = 0;
+        if (!ParseUnsigned(item.substr(0, dash), first) ||
+            !ParseUnsigned(dash == std::string::npos ? item : item.substr(dash + 1), last))
         {
-            uint32_t ueIndex = destPort - 5000;
-
-            // Calculate throughput
-            uint64_t currentRxBytes = iter.second.rxBytes;
-            uint64_t deltaBytes = currentRxBytes - g_previousRxBytes[iter.first];
-            g_previousRxBytes[iter.first] = currentRxBytes;
-
-            double flowThroughputKbps = (deltaBytes * 8.0) / 1000.0 / params.statsInterval;
-            ueThroughputKbps[ueIndex] += flowThroughputKbps;
-
-            // Calculate packet loss rate
-            uint64_t txPkts = iter.second.txPackets;
-            uint64_t rxPkts = iter.second.rxPackets;
-            double lossRate =
-                (txPkts > 0) ? (double)(txPkts - rxPkts) / (double)txPkts * 100.0 : 0.0;
-            uePacketLossRate[ueIndex] = lossRate;
-
-            // Calculate latency
-            uint64_t currentRxPackets = iter.second.rxPackets;
-            uint64_t deltaPackets = currentRxPackets - g_previousRxPackets[iter.first];
-            g_previousRxPackets[iter.first] = currentRxPackets;
-
-            Time currentDelaySum = iter.second.delaySum;
-            Time deltaDelaySum = currentDelaySum - g_previousDelaySum[iter.first];
-            g_previousDelaySum[iter.first] = currentDelaySum;
-
-            if (deltaPackets > 0)
-            {
-                double avgFlowLatencyMs =
-                    (deltaDelaySum.GetSeconds() / (double)deltaPackets) * 1000.0;
-                totalLatencySum += (avgFlowLatencyMs * deltaPackets);
-                totalRxPackets += deltaPackets;
-            }
-
-            // Calculate jitter
-            Time currentJitterSum = iter.second.jitterSum;
-            Time deltaJitterSum = currentJitterSum - g_previousJitterSum[iter.first];
-            g_previousJitterSum[iter.first] = currentJitterSum;
-
-            double flowJitterMs = 0.0;
-            if (deltaPackets > 1)
+            NS_LOG_ERROR("Sweep: invalid run list item '" << item << "' in --sweepRuns");
+            return false;
+        }
+        if (last < first)
+        {
+            NS_LOG_ERROR("Sweep: descending run range '" << item << "' in --sweepRuns");
+            return false;
+        }
+        for (uint64_t run = first;; ++run)
+        {
+            runs.push_back(run);
+            if (run == last)
             {
-                flowJitterMs = (deltaJitterSum.GetSeconds() / (double)(deltaPackets - 1)) * 1000.0;
+                break;
             }
-            ueJitterMs[ueIndex] += flowJitterMs;
         }
     }
+    return true;
+}
 
-    // Aggregate metrics
-    double aggregateThroughputKbps = 0.0;
-    for (uint32_t i = 0; i < params.numUe; i++)
+/**
+ * @brief Appends the aggregate columns of one run's simulation_metrics.csv to the sweep table.
+ *
+ * Per-UE packet loss and jitter columns are averaged so rows from runs with different
+ * numUe share one schema.
+ * @param csvPath Path of the run's simulation_metrics.csv.
+ * @param prefix Grid-point columns prepended to every row.
+ * @param out Sweep results table.
+ * @return Number of rows appended.
+ */
+static size_t
+AppendRunMetrics(const std::string& csvPath, const std::string& prefix, std::ofstream& out)
+{
+    std::ifstream in(csvPath);
+    std::string line;
+    if (!in.is_open() || !std::getline(in, line))
     {
-        aggregateThroughputKbps += ueThroughputKbps[i];
+        return 0;
     }
 
-    double avgLatencyMs = (totalRxPackets > 0) ? (totalLatencySum / (double)totalRxPackets) : 0.0;
-
-    // Compute average throughput across all UEs
-    double avgThroughputKbps = (params.numUe > 0) ? (aggregateThroughputKbps / params.numUe) : 0.0;
-    g_avgThroughputPlot.push_back(avgThroughputKbps); // Store average throughput
-
-    // Store time-plot data
-    g_timePlot.push_back(g_currentTime);
-    g_avgLatencyPlot.push_back(avgLatencyMs);
-
-    for (uint32_t i = 0; i < params.numUe; i++)
+    // Locate the columns of interest from the header
+    std::vector<std::string> header = SplitList(line);
+    int timeCol = -1, avgThrCol = -1, latCol = -1, hoStartCol = -1, hoSuccCol = -1, hoFailCol = -1;
+    std::vector<size_t> lossCols, jitterCols;
+    for (size_t c = 0; c < header.size(); ++c)
     {
-        g_ueThroughputPlot[i].push_back(ueThroughputKbps[i]);
-        g_uePacketLossPlot[i].push_back(uePacketLossRate[i]);
-        g_ueJitterPlot[i].push_back(ueJitterMs[i]);
+        const std::string& name = header[c];
+        if (name == "Time(s)")
+            timeCol = c;
+        else if (name == "Avg_Throughput(Kbps)")
+            avgThrCol = c;
+        else if (name == "Avg_Latency(ms)")
+            latCol = c;
+        else if (name == "Handover_Start_Count")
+            hoStartCol = c;
+        else if (name == "Handover_Success_Count")
+            hoSuccCol = c;
+        else if (name == "Handover_Failure_Count")
+            hoFailCol = c;
+        else if (name.rfind("UE", 0) == 0 && name.find("_PacketLoss(%)") != std::string::npos)
+            lossCols.push_back(c);
+        else if (name.rfind("UE", 0) == 0 && name.find("_Jitter(ms)") != std::string::npos)
+            jitterCols.push_back(c);
     }
 
-    // Log current statistics
-    std::ostringstream oss;
-    oss << "Time: " << g_currentTime << "s, "
-        << "Aggregate Throughput: " << aggregateThroughputKbps << " Kbps, "
-        << "Average Throughput: " << avgThroughputKbps << " Kbps, "
-        << "Avg Latency: " << avgLatencyMs << " ms";
-    for (uint32_t i = 0; i < params.numUe; i++)
+    auto field = [](const std::vector<std::string>& row, int col) {
+        return (col >= 0 && (size_t)col < row.size()) ? row[col] : std::string("0");
+    };
+    auto mean = [](const std::vector<std::string>& row, const std::vector<size_t>& cols) {
+        double sum = 0.0;
+        for (size_t col : cols)
+        {
+            sum += (col < row.size()) ? std::strtod(row[col].c_str(), nullptr) : 0.0;
+        }
+        return cols.empty() ? 0.0 : sum / cols.size();
+    };
+
+    size_t rows = 0;
+    while (std::getline(in, line))
     {
-        oss << ", UE" << i << " Thr: " << ueThroughputKbps[i] << " Kbps";
+        std::vector<std::string> row = SplitList(line);
+        if (row.empty())
+            continue;
+        out << prefix << field(row, timeCol) << "," << field(row, avgThrCol) << ","
+            << field(row, latCol) << "," << mean(row, lossCols) << "," << mean(row, jitterCols)
+            << "," << field(row, hoStartCol) << "," << field(row, hoSuccCol) << ","
+            << field(row, hoFailCol) << "\n";
+        rows++;
     }
-    NS_LOG_INFO(oss.str());
+    return rows;
+}
 
-    // Additional Debugging: Log per-UE Packet Loss and Jitter
-    std::ostringstream oss_detail;
-    oss_detail << "Time: " << g_currentTime << "s, ";
-    for (uint32_t i = 0; i < params.numUe; i++)
+/**
+ * @struct ChildRun
+ * @brief One child simulation run of the sweep or benchmark driver.
+ */
+struct ChildRun
+{
+    std::vector<std::string> gridArgs; ///< Run-specific values as --name=value arguments
+    std::string prefix;                ///< CSV prefix columns for the results table
+    std::filesystem::path dir;         ///< Run directory
+    int exitStatus = -1;               ///< Child exit status (-1 = did not exit normally)
+    std::string doneKey;               ///< Arguments recorded in run.done on success
+};
+
+/**
+ * @brief Describes a file's version for the run.done key.
+ * @param path File to describe.
+ * @return Size and modification time of the file, or "missing".
+ */
+static std::string
+FileStamp(const std::filesystem::path& path)
+{
+    std::error_code ec;
+    uintmax_t size = std::filesystem::file_size(path, ec);
+    if (ec)
     {
-        oss_detail << "UE" << i << " PL: " << uePacketLossRate[i] << "%, "
-                   << "Jitter: " << ueJitterMs[i] << " ms; ";
+        return "missing";
     }
-    NS_LOG_DEBUG(oss_detail.str());
-
-    // Schedule next statistics update
-    if (g_currentTime + params.statsInterval <= params.simTime)
+    auto mtime = std::filesystem::last_write_time(path, ec);
+    if (ec)
     {
-        Simulator::Schedule(Seconds(params.statsInterval),
-                            &PeriodicStatsUpdate,
-                            flowMonitor,
-                            std::ref(flowHelper),
-                            params);
+        return "missing";
     }
+    return std::to_string(size) + " " + std::to_string(mtime.time_since_epoch().count());
 }
 
 /**
- * @brief Logs the positions of all nodes in the simulation (for debugging purposes).
+ * @brief Runs each child simulation in its own directory, up to maxJobs at once.
+ *
+ * The binary re-executes itself once per run inside the run directory, so the fixed output
+ * file names (CSV, traces, pcaps) never collide. Every child gets the driver's arguments
+ * except the --sweep* and --benchmark* options, followed by its own gridArgs, which take
+ * precedence; its output goes to run.log. The driver's arguments already contain the
+ * --config file entries, so --config itself is dropped, and input file paths are made
+ * absolute for the run directory.
+ *
+ * A successful run leaves its argument list in run.done, followed by the size and mtime of
+ * the executable and of the files named by the path options. With reuseCompleted, a run
+ * whose run.done matches is not executed again: the simulation is deterministic for given
+ * arguments (RngRun included) and inputs, so its outputs are what a rerun would produce.
+ * Rebuilding the binary or editing an input file invalidates the marker.
+ * @param jobs Runs to execute; exitStatus is filled in.
+ * @param args Arguments of the driver process, program name first.
+ * @param maxJobs Maximum number of concurrent children.
+ * @param tag Log prefix ("Sweep", "Benchmark").
+ * @param reuseCompleted Skip runs already completed with the same arguments.
  */
-void
-LogAllNodePositions()
+static void
+RunChildProcesses(std::vector<ChildRun>& jobs,
+                  const std::vector<std::string>& args,
+                  uint32_t maxJobs,
+                  const char* tag,
+                  bool reuseCompleted)
 {
-    NS_LOG_INFO("----- Node Positions at " << Simulator::Now().GetSeconds() << "s -----");
-    for (uint32_t i = 0; i < NodeList::GetNNodes(); ++i)
+    // Resolve our own executable, since children run from their own directories
+    std::error_code ec;
+    std::filesystem::path exe = std::filesystem::read_symlink("/proc/self/exe", ec);
+    if (ec)
     {
-        Ptr<Node> node = NodeList::GetNode(i);
-        Ptr<MobilityModel> mob = node->GetObject<MobilityModel>();
-        if (mob)
+        exe = std::filesystem::absolute(args[0]);
+    }
+
+    static const char* const pathOptions[] = {"--enbSiteFile=",
+                                              "--topologyLoad=",
+                                              "--configStoreIn="};
+    std::vector<std::string> forwardedArgs;
+    for (size_t i = 1; i < args.size(); ++i)
+    {
+        std::string arg = args[i];
+        // Parallel children cannot share one status port; status files are per run directory
+        if (arg.rfind("--sweep", 0) == 0 || arg.rfind("--benchmark", 0) == 0 ||
+            arg.rfind("--config=", 0) == 0 || arg.rfind("--statusPort=", 0) == 0)
         {
-            Vector pos = mob->GetPosition();
-            NS_LOG_INFO("Node " << i << " Position: (" << pos.x << ", " << pos.y << ", " << pos.z
-                                << ")");
+            continue;
         }
-        else
+        for (const char* option : pathOptions)
         {
-            NS_LOG_WARN("Node " << i << " has no MobilityModel!");
+            size_t len = std::strlen(option);
+            if (arg.rfind(option, 0) == 0 && arg.size() > len)
+            {
+                arg = option + std::filesystem::absolute(arg.substr(len)).string();
+            }
         }
+        forwardedArgs.push_back(arg);
     }
-    NS_LOG_INFO("-----------------------------------------------------");
-    Simulator::Schedule(Seconds(1.0), &LogAllNodePositions);
-}
 
-/**
- * @brief Analyzes the flow monitor data after simulation ends and generates reports.
- * @param flowHelper FlowMonitorHelper instance.
- * @param flowMonitor FlowMonitor instance.
- * @param params Simulation parameters.
- * @param remoteHostAddr IP address of the remote host.
- * @param ueAddresses Vector of UE IP addresses.
- */
-void
-AnalyzeData(FlowMonitorHelper& flowHelper,
-            Ptr<FlowMonitor> flowMonitor,
-            const SimulationParameters& params,
-            Ipv4Address remoteHostAddr,
-            const std::vector<Ipv4Address>& ueAddresses)
-{
-    flowMonitor->CheckForLostPackets();
-    Ptr<Ipv4FlowClassifier> classifier =
-        DynamicCast<Ipv4FlowClassifier>(flowHelper.GetClassifier());
-    auto stats = flowMonitor->GetFlowStats();
+    std::map<pid_t, size_t> running;
+    size_t nextJob = 0;
+    size_t finished = 0;
+    while (finished < jobs.size())
+    {
+        // Fill free slots
+        while (running.size() < maxJobs && nextJob < jobs.size())
+        {
+            ChildRun& job = jobs[nextJob];
+            std::filesystem::create_directories(job.dir);
 
-    double totalThroughputSum = 0.0;
-    double totalLatencySum = 0.0;
-    double totalJitterSum = 0.0;
-    uint64_t totalRxPackets = 0;
-    uint64_t totalRxPacketsForJitter = 0;
-    uint64_t totalTxPackets = 0;
-    uint32_t flowCount = 0;
+            std::vector<std::string> childArgs{exe.string()};
+            childArgs.insert(childArgs.end(), forwardedArgs.begin(), forwardedArgs.end());
+            childArgs.insert(childArgs.end(), job.gridArgs.begin(), job.gridArgs.end());
 
-    // Aggregate statistics across all flows
-    for (auto& iter : stats)
-    {
-        Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow(iter.first);
-        if (t.protocol != 17) // Only UDP (VoIP)
-            continue;
+            // Completion marker: the run's arguments, one per line, then the versions of the
+            // executable and of the input files (relative paths resolve in the run directory)
+            std::string key;
+            for (size_t i = 1; i < childArgs.size(); ++i)
+            {
+                key += childArgs[i] + "\n";
+            }
+            key += "exe " + FileStamp(exe) + "\n";
+            for (size_t i = 1; i < childArgs.size(); ++i)
+            {
+                for (const char* option : pathOptions)
+                {
+                    size_t len = std::strlen(option);
+                    if (childArgs[i].rfind(option, 0) == 0 && childArgs[i].size() > len)
+                    {
+                        key += option + FileStamp(job.dir / childArgs[i].substr(len)) + "\n";
+                    }
+                }
+            }
+            job.doneKey = key;
+            std::filesystem::path donePath = job.dir / "run.done";
+            if (reuseCompleted)
+            {
+                std::ifstream done(donePath);
+                std::stringstream previous;
+                previous << done.rdbuf();
+                if (done.is_open() && previous.str() == key)
+                {
+                    NS_LOG_INFO(tag << ": reusing completed run " << job.dir.filename());
+                    job.exitStatus = 0;
+                    finished++;
+                    nextJob++;
+                    continue;
+                }
+            }
+            std::filesystem::remove(donePath);
 
-        // Check if the flow is from a UE to the Remote Host
-        bool isFromUe = false;
-        for (const auto& ueIp : ueAddresses)
-        {
-            if (t.sourceAddress == ueIp)
+            pid_t pid = fork();
+            if (pid == 0)
             {
-                isFromUe = true;
-                break;
+                std::vector<char*> childArgv;
+                for (auto& arg : childArgs)
+                {
+                    childArgv.push_back(const_cast<char*>(arg.c_str()));
+                }
+                childArgv.push_back(nullptr);
+
+                if (chdir(job.dir.c_str()) != 0)
+                {
+                    _exit(127);
+                }
+                int logFd = open("run.log", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                if (logFd >= 0)
+                {
+                    dup2(logFd, STDOUT_FILENO);
+                    dup2(logFd, STDERR_FILENO);
+                    close(logFd);
+                }
+                execv(childArgv[0], childArgv.data());
+                _exit(127);
+            }
+            else if (pid < 0)
+            {
+                NS_LOG_ERROR(tag << ": fork failed for " << job.dir);
+                finished++;
+            }
+            else
+            {
+                running[pid] = nextJob;
             }
+            nextJob++;
         }
 
-        if (!isFromUe || t.destinationAddress != remoteHostAddr)
-            continue; // Skip flows not originating from UEs to Remote Host
-
-        flowCount++;
-        double duration =
-            (iter.second.timeLastRxPacket - iter.second.timeFirstTxPacket).GetSeconds();
-        if (duration > 0)
+        if (running.empty())
         {
-            double throughputKbps = (iter.second.rxBytes * 8.0) / 1000.0 / duration;
-            totalThroughputSum += throughputKbps;
+            continue;
         }
 
-        uint64_t rxPkts = iter.second.rxPackets;
-        if (rxPkts > 0)
+        // Reap one child
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        auto runIt = running.find(pid);
+        if (pid < 0 || runIt == running.end())
         {
-            // Latency
-            double avgFlowLatencyMs = (iter.second.delaySum.GetSeconds() / (double)rxPkts) * 1000.0;
-            totalLatencySum += avgFlowLatencyMs * rxPkts;
-            totalRxPackets += rxPkts;
-
-            // Jitter
-            if (rxPkts > 1)
-            {
-                double meanFlowJitterMs =
-                    (iter.second.jitterSum.GetSeconds() / (double)(rxPkts - 1)) * 1000.0;
-                totalJitterSum += meanFlowJitterMs * (rxPkts - 1);
-                totalRxPacketsForJitter += (rxPkts - 1);
-            }
+            continue;
         }
-        totalTxPackets += iter.second.txPackets;
+        ChildRun& job = jobs[runIt->second];
+        job.exitStatus = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+        running.erase(runIt);
+        finished++;
+        if (job.exitStatus != 0)
+        {
+            NS_LOG_WARN(tag << ": run " << job.dir.filename() << " failed with status "
+                            << job.exitStatus << " (see run.log)");
+        }
+        else
+        {
+            std::ofstream done(job.dir / "run.done", std::ios::out | std::ios::trunc);
+            done << job.doneKey;
+        }
+        NS_LOG_INFO(tag << ": " << finished << "/" << jobs.size() << " runs finished");
     }
+}
 
-    double overallAvgLatencyMs =
-        (totalRxPackets > 0) ? (totalLatencySum / (double)totalRxPackets) : 0.0;
-    double overallAvgThroughput = (flowCount > 0) ? (totalThroughputSum / (double)flowCount) : 0.0;
-    double packetLossRate = 0.0;
-    if (totalTxPackets > 0)
+/**
+ * @brief Runs the sweep grid as independent child processes and merges their metrics.
+ *
+ * Up to sweep.jobs runs are in flight at once (see RunChildProcesses). Command-line
+ * arguments other than --sweep* are forwarded to every child, followed by the grid values.
+ * Only simulation_metrics.csv is merged, so children skip their final report
+ * (--enableReport=0) unless --sweepReports is given. With --sweepResume, runs completed
+ * earlier with the same arguments are merged without being executed again.
+ * @param sweep Sweep grid and driver options.
+ * @param params Single-run defaults used for empty grid lists.
+ * @param args Arguments of the driver process, program name first.
+ * @return 0 if every run succeeded, 1 otherwise.
+ */
+int
+RunParameterSweep(const SweepParameters& sweep,
+                  const SimulationParameters& params,
+                  const std::vector<std::string>& args)
+{
+    // The merge reads each run's simulation_metrics.csv
+    if (params.metricsFormat != "csv")
     {
-        packetLossRate = (double)(totalTxPackets - totalRxPackets) / (double)totalTxPackets * 100.0;
+        NS_LOG_ERROR("Sweep: --metricsFormat=" << params.metricsFormat
+                                                << " is not supported, sweeps merge CSV metrics");
+        return 1;
     }
-    double overallAvgJitterMs = 0.0;
-    if (totalRxPacketsForJitter > 0)
+
+    std::vector<std::string> codecs = SplitList(sweep.codecs);
+    std::vector<std::string> bandwidths = SplitList(sweep.lteBandwidths);
+    std::vector<std::string> schedulers = SplitList(sweep.schedulers);
+    std::vector<std::string> mobilityModes = SplitList(sweep.mobilityModes);
+    std::vector<std::string> numUes = SplitList(sweep.numUes);
+    std::vector<uint64_t> runs;
+    if (!ExpandRunList(sweep.runs, runs))
     {
-        overallAvgJitterMs = (totalJitterSum / (double)totalRxPacketsForJitter);
+        return 1;
     }
-
-    // Generate Gnuplot for Per-UE Throughput
-    Gnuplot plotThroughput;
-    plotThroughput.SetTitle("Per-UE Throughput Over Time");
-    plotThroughput.SetTerminal("png size 800,600");
-    plotThroughput.SetOutputFilename("ue-throughput-time-plot.png");
-    plotThroughput.SetLegend("Time (s)", "Throughput (Kbps)");
-
-    for (uint32_t ueIndex = 0; ueIndex < params.numUe; ueIndex++)
+    for (const auto* list : {&codecs, &bandwidths, &schedulers, &mobilityModes, &numUes})
     {
-        Gnuplot2dDataset dsT;
-        dsT.SetTitle("UE-" + std::to_string(ueIndex));
-        dsT.SetStyle(Gnuplot2dDataset::LINES_POINTS);
-
-        size_t steps = std::min(g_timePlot.size(), g_ueThroughputPlot[ueIndex].size());
-        for (size_t i = 0; i < steps; i++)
+        if (std::find(list->begin(), list->end(), std::string()) != list->end())
         {
-            dsT.Add(g_timePlot[i], g_ueThroughputPlot[ueIndex][i]);
+            NS_LOG_ERROR("Sweep: empty item in a grid list");
+            return 1;
         }
-        plotThroughput.AddDataset(dsT);
     }
-
-    // Write Gnuplot Script for Throughput
+    if (codecs.empty())
+        codecs.push_back(params.codec.name);
+    if (bandwidths.empty())
+        bandwidths.push_back(std::to_string(params.lteBandwidth));
+    if (schedulers.empty())
+        schedulers.push_back(params.scheduler);
+    if (mobilityModes.empty())
+        mobilityModes.push_back(std::to_string(params.mobilityMode));
+    if (numUes.empty())
+        numUes.push_back(std::to_string(params.numUe));
+    if (runs.empty())
+        runs.push_back(1);
+
+    for (const auto& name : codecs)
     {
-        std::ofstream fileT("ue-throughput-time-plot.plt");
-        if (!fileT.is_open())
-        {
-            NS_LOG_ERROR("Failed to open ue-throughput-time-plot.plt for writing.");
-            return;
-        }
-
-        fileT << "set terminal png size 800,600\n";
-        fileT << "set output 'ue-throughput-time-plot.png'\n";
-        fileT << "set title 'Per-UE Throughput Over Time'\n";
-        fileT << "set xlabel 'Time (s)'\n";
-        fileT << "set ylabel 'Throughput (Kbps)'\n";
-        fileT << "set key left top\n";
-        fileT << "plot ";
-
-        for (uint32_t ueIndex = 0; ueIndex < params.numUe; ueIndex++)
-        {
-            fileT << "'-' with linespoints title 'UE-" << ueIndex << "'";
-            if (ueIndex != params.numUe - 1)
-                fileT << ", ";
-        }
-        fileT << "\n";
-
-        // Write data for each UE
-        for (uint32_t ueIndex = 0; ueIndex < params.numUe; ueIndex++)
+        if (params.codecMap.find(name) == params.codecMap.end())
         {
-            for (size_t i = 0; i < g_timePlot.size(); i++)
-            {
-                double thr =
-                    (i < g_ueThroughputPlot[ueIndex].size()) ? g_ueThroughputPlot[ueIndex][i] : 0.0;
-                fileT << g_timePlot[i] << " " << thr << "\n";
-            }
-            fileT << "e\n";
+            NS_LOG_ERROR("Sweep: unknown VoIP codec " << name);
+            return 1;
         }
-        fileT.close();
-
-        NS_LOG_INFO("UE Throughput Gnuplot script: ue-throughput-time-plot.plt");
     }
 
-    // Generate Gnuplot for Aggregate Latency
-    Gnuplot plotLatency;
-    plotLatency.SetTitle("Aggregate Latency Over Time");
-    plotLatency.SetTerminal("png size 800,600");
-    plotLatency.SetOutputFilename("latency-time-plot.png");
-    plotLatency.SetLegend("Time (s)", "Latency (ms)");
-
-    Gnuplot2dDataset dsL;
-    dsL.SetTitle("Avg Latency (all flows)");
-    dsL.SetStyle(Gnuplot2dDataset::LINES_POINTS);
-
-    for (size_t i = 0; i < g_timePlot.size(); ++i)
+    std::filesystem::path root = std::filesystem::absolute(sweep.outputDir);
+    std::vector<ChildRun> jobs;
+    for (const auto& codecName : codecs)
+        for (const auto& bw : bandwidths)
+            for (const auto& sched : schedulers)
+                for (const auto& mob : mobilityModes)
+                    for (const auto& ue : numUes)
+                        for (uint64_t run : runs)
+                        {
+                            ChildRun job;
+                            job.gridArgs = {"--codec=" + codecName,
+                                            "--lteBandwidth=" + bw,
+                                            "--scheduler=" + sched,
+                                            "--mobilityMode=" + mob,
+                                            "--numUe=" + ue,
+                                            "--RngRun=" + std::to_string(run),
+                                            "--enableReport=" + std::to_string(sweep.reports)};
+                            job.prefix = codecName + "," + bw + "," + sched + "," + mob + "," +
+                                         ue + "," + std::to_string(run) + ",";
+                            job.dir = root / ("codec-" + codecName + "_bw-" + bw + "_sched-" +
+                                              sched + "_mob-" + mob + "_ue-" + ue + "_run-" +
+                                              std::to_string(run));
+                            jobs.push_back(job);
+                        }
+
+    uint32_t maxJobs = sweep.jobs;
+    if (maxJobs == 0)
     {
-        dsL.Add(g_timePlot[i], g_avgLatencyPlot[i]);
+        maxJobs = std::max(1u, std::thread::hardware_concurrency());
     }
-    plotLatency.AddDataset(dsL);
+    NS_LOG_INFO("Sweep: " << jobs.size() << " runs, up to " << maxJobs << " in parallel, output in "
+                          << root);
+    RunChildProcesses(jobs, args, maxJobs, "Sweep", sweep.resume);
 
-    // Write Gnuplot Script for Latency
+    // Merge per-run metrics into one long-format results table
+    std::ofstream results(root / "sweep_results.csv");
+    if (!results.is_open())
     {
-        std::ofstream fileL("latency-time-plot.plt");
-        if (!fileL.is_open())
-        {
-            NS_LOG_ERROR("Failed to open latency-time-plot.plt for writing.");
-            return;
-        }
-
-        fileL << "set terminal png size 800,600\n";
-        fileL << "set output 'latency-time-plot.png'\n";
-        fileL << "set title 'Aggregate Latency Over Time'\n";
-        fileL << "set xlabel 'Time (s)'\n";
-        fileL << "set ylabel 'Latency (ms)'\n";
-        fileL << "set key left top\n";
-        fileL << "plot '-' with linespoints title 'Avg Latency'\n";
+        NS_LOG_ERROR("Failed to open sweep_results.csv for writing.");
+        return 1;
+    }
+    results << "Codec,LteBandwidth(MHz),Scheduler,MobilityMode,NumUe,RngRun,Time(s),"
+               "Avg_Throughput(Kbps),Avg_Latency(ms),Avg_PacketLoss(%),Avg_Jitter(ms),"
+               "Handover_Start_Count,Handover_Success_Count,Handover_Failure_Count\n";
 
-        for (size_t i = 0; i < g_timePlot.size(); i++)
+    uint32_t failedRuns = 0;
+    for (const auto& job : jobs)
+    {
+        if (job.exitStatus != 0 ||
+            AppendRunMetrics((job.dir / "simulation_metrics.csv").string(), job.prefix, results) ==
+                0)
         {
-            double lat = (i < g_avgLatencyPlot.size()) ? g_avgLatencyPlot[i] : 0.0;
-            fileL << g_timePlot[i] << " " << lat << "\n";
+            failedRuns++;
         }
-        fileL << "e\n";
-        fileL.close();
-
-        NS_LOG_INFO("Latency Gnuplot script: latency-time-plot.plt");
     }
+    results.close();
 
-    // Generate Gnuplot for Average Throughput
-    Gnuplot plotAvgThroughput;
-    plotAvgThroughput.SetTitle("Average Throughput Over Time");
-    plotAvgThroughput.SetTerminal("png size 800,600");
-    plotAvgThroughput.SetOutputFilename("avg-throughput-time-plot.png");
-    plotAvgThroughput.SetLegend("Time (s)", "Average Throughput (Kbps)");
+    NS_LOG_INFO("Sweep finished: " << jobs.size() - failedRuns << "/" << jobs.size()
+                                   << " runs merged into " << (root / "sweep_results.csv"));
+    return (failedRuns == 0) ? 0 : 1;
+}
 
-    Gnuplot2dDataset dsAvgThroughput;
-    dsAvgThroughput.SetTitle("Avg Throughput");
-    dsAvgThroughput.SetStyle(Gnuplot2dDataset::LINES_POINTS);
+/**
+ * @brief Resolves a scheduler short name to the ns-3 TypeId name of an FF MAC scheduler.
+ * @param name Short name (rr, pf, fdmt, tdmt, tta, fdbet, tdbet, fdtbfq, tdtbfq, pss, cqa)
+ *             or the TypeId name of any FfMacScheduler subclass.
+ * @param typeName Output TypeId name.
+ * @return false if the name is neither a known short name nor an FfMacScheduler type.
+ */
+bool
+SchedulerTypeName(const std::string& name, std::string& typeName)
+{
+    static const std::map<std::string, std::string> shortNames = {
+        {"rr", "ns3::RrFfMacScheduler"},
+        {"pf", "ns3::PfFfMacScheduler"},
+        {"fdmt", "ns3::FdMtFfMacScheduler"},
+        {"tdmt", "ns3::TdMtFfMacScheduler"},
+        {"tta", "ns3::TtaFfMacScheduler"},
+        {"fdbet", "ns3::FdBetFfMacScheduler"},
+        {"tdbet", "ns3::TdBetFfMacScheduler"},
+        {"fdtbfq", "ns3::FdTbfqFfMacScheduler"},
+        {"tdtbfq", "ns3::TdTbfqFfMacScheduler"},
+        {"pss", "ns3::PssFfMacScheduler"},
+        {"cqa", "ns3::CqaFfMacScheduler"}};
+
+    auto it = shortNames.find(name);
+    typeName = (it != shortNames.end()) ? it->second : name;
+    TypeId tid;
+    if (!TypeId::LookupByNameFailSafe(typeName, &tid) ||
+        !tid.IsChildOf(FfMacScheduler::GetTypeId()))
+    {
+        NS_LOG_ERROR("Unknown MAC scheduler: " << name);
+        return false;
+    }
+    return true;
+}
 
-    for (size_t i = 0; i < g_timePlot.size(); ++i)
+/**
+ * @brief Writes the per-cell scheduler profile collected by ProfilingFfMacScheduler.
+ *
+ * One row per cell, component carrier and direction: the scheduler's wall-clock cost per
+ * TTI (mean, p99, max), mean scheduled UEs and RBs per TTI, RB utilization over all TTIs and
+ * the spectral efficiency of the allocated RBs (TB bits per RB and TTI over 180 kHz x 1 ms).
+ * @param path Output file path.
+ * @param params Simulation parameters (scheduler name and bandwidth).
+ * @return true if the file was written, false otherwise.
+ */
+bool
+WriteSchedulerProfile(const std::string& path, const SimulationParameters& params)
+{
+    std::ofstream out(path);
+    if (!out.is_open())
     {
-        double avgThr = (i < g_avgThroughputPlot.size()) ? g_avgThroughputPlot[i] : 0.0;
-        dsAvgThroughput.Add(g_timePlot[i], avgThr);
+        return false;
     }
-    plotAvgThroughput.AddDataset(dsAvgThroughput);
 
-    // Write Gnuplot Script for Average Throughput
+    auto bandwidth = params.lteBandwidthMap.find(params.lteBandwidth);
+    uint16_t dlRbs = (bandwidth != params.lteBandwidthMap.end()) ? bandwidth->second.first : 6;
+    uint16_t ulRbs = (bandwidth != params.lteBandwidthMap.end()) ? bandwidth->second.second : 6;
+
+    out << "Cell,CC,Direction,Scheduler,TTIs,ActiveTTIs,Mean_Cost(us),P99_Cost(us),Max_Cost(us),"
+           "Mean_UEs,Mean_RBs,RB_Utilization(%),Spectral_Efficiency(bps/Hz)\n";
+    SchedulerDirectionStats total[2];
+    auto entry = g_schedulerProfiles.begin();
+    for (size_t row = 0; row <= g_schedulerProfiles.size(); ++row)
     {
-        std::ofstream fileAvg("avg-throughput-time-plot.plt");
-        if (!fileAvg.is_open())
+        bool isTotal = (entry == g_schedulerProfiles.end());
+        for (int d = 0; d < 2; ++d)
         {
-            NS_LOG_ERROR("Failed to open avg-throughput-time-plot.plt for writing.");
-            return;
-        }
-
-        fileAvg << "set terminal png size 800,600\n";
-        fileAvg << "set output 'avg-throughput-time-plot.png'\n";
-        fileAvg << "set title 'Average Throughput Over Time'\n";
-        fileAvg << "set xlabel 'Time (s)'\n";
-        fileAvg << "set ylabel 'Average Throughput (Kbps)'\n";
-        fileAvg << "set key left top\n";
-        fileAvg << "plot '-' with linespoints title 'Avg Throughput'\n";
+            const SchedulerDirectionStats& stats =
+                isTotal ? total[d] : (d == 0 ? entry->second.dl : entry->second.ul);
+            if (!isTotal)
+            {
+                SchedulerDirectionStats& sum = total[d];
+                sum.costBins.resize(LogHistogram::BINS, 0);
+                sum.ttis += stats.ttis;
+                sum.activeTtis += stats.activeTtis;
+                sum.allocations += stats.allocations;
+                sum.rbs += stats.rbs;
+                sum.bytes += stats.bytes;
+                sum.totalNs += stats.totalNs;
+                sum.maxNs = std::max(sum.maxNs, stats.maxNs);
+                for (uint32_t i = 0; i < LogHistogram::BINS; ++i)
+                {
+                    sum.costBins[i] += stats.costBins[i];
+                }
+            }
 
-        for (size_t i = 0; i < g_timePlot.size(); i++)
+            double ttis = std::max<double>(1.0, stats.ttis);
+            uint16_t cellRbs = (d == 0) ? dlRbs : ulRbs;
+            out << (isTotal ? std::string("all,all")
+                            : std::to_string(entry->first.first) + "," +
+                                  std::to_string(entry->first.second))
+                << "," << (d == 0 ? "DL" : "UL") << "," << params.scheduler << ","
+                << stats.ttis << "," << stats.activeTtis << "," << stats.totalNs / ttis / 1000.0
+                << ","
+                << (stats.costBins.empty()
+                        ? 0.0
+                        : LogHistogram::Quantile(stats.costBins.data(), 0.99) * 1e3)
+                << "," << stats.maxNs / 1000.0 << "," << stats.allocations / ttis << ","
+                << stats.rbs / ttis << "," << 100.0 * stats.rbs / (ttis * cellRbs) << ","
+                << (stats.rbs > 0 ? stats.bytes * 8.0 / (stats.rbs * 180.0) : 0.0) << "\n";
+        }
+        if (!isTotal)
         {
-            double avgThr = (i < g_avgThroughputPlot.size()) ? g_avgThroughputPlot[i] : 0.0;
-            fileAvg << g_timePlot[i] << " " << avgThr << "\n";
+            ++entry;
         }
-        fileAvg << "e\n";
-        fileAvg.close();
-
-        NS_LOG_INFO("Average Throughput Gnuplot script: avg-throughput-time-plot.plt");
     }
 
-    // Final Metrics Logging
-    NS_LOG_INFO("===== FINAL METRICS =====");
-    NS_LOG_INFO("Avg Throughput (Kbps) : " << overallAvgThroughput);
-    NS_LOG_INFO("Avg Latency (ms)     : " << overallAvgLatencyMs);
-    NS_LOG_INFO("Packet Loss (%)      : " << packetLossRate);
-    NS_LOG_INFO("Avg Jitter (ms)      : " << overallAvgJitterMs);
-
-    // Serialize FlowMonitor Results
-    flowMonitor->SerializeToXmlFile("flowmon.xml", true, true);
-    NS_LOG_INFO("FlowMonitor results stored in flowmon.xml.");
-
-    // Export Time-Plot Data to CSV
-    std::ofstream csvFile("simulation_metrics.csv");
-    if (!csvFile.is_open())
+    for (int d = 0; d < 2; ++d)
     {
-        NS_LOG_ERROR("Failed to open simulation_metrics.csv for writing.");
-        return;
+        double ttis = std::max<double>(1.0, total[d].ttis);
+        NS_LOG_INFO("Scheduler " << params.scheduler << (d == 0 ? " DL: " : " UL: ")
+                                 << total[d].totalNs / ttis / 1000.0 << " us per TTI, "
+                                 << total[d].rbs / ttis << " RBs per TTI over "
+                                 << g_schedulerProfiles.size() << " carriers");
     }
+    return out.good();
+}
 
-    // Write CSV Header
-    csvFile << "Time(s),Avg_Throughput(Kbps)";
-    for (uint32_t ueIndex = 0; ueIndex < params.numUe; ueIndex++)
-    {
-        csvFile << ",UE" << ueIndex << "_Throughput(Kbps)";
-    }
-    csvFile << ",Avg_Latency(ms)";
-    for (uint32_t ueIndex = 0; ueIndex < params.numUe; ueIndex++)
-    {
-        csvFile << ",UE" << ueIndex << "_PacketLoss(%)";
-    }
-    for (uint32_t ueIndex = 0; ueIndex < params.numUe; ueIndex++)
+/**
+ * @brief Writes the simulator performance summary of this run as a one-row CSV file.
+ *
+ * Events are those executed by the ns-3 scheduler; peak RSS is the process high-water mark
+ * (getrusage), so it covers setup as well as the run itself.
+ * @param path Output file path.
+ * @param setupWallSeconds Wall-clock time from program start to Simulator::Run.
+ * @param runWallSeconds Wall-clock time spent in Simulator::Run.
+ * @param simSeconds Simulated time.
+ * @return true if the file was written, false otherwise.
+ */
+bool
+WritePerformanceReport(const std::string& path,
+                       double setupWallSeconds,
+                       double runWallSeconds,
+                       double simSeconds)
+{
+    std::ofstream report(path);
+    if (!report.is_open())
     {
-        csvFile << ",UE" << ueIndex << "_Jitter(ms)";
+        return false;
     }
 
-    // Add Handover Metrics to Header
-    csvFile << ",Handover_Start_Count,Handover_Success_Count,Handover_Failure_Count";
-    csvFile << "\n";
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    uint64_t events = Simulator::GetEventCount();
+    double runWall = std::max(runWallSeconds, 1e-9);
+
+    report << "SetupWall(s),RunWall(s),SimTime(s),SimSecondsPerWallSecond,Events,"
+              "EventsPerWallSecond,PeakRSS(MB)\n";
+    report << setupWallSeconds << "," << runWallSeconds << "," << simSeconds << ","
+           << simSeconds / runWall << "," << events << "," << events / runWall << ","
+           << usage.ru_maxrss / 1024.0 << "\n";
+    NS_LOG_INFO("Performance: " << runWallSeconds << " s wall for " << simSeconds
+                                << " s simulated, " << events << " events, peak RSS "
+                                << usage.ru_maxrss / 1024.0 << " MB");
+    return report.good();
+}
 
-    // Write CSV Data Rows
-    size_t numEntries = g_timePlot.size();
-    for (size_t i = 0; i < numEntries; ++i)
+/**
+ * @brief Runs the scaling benchmark matrix and collects a machine-readable summary.
+ *
+ * Every scale (numUe x numEnb on a hex layout with 100 m inter-site distance and an area
+ * just large enough to hold it) runs once per feature variant: nothing extra, FlowMonitor,
+ * full LTE traces, and NetAnim in full and lite mode. Runs execute one at a time through
+ * RunChildProcesses and each writes performance.csv (see WritePerformanceReport); the rows
+ * are merged into benchmark_results.csv. Other command-line arguments are forwarded to every
+ * run, so the matrix can be repeated with e.g. a different codec or scheduler.
+ * @param benchmark Benchmark driver options.
+ * @param args Arguments of the driver process, program name first.
+ * @return 0 if every run succeeded, 1 otherwise.
+ */
+int
+RunBenchmarkSuite(const BenchmarkParameters& benchmark, const std::vector<std::string>& args)
+{
+    /**
+     * @brief Scenario scale of the benchmark matrix.
+     */
+    struct Scale
     {
-        csvFile << g_timePlot[i] << ",";
-
-        double avgThr = (i < g_avgThroughputPlot.size()) ? g_avgThroughputPlot[i] : 0.0;
-        csvFile << avgThr;
+        uint32_t numUe;  ///< Number of UEs
+        uint32_t numEnb; ///< Number of eNodeB sites
+    };
 
-        for (uint32_t ueIndex = 0; ueIndex < params.numUe; ueIndex++)
+    /**
+     * @brief Feature variant of the benchmark matrix.
+     */
+    struct Variant
+    {
+        const char* name;         ///< Variant name in the results table
+        bool flowMonitor;         ///< FlowMonitor enabled
+        const char* traceProfile; ///< LTE trace profile
+        const char* netAnim;      ///< NetAnim mode ("off", "full", "lite")
+    };
+
+    static const Scale scales[] = {{5, 2}, {50, 7}, {500, 37}, {5000, 200}};
+    static const Variant variants[] = {{"baseline", false, "none", "off"},
+                                       {"flowmon", true, "none", "off"},
+                                       {"traces", false, "full", "off"},
+                                       {"netanim-full", false, "none", "full"},
+                                       {"netanim-lite", false, "none", "lite"}};
+    const double interSiteDistance = 100.0;
+
+    std::filesystem::path root = std::filesystem::absolute(benchmark.outputDir);
+    std::vector<ChildRun> jobs;
+    for (const Scale& scale : scales)
+    {
+        if (scale.numUe > benchmark.maxUe)
         {
-            double thr =
-                (i < g_ueThroughputPlot[ueIndex].size()) ? g_ueThroughputPlot[ueIndex][i] : 0.0;
-            csvFile << "," << thr;
+            continue;
         }
 
-        double lat = (i < g_avgLatencyPlot.size()) ? g_avgLatencyPlot[i] : 0.0;
-        csvFile << "," << lat;
-
-        for (uint32_t ueIndex = 0; ueIndex < params.numUe; ueIndex++)
+        // Smallest number of complete hex rings holding every site, plus one ring of margin
+        uint32_t rings = 0;
+        while (1 + 3 * rings * (rings + 1) < scale.numEnb)
         {
-            double loss =
-                (i < g_uePacketLossPlot[ueIndex].size()) ? g_uePacketLossPlot[ueIndex][i] : 0.0;
-            csvFile << "," << loss;
+            rings++;
         }
+        double areaSize = std::max(200.0, 2.0 * (rings + 1) * interSiteDistance);
 
-        for (uint32_t ueIndex = 0; ueIndex < params.numUe; ueIndex++)
+        for (const Variant& variant : variants)
         {
-            double jit = (i < g_ueJitterPlot[ueIndex].size()) ? g_ueJitterPlot[ueIndex][i] : 0.0;
-            csvFile << "," << jit;
+            std::string netAnim(variant.netAnim);
+            ChildRun job;
+            job.gridArgs = {"--numUe=" + std::to_string(scale.numUe),
+                            "--numEnb=" + std::to_string(scale.numEnb),
+                            "--interSiteDistance=" + std::to_string(interSiteDistance),
+                            "--areaSize=" + std::to_string(areaSize),
+                            "--simTime=" + std::to_string(benchmark.simTime),
+                            "--enableFlowMonitor=" + std::string(variant.flowMonitor ? "1" : "0"),
+                            "--traceProfile=" + std::string(variant.traceProfile),
+                            "--enableNetAnim=" + std::string(netAnim == "off" ? "0" : "1"),
+                            "--perfReport=performance.csv"};
+            if (netAnim != "off")
+            {
+                job.gridArgs.push_back("--animMode=" + netAnim);
+            }
+            job.prefix = std::string(variant.name) + "," + std::to_string(scale.numUe) + "," +
+                         std::to_string(scale.numEnb) + "," + (variant.flowMonitor ? "1" : "0") +
+                         "," + variant.traceProfile + "," + netAnim + ",";
+            job.dir = root / ("ue-" + std::to_string(scale.numUe) + "_enb-" +
+                              std::to_string(scale.numEnb) + "_" + variant.name);
+            jobs.push_back(job);
         }
+    }
+
+    NS_LOG_INFO("Benchmark: " << jobs.size() << " runs of " << benchmark.simTime
+                              << " s simulated, output in " << root);
+    RunChildProcesses(jobs, args, 1, "Benchmark", false);
 
-        // Add Handover Counts
-        uint32_t hs = (i < g_handoverStartPlot.size()) ? g_handoverStartPlot[i] : 0;
-        uint32_t hsucc = (i < g_handoverSuccessPlot.size()) ? g_handoverSuccessPlot[i] : 0;
-        uint32_t hf = (i < g_handoverFailurePlot.size()) ? g_handoverFailurePlot[i] : 0;
-        csvFile << "," << hs << "," << hsucc << "," << hf;
+    std::ofstream results(root / "benchmark_results.csv");
+    if (!results.is_open())
+    {
+        NS_LOG_ERROR("Failed to open benchmark_results.csv for writing.");
+        return 1;
+    }
+    results << "Variant,NumUe,NumEnb,FlowMonitor,TraceProfile,NetAnim,ExitStatus,SetupWall(s),"
+               "RunWall(s),SimTime(s),SimSecondsPerWallSecond,Events,EventsPerWallSecond,"
+               "PeakRSS(MB)\n";
 
-        csvFile << "\n";
+    uint32_t failedRuns = 0;
+    for (const auto& job : jobs)
+    {
+        // Failed runs keep their row, with empty performance columns, so regressions that
+        // crash or run out of memory stay visible in the summary
+        std::ifstream report(job.dir / "performance.csv");
+        std::string line;
+        bool haveReport = report.is_open() && std::getline(report, line) &&
+                          std::getline(report, line);
+        if (job.exitStatus != 0 || !haveReport)
+        {
+            failedRuns++;
+            line = ",,,,,,";
+        }
+        results << job.prefix << job.exitStatus << "," << line << "\n";
     }
+    results.close();
 
-    csvFile.close();
-    NS_LOG_INFO("Simulation metrics exported to simulation_metrics.csv.");
+    NS_LOG_INFO("Benchmark finished: " << jobs.size() - failedRuns << "/" << jobs.size()
+                                       << " runs in " << (root / "benchmark_results.csv"));
+    return (failedRuns == 0) ? 0 : 1;
 }